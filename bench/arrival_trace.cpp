@@ -0,0 +1,116 @@
+// Arrival trace benchmark: how fast a CSV detector log streams into vehicles.
+//
+// Writes a synthetic trace of N arrivals (default 5M, about 250 MB) on the
+// default network, then, with the file in the page cache, times a plain
+// read() of it in 1 MB chunks (the ceiling) against opening it and streaming
+// every vehicle out of it the way a run does, validating each line as it
+// goes. Reports MB/s for both and the peak resident set, which stays at the
+// size of the chunk however long the trace.
+//
+//   make bench
+//   ./bench/arrival_trace [arrivals] [file]
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/resource.h>
+using namespace std;
+
+#include "arrival_trace.h"
+#include "network.h"
+
+static double seconds_since(chrono::steady_clock::time_point start) {
+    return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+static long peak_rss_kb() {
+    struct rusage u;
+    getrusage(RUSAGE_SELF, &u);
+    return u.ru_maxrss;
+}
+
+static bool write_trace(const string &path, long n) {
+    static const char *approaches = "NESW";
+    static const char *types[] = {"car", "bus", "bike", "", "car", "ambulance"};
+    static const char *turns[] = {"straight", "left", "right", ""};
+    FILE *f = fopen(path.c_str(), "w");
+    if (!f) return false;
+    fprintf(f, "timestamp,detector,intersection,approach,type,turn,speed_kmh\n");
+    double t = 1697040000.0;
+    uint64_t x = 88172645463325252ull;
+    for (long i = 0; i < n; ++i) {
+        x ^= x << 13; x ^= x >> 7; x ^= x << 17;
+        t += (x % 500) / 1000.0;
+        int at = (int)((x >> 8) % intersection_count());
+        fprintf(f, "%.3f,D%03d,%s,%c,%s,%s,%d\n", t, (int)((x >> 16) % 100), g_network.names[at].c_str(),
+                approaches[(x >> 24) % 4], types[(x >> 28) % 6], turns[(x >> 32) % 4], (int)((x >> 40) % 60));
+    }
+    return fclose(f) == 0;
+}
+
+int main(int argc, char **argv) {
+    long n = 5000000;
+    string path = "/tmp/arrival_trace_bench.csv";
+    if (argc > 1) n = atol(argv[1]);
+    if (argc > 2) path = argv[2];
+    if (n <= 0) {
+        cerr << "Usage: " << argv[0] << " [arrivals] [file]\n";
+        return 1;
+    }
+
+    string error;
+    if (!network_load_default(error)) {
+        cerr << error << "\n";
+        return 1;
+    }
+    sim_random_seed(42);
+    if (!write_trace(path, n)) {
+        cerr << path << ": cannot write the trace\n";
+        return 1;
+    }
+    long rssBefore = peak_rss_kb();
+
+    // The ceiling: the same bytes with nothing done to them
+    auto start = chrono::steady_clock::now();
+    int fd = open(path.c_str(), O_RDONLY);
+    vector<char> chunk(1 << 20);
+    double mb = 0;
+    ssize_t got;
+    while ((got = read(fd, chunk.data(), chunk.size())) > 0) mb += got / double(1 << 20);
+    close(fd);
+    double readSecs = seconds_since(start);
+
+    ArrivalTrace trace;
+    start = chrono::steady_clock::now();
+    if (!arrival_trace_open(path, trace, error)) {
+        cerr << error << "\n";
+        return 1;
+    }
+    Vehicle v;
+    double arrival, last = 0;
+    size_t streamed = 0;
+    while (arrival_trace_next(trace, (int)streamed + 1, v, arrival, error)) {
+        last = arrival;
+        streamed++;
+    }
+    double streamSecs = seconds_since(start);
+    bool ok = error.empty() && streamed == trace.arrivals && streamed == (size_t)n &&
+              trace.max_arrivals >= streamed;
+
+    cout << fixed << setprecision(1)
+         << n << " arrivals, " << mb << " MB, " << last / 3600 << " h of traffic\n"
+         << "read       " << mb / readSecs << " MB/s\n"
+         << "stream     " << mb / streamSecs << " MB/s, " << streamSecs * 1e9 / n << " ns/vehicle"
+         << (ok ? "" : ", VEHICLE COUNT DIFFERS") << "\n"
+         << "peak RSS   " << rssBefore / 1024.0 << " MB before reading, " << peak_rss_kb() / 1024.0 << " MB after\n";
+
+    arrival_trace_close(trace);
+    network_destroy();
+    remove(path.c_str());
+    return ok ? 0 : 1;
+}
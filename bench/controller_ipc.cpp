@@ -0,0 +1,127 @@
+// Controller IPC benchmark: pipe vs shared-memory ring.
+//
+// For each backend a child process is forked with one channel in each
+// direction, as main() does for the controllers.
+//   round trip  the parent sends EMERGENCY_INCOMING and waits for the child
+//               to echo it back; p50/p99/max over many pings
+//   throughput  the parent streams NORMAL messages as fast as it can (up to a
+//               full ring or pipe in flight), first with one channel_send per
+//               message, then packed 64 to a channel_send_batch; the child
+//               drains in batches and echoes the ping that closes each phase
+//               once it has seen everything before it
+//
+//   make bench
+//   ./bench/controller_ipc [pings] [stream_messages]
+
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <cstdlib>
+#include <unistd.h>
+#include <sys/wait.h>
+using namespace std;
+
+#include "controller.h"
+#include "latency_histogram.h"
+
+static void echo_child(ControllerChannel &in, ControllerChannel &out) {
+    const int BATCH = 64;
+    ControllerMessage batch[BATCH];
+    long streamed = 0;
+    while (true) {
+        int n = channel_receive(in, batch, BATCH);
+        if (n <= 0) return;
+        for (int i = 0; i < n; ++i) {
+            ControllerMessage &m = batch[i];
+            if (m.type == ControllerSignal::EMERGENCY_INCOMING) {
+                channel_send(out, controller_message(m.type, m.dst, m.src, m.vehicle));
+            } else if (m.type == ControllerSignal::NORMAL) {
+                streamed++;
+            } else {
+                channel_send(out, controller_message(ControllerSignal::SHUTDOWN, m.dst, m.src));
+                return;
+            }
+        }
+    }
+}
+
+// Send a ping and wait for its echo: everything sent before it has been seen
+static void ping(ControllerChannel &down, ControllerChannel &up) {
+    ControllerMessage reply;
+    channel_send(down, controller_message(ControllerSignal::EMERGENCY_INCOMING, -1, 0, 1));
+    channel_receive(up, &reply, 1);
+}
+
+static void run(IpcBackend backend, int pings, int streamed) {
+    ControllerChannel down, up;
+    if (!channel_open(down, backend) || !channel_open(up, backend)) {
+        cerr << "cannot open " << ipc_backend_name(backend) << " channels\n";
+        exit(1);
+    }
+
+    pid_t child = fork();
+    if (child == 0) {
+        echo_child(down, up);
+        _exit(0);
+    }
+
+    LatencyHistogram rtt;
+    latency_histogram_reset(rtt);
+    for (int i = 0; i < pings; ++i) {
+        auto sent = chrono::steady_clock::now();
+        ping(down, up);
+        latency_histogram_record(rtt, chrono::duration<double>(chrono::steady_clock::now() - sent).count());
+    }
+
+    ControllerMessage normal = controller_message(ControllerSignal::NORMAL, -1, 0);
+    auto start = chrono::steady_clock::now();
+    for (int i = 0; i < streamed; ++i) channel_send(down, normal);
+    ping(down, up);
+    double secs = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    const int PACK = 64;
+    ControllerMessage pack[PACK];
+    for (int i = 0; i < PACK; ++i) pack[i] = normal;
+    start = chrono::steady_clock::now();
+    for (int i = 0; i < streamed; i += PACK) channel_send_batch(down, pack, min(PACK, streamed - i));
+    ping(down, up);
+    double batchedSecs = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    ControllerMessage reply;
+    channel_send(down, controller_message(ControllerSignal::SHUTDOWN, -1, 0));
+    channel_receive(up, &reply, 1);
+
+    waitpid(child, NULL, 0);
+    channel_close(down);
+    channel_close(up);
+
+    cout << left << setw(13) << ipc_backend_name(backend)
+         << right << fixed << setprecision(1)
+         << setw(12) << latency_histogram_percentile(rtt, 0.50) * 1e6
+         << setw(12) << latency_histogram_percentile(rtt, 0.99) * 1e6
+         << setw(12) << rtt.max_us / 1.0
+         << setw(14) << setprecision(0) << streamed / secs
+         << setw(15) << streamed / batchedSecs << endl;
+}
+
+int main(int argc, char **argv) {
+    int pings = 20000;
+    int streamed = 2000000;
+    if (argc > 1) pings = atoi(argv[1]);
+    if (argc > 2) streamed = atoi(argv[2]);
+    if (pings <= 0 || streamed <= 0) {
+        cerr << "Usage: " << argv[0] << " [pings] [stream_messages]\n";
+        return 1;
+    }
+
+    cout << pings << " round trips, " << streamed << " streamed messages per backend\n\n";
+    cout << left << setw(13) << "backend"
+         << right << setw(12) << "rtt p50 us"
+         << setw(12) << "rtt p99 us"
+         << setw(12) << "rtt max us"
+         << setw(14) << "stream msg/s"
+         << setw(15) << "batched msg/s" << endl;
+    run(IpcBackend::Pipe, pings, streamed);
+    run(IpcBackend::SharedRing, pings, streamed);
+    return 0;
+}
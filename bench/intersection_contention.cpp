@@ -0,0 +1,122 @@
+// Contention benchmark for Intersection wakeups.
+//
+// Many vehicle threads cross one intersection in a loop while the light
+// toggles quickly, once with the original broadcast scheme and once with the
+// per-movement wait queues. The interesting number is wakeups per admission:
+// every wakeup beyond the first costs a context switch and a trip through
+// I.lock for a vehicle that still cannot enter. The tail of the wait before
+// entry is reported for normal cars and for emergency vehicles, whose share of
+// the traffic can be raised to see how well cars are protected from starving.
+//
+//   make bench
+//   ./bench/intersection_contention [threads] [crossings_per_thread] [emergency_percent]
+
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <atomic>
+#include <vector>
+#include <cstdlib>
+#include <pthread.h>
+#include <unistd.h>
+using namespace std;
+
+#include "intersection.h"
+#include "controller.h"
+
+static int g_crossings = 200;
+static int g_emergency_pct = 2;
+static atomic<bool> g_running;
+static Intersection g_intersection;
+
+static void* light_toggler(void *arg) {
+    Intersection &I = *(Intersection*)arg;
+    bool green = true;
+    while (g_running.load()) {
+        usleep(1000);
+        green = !green;
+        set_light(I, green ? LightColor::GREEN : LightColor::RED, "Bench");
+    }
+    return NULL;
+}
+
+static void* vehicle_loop(void *arg) {
+    int id = (int)(long)arg;
+    unsigned seed = 1234u + id;
+    Vehicle v = {};
+    v.id = id;
+    for (int i = 0; i < g_crossings; ++i) {
+        int r = rand_r(&seed) % 100;
+        v.type = (r < g_emergency_pct) ? VehicleType::Ambulance
+               : (r < g_emergency_pct + 10) ? VehicleType::Bus : VehicleType::Car;
+        v.priority = compute_priority(v.type);
+        v.approach = (Approach)(rand_r(&seed) % 4);
+        v.direction = (Direction)(rand_r(&seed) % 3);
+
+        enter_intersection(g_intersection, &v);
+        usleep(20);   // crossing
+        leave_intersection(g_intersection, &v);
+    }
+    return NULL;
+}
+
+static void run(WakePolicy policy, int nThreads) {
+    Intersection &I = g_intersection;
+    init_intersection(I, IntersectionId(0));
+    I.wake_policy = policy;
+    set_light(I, LightColor::GREEN, "Bench");
+
+    g_running = true;
+    pthread_t lights;
+    pthread_create(&lights, NULL, light_toggler, &I);
+
+    auto start = chrono::steady_clock::now();
+    vector<pthread_t> threads(nThreads);
+    for (int i = 0; i < nThreads; ++i) {
+        pthread_create(&threads[i], NULL, vehicle_loop, (void*)(long)(i + 1));
+    }
+    for (pthread_t &t : threads) pthread_join(t, NULL);
+    double secs = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    g_running = false;
+    pthread_join(lights, NULL);
+
+    cout << left << setw(11) << (policy == WakePolicy::Broadcast ? "broadcast" : "targeted")
+         << right << setw(12) << I.admissions
+         << setw(12) << I.wakeups
+         << setw(14) << fixed << setprecision(2) << (double)I.wakeups / I.admissions
+         << setw(12) << setprecision(0) << I.admissions / secs;
+    const LatencyHistogram &car = I.wait_time[compute_priority(VehicleType::Car)];
+    const LatencyHistogram &amb = I.wait_time[compute_priority(VehicleType::Ambulance)];
+    cout << setprecision(1)
+         << setw(12) << latency_histogram_percentile(car, 0.99) * 1000
+         << setw(12) << car.max_us / 1000.0
+         << setw(12) << latency_histogram_percentile(amb, 0.99) * 1000 << endl;
+
+    destroy_intersection(I);
+}
+
+int main(int argc, char **argv) {
+    int nThreads = 32;
+    if (argc > 1) nThreads = atoi(argv[1]);
+    if (argc > 2) g_crossings = atoi(argv[2]);
+    if (argc > 3) g_emergency_pct = atoi(argv[3]);
+    if (nThreads <= 0 || g_crossings <= 0 || g_emergency_pct < 0 || g_emergency_pct > 90) {
+        cerr << "Usage: " << argv[0] << " [threads] [crossings_per_thread] [emergency_percent]\n";
+        return 1;
+    }
+
+    cout << nThreads << " vehicle threads x " << g_crossings
+         << " crossings, " << g_emergency_pct << "% emergency vehicles, light toggling every 1 ms\n\n";
+    cout << left << setw(11) << "policy"
+         << right << setw(12) << "admissions"
+         << setw(12) << "wakeups"
+         << setw(14) << "wakeups/adm"
+         << setw(12) << "adm/s"
+         << setw(12) << "car p99 ms"
+         << setw(12) << "car max ms"
+         << setw(12) << "emerg p99" << endl;
+    run(WakePolicy::Broadcast, nThreads);
+    run(WakePolicy::Targeted, nThreads);
+    return 0;
+}
@@ -0,0 +1,141 @@
+// Spot allocator benchmark: lock-free SpotMap vs a mutex-guarded bitmap.
+//
+// A lot of N spots (default 50,000 over 5 levels) is first filled to 90%, so
+// every claim has to find the free stretch at the far end. Then each thread
+// keeps 64 spots and, in a loop, claims a new one and releases its oldest.
+// Every claimed spot is checked against an owner table, so two threads ever
+// holding the same spot is reported as an error.
+//   nearest   every claim wants the spot nearest the entrance
+//   spread    each claim starts at a random spot (wrapping round)
+//   mutex     one lock around a scan-from-the-entrance bitmap, for reference
+//
+//   make bench
+//   ./bench/parking_spots [spots] [ops_per_thread] [max_threads]
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+using namespace std;
+
+#include "spot_map.h"
+
+const int HELD = 64;
+
+enum class Mode { Nearest, Spread, Mutex };
+
+// The reference: the same bitmap, one lock, linear scan
+struct LockedSpots {
+    mutex lock;
+    vector<uint64_t> used;
+    int spots;
+
+    int claim() {
+        lock_guard<mutex> lk(lock);
+        for (int w = 0; w < (int)used.size(); ++w) {
+            uint64_t free = ~used[w];
+            if (w * 64 + 64 > spots) free &= ((uint64_t)1 << (spots - w * 64)) - 1;
+            if (free) {
+                int bit = __builtin_ctzll(free);
+                used[w] |= (uint64_t)1 << bit;
+                return w * 64 + bit;
+            }
+        }
+        return -1;
+    }
+    void release(int spot) {
+        lock_guard<mutex> lk(lock);
+        used[spot / 64] &= ~((uint64_t)1 << (spot % 64));
+    }
+};
+
+static atomic<long> double_claims(0);
+
+static void worker(Mode mode, SpotMap &map, LockedSpots &locked, vector<atomic<int>> &owner,
+                   int self, int ops) {
+    int held[HELD];
+    int count = 0;
+    unsigned seed = (unsigned)self * 2654435761u + 1;
+    for (int i = 0; i < ops; ++i) {
+        if (count == HELD) {
+            int spot = held[i % HELD];
+            owner[spot].store(0, memory_order_relaxed);
+            if (mode == Mode::Mutex) locked.release(spot);
+            else spot_map_release(map, spot);
+            count--;
+        }
+        int spot;
+        if (mode == Mode::Mutex) spot = locked.claim();
+        else spot = spot_map_claim(map, mode == Mode::Spread ? (int)(rand_r(&seed) % map.spots) : 0);
+        if (spot < 0) continue;   // only if held + prefill ever fills the lot
+        if (owner[spot].exchange(self + 1, memory_order_relaxed) != 0) double_claims++;
+        held[i % HELD] = spot;
+        count++;
+    }
+    for (int k = 0; k < count; ++k) {
+        int spot = held[(ops - count + k) % HELD];
+        owner[spot].store(0, memory_order_relaxed);
+        if (mode == Mode::Mutex) locked.release(spot);
+        else spot_map_release(map, spot);
+    }
+}
+
+static double run(Mode mode, int spots, int ops, int threads) {
+    SpotMap map;
+    spot_map_init(map, spots, 5);
+    LockedSpots locked;
+    locked.spots = spots;
+    locked.used.assign((spots + 63) / 64, 0);
+    vector<atomic<int>> owner(spots);
+    for (atomic<int> &o : owner) o.store(0);
+
+    int prefill = spots * 9 / 10;
+    for (int i = 0; i < prefill; ++i) {
+        if (mode == Mode::Mutex) locked.claim();
+        else spot_map_claim(map);
+        owner[i].store(-1);
+    }
+
+    auto start = chrono::steady_clock::now();
+    vector<thread> pool;
+    for (int t = 0; t < threads; ++t) {
+        pool.emplace_back(worker, mode, ref(map), ref(locked), ref(owner), t, ops);
+    }
+    for (thread &t : pool) t.join();
+    double secs = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    spot_map_destroy(map);
+    return (double)ops * threads / secs;
+}
+
+int main(int argc, char **argv) {
+    int spots = 50000;
+    int ops = 1000000;
+    int maxThreads = (int)thread::hardware_concurrency();
+    if (argc > 1) spots = atoi(argv[1]);
+    if (argc > 2) ops = atoi(argv[2]);
+    if (argc > 3) maxThreads = atoi(argv[3]);
+    if (maxThreads <= 0) maxThreads = 1;
+    if (spots < 1000 || ops <= 0) {
+        cerr << "Usage: " << argv[0] << " [spots >= 1000] [ops_per_thread] [max_threads]\n";
+        return 1;
+    }
+
+    cout << spots << " spots (90% taken), " << ops << " claim+release per thread\n\n";
+    cout << setw(8) << "threads" << setw(16) << "nearest ops/s" << setw(16) << "spread ops/s"
+         << setw(16) << "mutex ops/s" << endl;
+    for (int t = 1; t <= maxThreads; t *= 2) {
+        cout << setw(8) << t << fixed << setprecision(0)
+             << setw(16) << run(Mode::Nearest, spots, ops, t)
+             << setw(16) << run(Mode::Spread, spots, ops, t)
+             << setw(16) << run(Mode::Mutex, spots, ops, t) << endl;
+    }
+    if (double_claims.load()) {
+        cout << "\nERROR: " << double_claims.load() << " spots claimed twice\n";
+        return 1;
+    }
+    return 0;
+}
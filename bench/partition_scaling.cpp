@@ -0,0 +1,81 @@
+// Scaling report for the partitioned discrete-event engine.
+//
+// Runs the same traffic (same seed, same vehicles) over a scenario with 1, 2,
+// 4, ... worker partitions and reports wall time, simulated vehicles and
+// events per second, speedup over one partition, and how many journeys were
+// handed to another partition. The network is reloaded for every run so each
+// starts from empty intersections and lots.
+//
+//   make bench
+//   ./bench/partition_scaling [scenario] [vehicles] [max_partitions]
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <string>
+#include <thread>
+#include <cstdlib>
+using namespace std;
+
+#include "vehicle_store.h"
+#include "network.h"
+#include "controller.h"
+#include "sim_engine.h"
+
+static bool run(const string &scenario, int nVehicles, int nPartitions, PartitionStats &stats) {
+    string error;
+    if (!network_load_file(scenario, error)) {
+        cerr << error << "\n";
+        return false;
+    }
+    sim_random_seed(42);
+    if (!vehicle_store_create(nVehicles)) {
+        cerr << "cannot allocate " << nVehicles << " vehicles\n";
+        return false;
+    }
+
+    run_partitioned_simulation(g_vehicles, nPartitions, &stats);
+    vehicle_store_destroy();
+    network_destroy();
+    return true;
+}
+
+int main(int argc, char **argv) {
+    string scenario = "scenarios/grid_100x100.scn";
+    int nVehicles = 200000;
+    int maxPartitions = (int)thread::hardware_concurrency();
+    if (argc > 1) scenario = argv[1];
+    if (argc > 2) nVehicles = atoi(argv[2]);
+    if (argc > 3) maxPartitions = atoi(argv[3]);
+    if (nVehicles <= 0 || maxPartitions <= 0) {
+        cerr << "Usage: " << argv[0] << " [scenario] [vehicles] [max_partitions]\n";
+        return 1;
+    }
+
+    vector<int> counts;
+    for (int p = 1; p < maxPartitions; p *= 2) counts.push_back(p);
+    counts.push_back(maxPartitions);
+
+    cout << scenario << ", " << nVehicles << " vehicles, "
+         << thread::hardware_concurrency() << " CPUs online\n\n";
+    cout << right << setw(10) << "partitions"
+         << setw(10) << "wall s"
+         << setw(12) << "vehicles/s"
+         << setw(12) << "events/s"
+         << setw(10) << "speedup"
+         << setw(11) << "handoffs" << endl;
+
+    double base = 0.0;
+    for (int p : counts) {
+        PartitionStats stats;
+        if (!run(scenario, nVehicles, p, stats)) return 1;
+        if (base == 0.0) base = stats.wall_seconds;
+        cout << setw(10) << stats.partitions
+             << setw(10) << fixed << setprecision(2) << stats.wall_seconds
+             << setw(12) << setprecision(0) << nVehicles / stats.wall_seconds
+             << setw(12) << stats.events / stats.wall_seconds
+             << setw(9) << setprecision(2) << base / stats.wall_seconds << "x"
+             << setw(11) << stats.handoffs << endl;
+    }
+    return 0;
+}
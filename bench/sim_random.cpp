@@ -0,0 +1,95 @@
+// Random number benchmark: glibc rand() vs per-thread SimRng streams.
+//
+// Each thread draws N crossing times (uniform 1..2 s) either from rand(),
+// which every thread shares behind glibc's internal lock, or from a SimRng
+// stream of its own, and the report gives draws per second for 1, 2, 4, ...
+// threads. Then checks the reproducibility the simulation relies on: the
+// same seed gives the same vehicles, a different seed different ones.
+//
+//   make bench
+//   ./bench/sim_random [draws_per_thread] [max_threads]
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+using namespace std;
+
+#include "sim_random.h"
+#include "vehicle.h"
+#include "network.h"
+
+static atomic<long> sink(0);   // keeps the draws from being optimised away
+
+static void draw_rand(long draws) {
+    long sum = 0;
+    for (long i = 0; i < draws; ++i) sum += 1 + rand() % 2;
+    sink += sum;
+}
+
+static void draw_stream(int self, long draws) {
+    SimRng r = sim_rng_stream(SIM_STREAM_VEHICLE + self);
+    long sum = 0;
+    for (long i = 0; i < draws; ++i) sum += sim_rng_int(r, 1, 2);
+    sink += sum;
+}
+
+static double run(bool streams, long draws, int threads) {
+    auto start = chrono::steady_clock::now();
+    vector<thread> pool;
+    for (int t = 0; t < threads; ++t) {
+        if (streams) pool.emplace_back(draw_stream, t, draws);
+        else pool.emplace_back(draw_rand, draws);
+    }
+    for (thread &t : pool) t.join();
+    double secs = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    return (double)draws * threads / secs;
+}
+
+// Fingerprint of the first `count` vehicles drawn with `seed`
+static uint64_t vehicles_digest(uint64_t seed, int count) {
+    sim_random_seed(seed);
+    uint64_t h = 1469598103934665603ull;
+    for (int i = 1; i <= count; ++i) {
+        Vehicle v = make_random_vehicle(i);
+        int fields[] = {(int)v.type, (int)v.originIntersection, (int)v.destIntersection,
+                        (int)v.approach, (int)v.direction, v.wantsParking, crossing_seconds(&v)};
+        for (int f : fields) h = (h ^ (uint64_t)f) * 1099511628211ull;
+    }
+    return h;
+}
+
+int main(int argc, char **argv) {
+    long draws = 10000000;
+    int maxThreads = (int)thread::hardware_concurrency();
+    if (argc > 1) draws = atol(argv[1]);
+    if (argc > 2) maxThreads = atoi(argv[2]);
+    if (maxThreads <= 0) maxThreads = 1;
+    if (draws <= 0) {
+        cerr << "Usage: " << argv[0] << " [draws_per_thread] [max_threads]\n";
+        return 1;
+    }
+
+    cout << draws << " draws per thread\n\n";
+    cout << setw(8) << "threads" << setw(18) << "rand() draws/s" << setw(18) << "SimRng draws/s" << endl;
+    for (int t = 1; t <= maxThreads; t *= 2) {
+        cout << setw(8) << t << fixed << setprecision(0)
+             << setw(18) << run(false, draws, t)
+             << setw(18) << run(true, draws, t) << endl;
+    }
+
+    string error;
+    if (!network_load_default(error)) {
+        cerr << error << "\n";
+        return 1;
+    }
+    bool same = vehicles_digest(42, 10000) == vehicles_digest(42, 10000);
+    bool differs = vehicles_digest(42, 10000) != vehicles_digest(43, 10000);
+    network_destroy();
+    cout << "\n10000 vehicles: seed 42 twice " << (same ? "identical" : "DIFFERENT")
+         << ", seeds 42 and 43 " << (differs ? "differ" : "IDENTICAL") << "\n";
+    return same && differs ? 0 : 1;
+}
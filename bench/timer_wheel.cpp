@@ -0,0 +1,155 @@
+// Timer wheel benchmark.
+//
+//   wheel    arm N timers at random ticks up to ~1 h ahead, then advance the
+//            wheel to the end, checking that every timer comes out exactly at
+//            its own tick and in order; reports ns per insert and per expiry.
+//            Then arms N more and cancels them all (ns per cancel).
+//   service  a periodic timer on the timer service, re-armed each time at
+//            epoch + k * period; reports how late each callback ran
+//            (p50/p99/max) and how far the last one was from where it
+//            should be, i.e. whether the cycle drifts. A deadline runs at the
+//            first 1 ms tick at or after it, so up to a tick late but never
+//            early; the lateness must not grow from period to period.
+//
+//   make bench
+//   ./bench/timer_wheel [timers] [periods]
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <cstdlib>
+#include <pthread.h>
+using namespace std;
+
+#include "timer_wheel.h"
+#include "latency_histogram.h"
+
+static double seconds_since(chrono::steady_clock::time_point start) {
+    return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+static bool bench_wheel(int count) {
+    const uint64_t HORIZON = 3600 * 1000;   // ticks (ms)
+    mt19937_64 rng(42);
+    vector<TimerNode> nodes(count);
+    vector<uint64_t> due(count);
+    for (int i = 0; i < count; ++i) due[i] = 1 + rng() % HORIZON;
+
+    TimerWheel *w = new TimerWheel;
+    timer_wheel_init(*w, 0);
+    auto start = chrono::steady_clock::now();
+    for (int i = 0; i < count; ++i) {
+        timer_node_init(nodes[i]);
+        timer_wheel_add(*w, &nodes[i], due[i]);
+    }
+    double insertSecs = seconds_since(start);
+
+    // Advance in 1 s steps, as a service that wakes for every batch would
+    long expired = 0, wrong = 0;
+    uint64_t last = 0;
+    start = chrono::steady_clock::now();
+    for (uint64_t now = 1000; now <= HORIZON + 1000; now += 1000) {
+        for (TimerNode *n = timer_wheel_advance(*w, now); n; n = n->next) {
+            uint64_t want = due[n - nodes.data()];
+            if (n->expires != want || want > now || want < last) wrong++;
+            last = want;
+            expired++;
+        }
+    }
+    double expirySecs = seconds_since(start);
+
+    for (int i = 0; i < count; ++i) {
+        timer_node_init(nodes[i]);
+        timer_wheel_add(*w, &nodes[i], w->now + due[i]);
+    }
+    start = chrono::steady_clock::now();
+    for (int i = 0; i < count; ++i) timer_wheel_cancel(*w, &nodes[i]);
+    double cancelSecs = seconds_since(start);
+    bool empty = w->pending == 0 && timer_wheel_advance(*w, w->now + 2 * HORIZON) == nullptr;
+    delete w;
+
+    cout << fixed << setprecision(1)
+         << "wheel     " << count << " timers over " << HORIZON / 1000 << " s: "
+         << insertSecs * 1e9 / count << " ns/insert, "
+         << expirySecs * 1e9 / count << " ns/expiry, "
+         << cancelSecs * 1e9 / count << " ns/cancel\n"
+         << "          " << expired << " expired, " << wrong << " early/late/out of order"
+         << (empty ? "" : ", wheel NOT empty after cancel") << "\n";
+    return expired == count && wrong == 0 && empty;
+}
+
+struct Periodic {
+    TimerNode node;
+    int64_t epoch_ns;
+    int64_t period_ns;
+    int fired;
+    int periods;
+    bool finished;         // under lock
+    LatencyHistogram late;
+    int64_t last_late_ns;
+    pthread_mutex_t lock;
+    pthread_cond_t done;
+};
+
+static void periodic_fired(void *arg) {
+    Periodic &p = *(Periodic*)arg;
+    int64_t now = timer_service_clock_ns();
+    int64_t due = p.epoch_ns + (int64_t)(p.fired + 1) * p.period_ns;
+    p.last_late_ns = now - due;
+    latency_histogram_record(p.late, p.last_late_ns / 1e9);
+    if (++p.fired < p.periods) {
+        timer_service_add_at(&p.node, due + p.period_ns);
+        return;
+    }
+    pthread_mutex_lock(&p.lock);
+    p.finished = true;
+    pthread_cond_signal(&p.done);
+    pthread_mutex_unlock(&p.lock);
+}
+
+static void bench_service(int periods) {
+    Periodic p;
+    timer_node_init(p.node, periodic_fired, &p);
+    p.period_ns = 10 * 1000000;
+    p.fired = 0;
+    p.periods = periods;
+    p.finished = false;
+    p.last_late_ns = 0;
+    latency_histogram_reset(p.late);
+    pthread_mutex_init(&p.lock, NULL);
+    pthread_cond_init(&p.done, NULL);
+
+    timer_service_start();
+    pthread_mutex_lock(&p.lock);
+    p.epoch_ns = timer_service_clock_ns();
+    timer_service_add_at(&p.node, p.epoch_ns + p.period_ns);
+    while (!p.finished) pthread_cond_wait(&p.done, &p.lock);
+    pthread_mutex_unlock(&p.lock);
+    timer_service_stop();
+
+    cout << fixed << setprecision(1)
+         << "service   " << periods << " x 10 ms: late p50 "
+         << latency_histogram_percentile(p.late, 0.50) * 1e6 << " us, p99 "
+         << latency_histogram_percentile(p.late, 0.99) * 1e6 << " us, max "
+         << p.late.max_us / 1.0 << " us; last period off by "
+         << p.last_late_ns / 1000.0 << " us\n";
+    pthread_mutex_destroy(&p.lock);
+    pthread_cond_destroy(&p.done);
+}
+
+int main(int argc, char **argv) {
+    int timers = 200000;
+    int periods = 300;
+    if (argc > 1) timers = atoi(argv[1]);
+    if (argc > 2) periods = atoi(argv[2]);
+    if (timers <= 0 || periods <= 0) {
+        cerr << "Usage: " << argv[0] << " [timers] [periods]\n";
+        return 1;
+    }
+
+    bool ok = bench_wheel(timers);
+    bench_service(periods);
+    return ok ? 0 : 1;
+}
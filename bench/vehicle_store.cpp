@@ -0,0 +1,102 @@
+// Vehicle table benchmark: columnar store vs one record per vehicle.
+//
+// Spawns N vehicles (default 10M) into the table on the default network, puts
+// every vehicle into a pseudo-random state, then times a census (vehicles per
+// state) over the state column against the same census over an array of
+// whole records laid out like the old Vehicle (80 bytes, state inside), the
+// layout a sweep had to stride through before. Reports bytes per vehicle,
+// build time and sweep time per vehicle.
+//
+//   make bench
+//   ./bench/vehicle_store [vehicles] [sweeps]
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <chrono>
+#include <cstdlib>
+using namespace std;
+
+#include "vehicle_store.h"
+#include "network.h"
+
+// The record before the table: everything in one struct, 8-byte aligned
+struct WideVehicle {
+    int id;
+    int type;
+    int priority;
+    long arrival_time;
+    int origin, dest;
+    int approach, direction;
+    bool wantsParking;
+    int parking_spot;
+    uint64_t rng[4];
+    uint8_t state;
+};
+
+static double seconds_since(chrono::steady_clock::time_point start) {
+    return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char **argv) {
+    long n = 10000000;
+    int sweeps = 10;
+    if (argc > 1) n = atol(argv[1]);
+    if (argc > 2) sweeps = atoi(argv[2]);
+    if (n <= 0 || sweeps <= 0) {
+        cerr << "Usage: " << argv[0] << " [vehicles] [sweeps]\n";
+        return 1;
+    }
+
+    string error;
+    if (!network_load_default(error)) {
+        cerr << error << "\n";
+        return 1;
+    }
+    sim_random_seed(42);
+    auto start = chrono::steady_clock::now();
+    if (!vehicle_store_create((size_t)n)) {
+        cerr << "cannot map a table for " << n << " vehicles\n";
+        return 1;
+    }
+    double arrival;
+    while (vehicle_store_next(arrival)) {}
+    double buildSecs = seconds_since(start);
+
+    vector<WideVehicle> wide(n);
+    for (long i = 0; i < n; ++i) {
+        VehicleState s = (VehicleState)((i * 2654435761u >> 7) % VEHICLE_STATE_COUNT);
+        vehicle_set_state(vehicle_by_index(i), s, g_vehicles.info[i].originIntersection);
+        wide[i].state = (uint8_t)s;
+    }
+
+    uint64_t counts[VEHICLE_STATE_COUNT];
+    start = chrono::steady_clock::now();
+    for (int k = 0; k < sweeps; ++k) vehicle_store_census(counts);
+    double columnSecs = seconds_since(start) / sweeps;
+
+    uint64_t wideCounts[VEHICLE_STATE_COUNT] = {};
+    start = chrono::steady_clock::now();
+    for (int k = 0; k < sweeps; ++k) {
+        for (uint64_t &c : wideCounts) c = 0;
+        for (const WideVehicle &v : wide) wideCounts[v.state]++;
+    }
+    double wideSecs = seconds_since(start) / sweeps;
+
+    bool same = true;
+    for (int s = 0; s < VEHICLE_STATE_COUNT; ++s) same = same && counts[s] == wideCounts[s];
+
+    cout << fixed << setprecision(2)
+         << n << " vehicles: " << VEHICLE_BYTES << " bytes each in the table ("
+         << g_vehicles.arena_bytes / (1 << 20) << " MB, "
+         << (g_vehicles.huge_pages ? "huge pages" : "THP advised") << "), "
+         << sizeof(WideVehicle) << " as one record\n"
+         << "build      " << buildSecs * 1e9 / n << " ns/vehicle\n"
+         << "census     table " << columnSecs * 1e9 / n << " ns/vehicle, records "
+         << wideSecs * 1e9 / n << " ns/vehicle (" << wideSecs / columnSecs << "x)"
+         << (same ? "" : ", COUNTS DIFFER") << "\n";
+
+    vehicle_store_destroy();
+    network_destroy();
+    return same ? 0 : 1;
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <csignal>
+#include <cstdint>
+using namespace std;
+
+#include "sim_random.h"
+
+struct TrafficProfile;
+
+// Arrival process: when vehicles arrive, and from which side.
+//
+// Without rates in the scenario, one vehicle every 100-500 ms. With them,
+// open-loop Poisson arrivals: each approach is a Poisson stream of its own
+// rate, so together they are one stream of the summed rate whose arrivals
+// come from each side in proportion. `daily` factors make the rate a step
+// function of the time of day; arrival times are drawn by inverting the
+// integrated rate, exact across the steps. All draws come from the arrival
+// stream, so the schedule depends only on the seed.
+struct ArrivalProcess {
+    SimRng rng;
+    const TrafficProfile *traffic;
+    bool poisson;
+    double total_rate;          // vehicles/s over all approaches, before daily factors
+    double next;                // the upcoming arrival, seconds after the start
+};
+
+void arrival_process_init(ArrivalProcess &p, const TrafficProfile &traffic);
+
+// Time of the next arrival and the approach it comes from (-1 with fixed
+// gaps: the vehicle draws its own)
+double arrival_process_next(ArrivalProcess &p, int &approach);
+
+// Daily factor at `t` seconds after the start, and when it next changes
+double arrival_rate_factor(const TrafficProfile &traffic, double t, double &until);
+
+// Pacing of the wall-clock spawners. Each arrival waits for its own absolute
+// deadline on the monotonic clock (start + arrival time), not for a gap after
+// the previous spawn, so time spent spawning does not slow the offered load.
+// A spawner that falls behind finds its deadlines already past and releases
+// those vehicles at once until it has caught up. How late each release was
+// goes into a histogram. One spawning thread per run.
+const double ARRIVAL_BEHIND_S = 0.010;
+
+void arrival_pacer_start();
+
+// Sleep until `arrival_s` after the start; false if `shutdown` was raised first
+bool arrival_pacer_wait(double arrival_s, volatile sig_atomic_t *shutdown);
+
+// Log how far releases lagged their schedule (nothing if none were paced)
+void log_arrival_lag();
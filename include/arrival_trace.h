@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+using namespace std;
+
+#include "vehicle.h"
+
+// Arrival traces: detector logs replayed as the vehicles of a run.
+//
+// CSV, one arrival per line in time order. The first line names the columns,
+// in any order; columns it does not know are skipped:
+//   time           seconds on any origin (e.g. Unix time), or HH:MM:SS[.fff]
+//   intersection   name from the scenario, or its index
+//   approach       N/E/S/W (or North/East/South/West)
+//   type           car/bus/bike/tractor/ambulance/firetruck    (optional)
+//   turn           straight/left/right                         (optional)
+//   park           0/1                                         (optional)
+// Fields are not quoted. Blank lines and lines starting with '#' are skipped.
+// What a trace leaves out (and whether the vehicle drives on to the
+// neighbour its turn leads to) is drawn from the traffic profile with the
+// vehicle's own stream, so a trace plus a seed is still one exact run. The
+// first arrival is at 0 s.
+//
+// The file is read once, in 1 MB chunks, and never held whole: opening reads
+// the header and the first arrival, and the run streams the rest as arrivals
+// come up, checking each line as it goes. A bad line ends the arrivals there.
+// Lines are found with memchr and fields split 16 bytes at a time with SSE2
+// compares; ./bench/arrival_trace measures the stream against a plain read()
+// of the file.
+//
+//   traffic_sim --trace=<file> [--scenario=FILE]
+
+const int TRACE_MAX_COLUMNS = 32;
+
+struct ArrivalTrace {
+    string path;
+    int fd = -1;
+    char *buf = nullptr;        // [TRACE_CHUNK + padding]
+    size_t len = 0, pos = 0;    // unread bytes are buf[pos, len)
+    bool eof = false;
+    uint64_t line = 0;          // of the last line read
+
+    int column[6] = {};         // field index of time, intersection, approach, type, turn, park (-1: absent)
+    int columns = 0;            // fields in the header
+    unordered_map<string_view, int> ids;   // intersection name (in g_network) -> id
+
+    size_t max_arrivals = 0;    // bound from the file size (sizes the vehicle table)
+    size_t arrivals = 0;        // read so far
+    double first_time = 0.0;    // time of the first arrival, as written
+    double last_time = 0.0;     // of the last one read
+};
+
+// Open `path` and check its header and first arrival against the loaded
+// network. On failure nothing stays open and `error` says why
+// ("file:line: message"). `t` must not already be open.
+bool arrival_trace_open(const string &path, ArrivalTrace &t, string &error);
+void arrival_trace_close(ArrivalTrace &t);
+
+// The next arrival in the file as vehicle `id`, with its time in seconds
+// after the first. False at the end, or at a line that does not parse or
+// runs back in time (`error` then says how).
+bool arrival_trace_next(ArrivalTrace &t, int id, Vehicle &v, double &arrival_s, string &error);
@@ -1,29 +1,53 @@
 #pragma once
 #include <unistd.h>
 #include <string>
+#include <vector>
 using namespace std;
 
 #include "vehicle.h"
-
-// Message types controller will send/receive
-enum class ControllerSignal {
-    NORMAL,
-    EMERGENCY_INCOMING,
-    SHUTDOWN
-};
+#include "controller_ipc.h"
 
 struct Controller {
     string name;
-    int read_fd;   // read-end of pipe
-    int write_fd;  // write-end of pipe (to other controller, if needed)
+    IntersectionId intersection;          // the one its road channels lead to
+    vector<ControllerChannel*> inboxes;   // every channel into this controller
+    vector<IntersectionId> signals;       // signal plans it owns on the board (may be none)
 };
 
-// Global pipes (defined in main.cpp)
-extern int pipeF10toF11[2];   // [0]=read, [1]=write
-extern int pipeF11toF10[2];   // [0]=read, [1]=write
+// Controller processes run for the first CONTROLLER_COUNT intersections of
+// the network. Controller k has one inbound channel for control messages
+// from the parent (controller_channels[k]) and one per road arriving at its
+// intersection (controller_road_channels[k], in the network's in-link
+// order), which carries alerts about traffic coming down that road.
+const int CONTROLLER_COUNT = 2;
+
+// Emergency alerts that reach a controller within this long of the one it
+// last acted on are coalesced into it
+const int EMERGENCY_COALESCE_MS = 500;
+
+// Global channels (defined in controller.cpp)
+extern ControllerChannel controller_channels[CONTROLLER_COUNT];
+extern vector<ControllerChannel> controller_road_channels[CONTROLLER_COUNT];
 
+// Parent, before fork(): create / after the controllers exit: close the
+// channels of controller k
+bool open_controller_channels(int k, IpcBackend backend);
+void close_controller_channels(int k);
+
+// Child, after fork(): the controller for intersection k
+Controller make_controller(int k);
+
+// Event loop: waits in epoll on every inbox plus a timerfd armed for the next
+// light change of ctrl.signals (kept on a timer wheel), until SHUTDOWN
+// arrives or every inbox is closed. Each change is published to the signal
+// board as the signals' plans give it; emergency alerts
+// and all-clears set and clear preemption there.
 void run_controller(Controller ctrl);
 string signal_name(ControllerSignal s);
 
 // Called by parent/vehicles when an emergency vehicle moves
-void notify_emergency_from_to(IntersectionId from, IntersectionId to);
+void notify_emergency_from_to(IntersectionId from, IntersectionId to, int vehicleId);
+
+// emergency_preempt_forward while the controllers own the signal board:
+// preemption changes go to the owning controller instead of the intersection
+bool controller_preempt_forward(IntersectionId id, bool enabled);
@@ -0,0 +1,112 @@
+#pragma once
+
+#include <pthread.h>
+#include <atomic>
+#include <cstdint>
+using namespace std;
+
+// Message types controller will send/receive
+enum class ControllerSignal : uint8_t {
+    NORMAL,
+    EMERGENCY_INCOMING,
+    SHUTDOWN,
+    EMERGENCY_CLEARED      // the emergency vehicle has crossed dst
+};
+
+// Wire format. Every message is one fixed 32-byte record in host byte order
+// (both ends are the same binary on the same machine); a batch is simply
+// consecutive records, written in one go. The sender stamps `seq` (per
+// channel, from 0) and `sent_ns`; receivers drop records whose version
+// they do not speak.
+const uint8_t CONTROLLER_WIRE_VERSION = 1;
+
+struct ControllerMessage {
+    uint8_t version;       // CONTROLLER_WIRE_VERSION
+    ControllerSignal type;
+    uint16_t flags;        // reserved, 0
+    uint32_t seq;
+    int32_t src;           // IntersectionId, -1 = the parent process
+    int32_t dst;           // IntersectionId
+    int32_t vehicle;       // vehicle id, 0 = none
+    uint32_t reserved;
+    int64_t sent_ns;       // CLOCK_MONOTONIC, shared by every process
+};
+static_assert(sizeof(ControllerMessage) == 32, "wire records are 32 bytes");
+
+inline ControllerMessage controller_message(ControllerSignal type, int src, int dst, int vehicle = 0) {
+    ControllerMessage m = {};
+    m.version = CONTROLLER_WIRE_VERSION;
+    m.type = type;
+    m.src = src;
+    m.dst = dst;
+    m.vehicle = vehicle;
+    return m;
+}
+
+// Same clock as sent_ns
+int64_t channel_clock_ns();
+
+// One-way message channel into a controller process, set up before fork().
+//
+// Pipe: one write() per batch (split at PIPE_BUF so each stays atomic) and
+// one read() per batch.
+// SharedRing: a single-producer/single-consumer ring in a MAP_SHARED mapping.
+// Sending is a store plus a release of the tail, and no syscall at all while
+// the consumer is busy. A consumer that finds the ring empty announces that
+// it sleeps and blocks on an eventfd; only a producer that sees the
+// announcement pays for the write() that wakes it.
+// Either way the sending process's threads are serialised by a process-local
+// lock, so a batch is never interleaved and the ring only ever has one
+// producer.
+
+enum class IpcBackend {
+    Pipe,
+    SharedRing
+};
+
+const uint32_t SHM_RING_CAPACITY = 4096;   // messages, power of two
+
+struct ShmRing {
+    alignas(64) atomic<uint32_t> head;               // next to read  (consumer)
+    alignas(64) atomic<uint32_t> tail;               // next to write (producer)
+    alignas(64) atomic<uint32_t> consumer_sleeping;  // consumer is (about to be) blocked on the eventfd
+    ControllerMessage slots[SHM_RING_CAPACITY];
+};
+
+struct ControllerChannel {
+    bool open;                  // false until channel_open (a zeroed channel drops sends)
+    IpcBackend backend;
+    int fds[2];                 // Pipe: [0]=read, [1]=write
+    ShmRing *ring;              // SharedRing: the shared mapping
+    int event_fd;               // SharedRing: wakes a sleeping consumer
+    pthread_mutex_t send_lock;  // one producer at a time (sender side only)
+    uint32_t next_seq;          // sender side, under send_lock
+};
+
+// Create the channel; call before fork() so both processes share it
+bool channel_open(ControllerChannel &ch, IpcBackend backend);
+void channel_close(ControllerChannel &ch);
+
+// Queue messages, stamping version, seq and sent_ns (the caller fills in
+// type, src, dst and vehicle). A full ring waits for the consumer, like a
+// full pipe.
+bool channel_send_batch(ControllerChannel &ch, const ControllerMessage *msgs, int n);
+bool channel_send(ControllerChannel &ch, const ControllerMessage &msg);
+
+// Take up to `max` waiting messages without blocking. Returns the number
+// taken; 0 when there are none, in which case channel_wait_fd() becomes
+// readable once more arrive; -1 once the sending side is gone or on error.
+int channel_try_receive(ControllerChannel &ch, ControllerMessage *out, int max);
+
+// Descriptor to poll/epoll for readability (the pipe or the eventfd)
+int channel_wait_fd(const ControllerChannel &ch);
+
+// Blocking form of channel_try_receive: waits for at least one message.
+// Returns the number taken, or -1 once the sending side is gone or on error.
+int channel_receive(ControllerChannel &ch, ControllerMessage *out, int max);
+
+// In the receiving process after fork(): drop its copy of the sending end,
+// so that a pipe reports end of file once the sender is gone
+void channel_close_send_end(ControllerChannel &ch);
+
+const char* ipc_backend_name(IpcBackend backend);
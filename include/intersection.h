@@ -2,9 +2,12 @@
 
 #include <string>
 #include <pthread.h>
+#include <cstdint>
 using namespace std;
 
 #include "vehicle.h"
+#include "wait_list.h"
+#include "latency_histogram.h"
 
 // Simple traffic light colors
 enum class LightColor {
@@ -12,12 +15,26 @@ enum class LightColor {
     GREEN
 };
 
+// Movements through the box: one slot per (approach, direction) pair
+const int MOVEMENT_SLOTS = 4 * 3;
+
+inline int movement_slot(const Vehicle *v) {
+    return (int)v->approach * 3 + (int)v->direction;
+}
+
+// How blocked vehicle threads learn that they may enter
+enum class WakePolicy {
+    Targeted,   // wait queues below; only admitted vehicles are signalled (default)
+    Broadcast   // every state change wakes every blocked thread to re-check
+                // (the original scheme, kept for bench/intersection_contention)
+};
+
 // Simple intersection model
 struct Intersection {
     IntersectionId id;
 
     pthread_mutex_t lock;     // to protect state
-    pthread_cond_t canPass;   // condition variable for waiting
+    pthread_cond_t canPass;   // WakePolicy::Broadcast only
     bool busy;                // true if a vehicle is currently in intersection
 
     LightColor light;         // current signal color for this intersection
@@ -25,32 +42,81 @@ struct Intersection {
     // Emergency preemption flag: when true, non-emergency vehicles must wait
     volatile bool emergency_preempt;
 
-    // Concurrent movement tracking (conservative): allow Straight+Straight only
-    int active_count;         // number of vehicles currently inside
-    bool active_straight;
-    bool active_left;
-    bool active_right;
-};
+    // Conflict matrix: bit t of conflicts[s] is set when movement slots s and
+    // t may not be in the box together
+    uint16_t conflicts[MOVEMENT_SLOTS];
 
-// Global intersections (defined in intersection.cpp)
-extern Intersection F10_intersection;
-extern Intersection F11_intersection;
+    // Occupancy: bit s set while any vehicle of slot s is inside. The count
+    // per slot lets vehicles of one movement leave in any order.
+    uint16_t occupied;
+    int slot_count[MOVEMENT_SLOTS];
+
+    // Admission queue: one FIFO per (priority level, movement slot). After every
+    // state change the waiters that may cross are admitted under `lock` by
+    // priority (with aging) then arrival, and only they are woken. Blocked
+    // threads and suspended journeys share these queues.
+    WaitList waiting[PRIORITY_LEVELS][MOVEMENT_SLOTS];
+    int queued;                  // vehicles across all queues
+    unsigned long next_ticket;   // arrival order across the queues
+    double (*clock)();           // seconds; wall clock, or sim_now under the DES
+
+    WakePolicy wake_policy;
+
+    // Contention counters (under lock)
+    unsigned long wakeups;       // waiting vehicles woken, spurious ones included
+    unsigned long admissions;    // vehicles that entered
+    LatencyHistogram *wait_time;   // [PRIORITY_LEVELS] queueing delay before entry (kept out of line)
+};
 
 // Functions to manage intersections
 void init_intersection(Intersection &I, IntersectionId id);
 
+// Conflict matrix of a four-way crossing with right-hand traffic: two movements
+// conflict when their paths cross or they leave on the same exit. Opposing
+// straights, opposing lefts and most right turns can share the box.
+void four_way_conflicts(uint16_t conflicts[MOVEMENT_SLOTS]);
+
 void enter_intersection(Intersection &I, Vehicle *v);
 
+// Non-blocking variant for suspended journeys: enters and returns true if the
+// vehicle may cross now, otherwise queues `node` for its movement and returns
+// false. node->wake fires once the vehicle has been admitted (it is then inside).
+bool try_enter_or_park(Intersection &I, Vehicle *v, WaitNode *node);
+
+// Forget queued journeys whose storage is about to go away (pool shutdown)
+void drop_suspended_journeys(Intersection &I);
+
+// Log p50/p99/max wait before entry per priority level: for each intersection
+// of a small network, otherwise merged over the whole network
+void log_admission_metrics();
+
+// Default Intersection::clock (CLOCK_MONOTONIC seconds)
+double intersection_wall_clock();
+
 void leave_intersection(Intersection &I, Vehicle *v);
 
 string intersection_name(IntersectionId id);
 
+// Seconds each light phase is held
+const int LIGHT_PHASE_SECONDS = 3;
+
+// Waiting this long (one full light cycle) counts as one priority level in
+// admission order
+const double ADMISSION_AGING_SECONDS = 2 * LIGHT_PHASE_SECONDS;
+
 // Traffic light control (implemented in intersection.cpp)
 void start_traffic_lights();
 void stop_traffic_lights();
+// Change a single light and wake waiters (also used by the discrete-event engine)
+void set_light(Intersection &I, LightColor color, const char *label);
 // Cleanup resources for intersections
 void destroy_intersection(Intersection &I);
 
 // Emergency preemption controls
 void set_emergency_preempt(IntersectionId id, bool enabled);
 bool is_emergency_preempt(IntersectionId id);
+
+// Installed by engines that run intersections on several threads: forwards a
+// preemption change for an intersection owned by another thread and returns
+// true, or returns false to apply it on the calling thread
+extern bool (*emergency_preempt_forward)(IntersectionId id, bool enabled);
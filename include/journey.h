@@ -0,0 +1,46 @@
+#pragma once
+
+#include <coroutine>
+using namespace std;
+
+#include "vehicle.h"
+#include "wait_list.h"
+
+// Vehicle lifecycle as a C++20 coroutine (task-pool and discrete-event modes).
+// Entering an intersection, waiting for a parking spot and crossing/parking
+// time are co_await points, so a waiting vehicle costs one small coroutine
+// frame instead of a thread stack. Waiting journeys sit on the intrusive wait
+// lists of Intersection/ParkingLot and are resumed only once granted.
+
+struct VehicleJourney;
+
+// How an executor resumes suspended journeys
+struct JourneyHost {
+    void (*resume)(VehicleJourney *j);                       // resume soon (granted by a wait list)
+    void (*resume_after)(VehicleJourney *j, double seconds); // resume after a delay
+    void (*finished)(VehicleJourney *j);
+    // Optional: drive to `to` and resume there after `seconds`, possibly on
+    // another thread. Without it journeys end at their origin intersection.
+    void (*travel)(VehicleJourney *j, IntersectionId to, double seconds);
+};
+
+struct VehicleJourney {
+    Vehicle *v;
+    const JourneyHost *host;
+    void *host_data;            // executor-private (e.g. its task handle)
+    coroutine_handle<> handle;  // the suspended lifecycle coroutine
+    WaitNode node;              // on an Intersection::waiting queue or ParkingLot::parked while waiting
+};
+
+// Create the journey's coroutine, suspended before its first step;
+// the host starts it with journey_resume()
+void journey_init(VehicleJourney &j, Vehicle *v, const JourneyHost *host, void *host_data);
+
+// Run the journey until its next co_await (or to completion)
+inline void journey_resume(VehicleJourney *j) {
+    j->handle.resume();
+}
+
+// Free the frame of a journey that never finished (early shutdown).
+// Only valid while nothing can resume it.
+void journey_destroy(VehicleJourney &j);
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <cmath>
+
+// Fixed-size log-linear histogram of durations (microsecond resolution).
+// Values below 8us are exact; above that every power of two is split into
+// 8 buckets, so a reported percentile is within ~12% of the true value.
+// Durations are capped at 2^40us (~12 days). Recording is O(1) and never
+// allocates; one histogram is ~1.2KB. Not thread-safe: guard it with the
+// owner's lock.
+
+const int LATENCY_SUB_BITS = 3;
+const int LATENCY_MAX_EXP = 39;
+const int LATENCY_BUCKETS = (LATENCY_MAX_EXP - LATENCY_SUB_BITS + 2) << LATENCY_SUB_BITS;
+
+struct LatencyHistogram {
+    uint32_t counts[LATENCY_BUCKETS];
+    uint64_t total;
+    uint64_t max_us;
+};
+
+inline void latency_histogram_reset(LatencyHistogram &h) {
+    memset(&h, 0, sizeof(h));
+}
+
+inline int latency_bucket(uint64_t us) {
+    const uint64_t sub = 1u << LATENCY_SUB_BITS;
+    if (us < sub) return (int)us;
+    if (us >> (LATENCY_MAX_EXP + 1)) us = ((uint64_t)1 << (LATENCY_MAX_EXP + 1)) - 1;
+    int e = 63 - __builtin_clzll(us);   // >= LATENCY_SUB_BITS
+    int shift = e - LATENCY_SUB_BITS;
+    return (int)(((uint64_t)(shift + 1) << LATENCY_SUB_BITS) + ((us >> shift) & (sub - 1)));
+}
+
+// Largest value that falls into bucket `b`
+inline uint64_t latency_bucket_upper(int b) {
+    const int sub = 1 << LATENCY_SUB_BITS;
+    if (b < sub) return (uint64_t)b;
+    int shift = (b >> LATENCY_SUB_BITS) - 1;
+    uint64_t lower = (uint64_t)(sub + (b & (sub - 1))) << shift;
+    return lower + ((uint64_t)1 << shift) - 1;
+}
+
+inline void latency_histogram_record(LatencyHistogram &h, double seconds) {
+    uint64_t us = seconds > 0 ? (uint64_t)(seconds * 1e6) : 0;
+    h.counts[latency_bucket(us)]++;
+    h.total++;
+    if (us > h.max_us) h.max_us = us;
+}
+
+inline void latency_histogram_merge(LatencyHistogram &into, const LatencyHistogram &h) {
+    for (int b = 0; b < LATENCY_BUCKETS; ++b) into.counts[b] += h.counts[b];
+    into.total += h.total;
+    if (h.max_us > into.max_us) into.max_us = h.max_us;
+}
+
+// p in [0, 1]; returns seconds
+inline double latency_histogram_percentile(const LatencyHistogram &h, double p) {
+    if (h.total == 0) return 0.0;
+    uint64_t rank = (uint64_t)ceil(p * h.total);   // nearest-rank
+    if (rank < 1) rank = 1;
+    uint64_t seen = 0;
+    for (int b = 0; b < LATENCY_BUCKETS; ++b) {
+        seen += h.counts[b];
+        if (seen >= rank) {
+            uint64_t us = latency_bucket_upper(b);
+            return (us < h.max_us ? us : h.max_us) / 1e6;
+        }
+    }
+    return h.max_us / 1e6;
+}
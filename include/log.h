@@ -0,0 +1,123 @@
+#pragma once
+
+#include <cstdint>
+#include <initializer_list>
+using namespace std;
+
+// Asynchronous simulation log.
+//
+// Producers never format and never take a shared lock: each thread appends
+// fixed-size binary records to its own single-producer/single-consumer ring.
+// One background thread collects the rings, orders records by timestamp,
+// renders them with the ANSI colours and writes the text out in large batches.
+//
+// Verbosity is fixed at compile time (-DLOG_MIN_LEVEL=0..3); calls below it
+// are discarded by `if constexpr` and cost nothing on the hot path.
+
+enum class LogLevel : uint8_t {
+    Debug = 0,
+    Info  = 1,
+    Warn  = 2,
+    Error = 3
+};
+
+#ifndef LOG_MIN_LEVEL
+#define LOG_MIN_LEVEL 1   // Info
+#endif
+
+// What happened. Arguments per event are listed next to each entry;
+// `text` must point at storage that outlives the logger (literals, lot names).
+enum class LogEvent : uint16_t {
+    // vehicles                      args
+    VehicleSpawned,              // id, type, origin, dest, direction, wantsParking
+    VehicleParkingPassThrough,   // id
+    VehicleApproaching,          // id, intersection, approach, direction
+    VehicleArrived,              // id, from, to
+    VehicleCompleted,            // id
+    VehicleStoreReady,           // vehicles, bytes per vehicle, arena MB, huge pages
+    VehicleCensus,               // pending, waiting, crossing, parked, driving, done
+    TraceReadFailed,             // first vehicle not read, line; text: trace file
+    ArrivalLag,                  // arrivals, offered per hour, lag p50/p99/max us, behind
+
+    // intersections
+    IntersectionEntered,         // id, type, intersection, light
+    IntersectionConcurrent,      // intersection, activeCount
+    IntersectionExited,          // id, type, intersection
+    IntersectionWaitStats,       // intersection (-1 = all), priority, admissions, p50 ms, p99 ms, max ms; text = level name
+    LightChanged,                // intersection, light; text = label
+    LightManagerStarted,         // planGroups
+    LightManagerStopped,
+    SignalFollowerStarted,       // controllers, planGroups
+    SignalFollowerStopped,
+
+    // parking                       (text = lot name)
+    ParkingRequested,            // id
+    ParkingPreemptSkip,          // id
+    ParkingQueueFull,            // id
+    ParkingQueued,               // id
+    ParkingWaiting,              // id
+    ParkingReserved,             // id, occupied, capacity, level, spot
+    ParkingParked,               // id
+    ParkingLeft,                 // id, occupied, capacity
+    ParkingDeparturesDue,        // count
+    ParkingManagerStopped,       // departures, batches, peakParked
+    ParkingGaveUp,               // id, waited ms
+    ParkingWaitStats,            // lot (-1 = all), granted, gave up, p50 ms, p99 ms, max ms
+    ParkingQueueStats,           // lot (-1 = all), joined, p50 length, p99 length, max length, capacity
+
+    // controllers                   (text = controller name)
+    EmergencyNotified,           // from, to
+    ControllerOnline,
+    ControllerReceived,          // signal, src (-1 = parent), vehicle, seq
+    ControllerEmergency,         // src, vehicle
+    ControllerEmergencyCoalesced,// src, vehicle
+    ControllerPreemptCleared,    // intersection
+    ControllerShutdown,
+    ControllerTick,              // signals, light
+    ControllerInboxClosed,       // inbox index
+    ControllerBadMessage,        // inbox index, version, seq
+    ControllerSequenceGap,       // inbox index, expected seq, received seq
+    ControllerIpcStats,          // messages, p50 us, p99 us, max us, emergencies, coalesced
+
+    // engines
+    DesStarted,                  // phaseSeconds
+    DesFinished,                 // events, stillWaiting; x0 = virtual s, x1 = wall s
+    PoolStarted,                 // workers
+    PoolStopped,                 // unfinished
+    PartitionsStarted,           // partitions, intersections, phaseSeconds; x0 = lookahead s
+    PartitionsFinished,          // events, handoffs, stillWaiting; x0 = virtual s, x1 = wall s
+
+    // system (main)
+    SystemSpawning,              // vehicles (-1: all of a trace)
+    SystemAllCompleted,
+    SystemCleanupIntersections,
+    SystemCleanupParking
+};
+
+// One cache line per record
+struct LogRecord {
+    uint64_t ns;          // CLOCK_MONOTONIC at the call site
+    LogEvent event;
+    LogLevel level;
+    int32_t arg[6];
+    double x[2];
+    const char *text;
+};
+
+// Start/stop the writer thread. log_stop() drains everything first.
+// Forked processes start their own writer. Records logged while no writer
+// runs are formatted and written synchronously.
+void log_start();
+void log_stop();
+
+// Append a record to the calling thread's ring (use log_event instead)
+void log_push(LogEvent event, LogLevel level, std::initializer_list<int32_t> args,
+              const char *text, double x0, double x1);
+
+template <LogLevel L>
+inline void log_event(LogEvent event, std::initializer_list<int32_t> args = {},
+                      const char *text = nullptr, double x0 = 0.0, double x1 = 0.0) {
+    if constexpr ((int)L >= LOG_MIN_LEVEL) {
+        log_push(event, L, args, text, x0, x1);
+    }
+}
@@ -0,0 +1,162 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+using namespace std;
+
+#include "vehicle.h"
+#include "intersection.h"
+#include "parking.h"
+
+// Road network loaded from a scenario file. Intersections, parking lots and
+// roads live in contiguous arrays indexed by integer id, so every lookup on
+// the simulation paths is O(1). The arrays are sized once by the loader and
+// never reallocated (intersections and lots hold mutexes).
+//
+// Scenario format, one directive per line, '#' starts a comment:
+//   intersection <name> [light_group]       light_group 0/1: green in the first/second half of the cycle
+//   plan <intersection> <green_s> <red_s> [offset_s]
+//                                            own signal plan instead of the light group's: the
+//                                            first green starts offset_s after time 0
+//   road <from> <to> <N|E|S|W>               one-way road arriving on that side of <to>
+//   parking <intersection> <spots> <queue> [levels]
+//                                            parking lot attached to an intersection, its
+//                                            spots spread over `levels` storeys (default 1)
+//   grid <rows> <cols> [<spots> <queue>]     city grid named R<r>C<c> with two-way roads
+//                                            (row 0 is the northernmost), optionally a lot at each node
+//
+// and, to shape the traffic (see TrafficProfile for the defaults):
+//   mix <ambulance> <fire_truck> <bus> <car> <bike> <tractor>   relative weights of vehicle types
+//   turns <straight> <left> <right>          relative weights of turns
+//   through <probability>                    share of vehicles that drive on to a neighbour
+//   park <probability>                       share of parking-capable vehicles that want to park
+//   crossing <min_s> <max_s>                 time to cross an intersection, uniform whole seconds
+//   dwell <min_s> <max_s>                    time parked, uniform whole seconds
+//   rate [N|E|S|W] <vehicles_per_s>          Poisson arrivals instead of 100-500 ms gaps: the total
+//                                            rate split evenly over the approaches, or one approach's
+//   daily <HH:MM> <factor>                   from that time of day on, every rate times factor
+//   start <HH:MM>                            time of day the run starts at (default 00:00)
+
+// Fixed-time signal plan: green for green_ms, then red for red_ms, repeating,
+// with a green starting at offset_ms. Times are ms since the cycle's common
+// start. Light group 0 is {phase, phase, 0}, group 1 {phase, phase, phase}.
+struct SignalPlan {
+    int green_ms;
+    int red_ms;
+    int offset_ms;
+};
+
+inline int64_t signal_plan_position(const SignalPlan &p, int64_t ms) {
+    int64_t cycle = p.green_ms + p.red_ms;
+    return (((ms - p.offset_ms) % cycle) + cycle) % cycle;
+}
+
+inline bool signal_plan_green(const SignalPlan &p, int64_t ms) {
+    return signal_plan_position(p, ms) < p.green_ms;
+}
+
+// First time after `ms` at which the light changes
+inline int64_t signal_plan_next_change(const SignalPlan &p, int64_t ms) {
+    int64_t t = signal_plan_position(p, ms);
+    return ms + (t < p.green_ms ? p.green_ms - t : p.green_ms + p.red_ms - t);
+}
+
+// Intersections that share one plan switch together, so one timer serves them all
+struct SignalPlanGroup {
+    SignalPlan plan;
+    vector<IntersectionId> members;
+};
+
+// Time-of-day rate factor, in effect from `from_s` (seconds after midnight)
+// until the next period's start
+struct RatePeriod {
+    double from_s;
+    double factor;
+};
+
+// Distributions vehicles are drawn from (per-vehicle streams, see sim_random.h)
+// and the arrival process (see arrival_process.h)
+struct TrafficProfile {
+    uint32_t type_weight[6] = {1, 1, 1, 1, 1, 1};   // by VehicleType
+    uint32_t turn_weight[3] = {1, 1, 1};            // by Direction
+    double through_probability = 0.5;
+    double parking_probability = 0.5;
+    int crossing_min_s = 1, crossing_max_s = 2;
+    int dwell_min_s = 1, dwell_max_s = 3;
+    double approach_rate[4] = {0, 0, 0, 0};   // vehicles/s by Approach; all 0: 100-500 ms gaps
+    vector<RatePeriod> daily;                 // sorted by from_s; empty: the rates all day
+    double start_of_day_s = 0;                // time of day the run starts at
+};
+
+// One-way road from `from` into `to`, arriving on `to`'s `approach` side
+struct RoadLink {
+    IntersectionId from;
+    IntersectionId to;
+    Approach approach;
+};
+
+struct Network {
+    vector<string> names;              // by IntersectionId
+    vector<uint8_t> light_group;       // by IntersectionId
+    vector<SignalPlan> plans;          // by IntersectionId
+    vector<Intersection> intersections;
+    vector<int> parking_of;            // lot index by IntersectionId, -1 if none
+    vector<ParkingLot> parking;
+
+    // Roads in compressed adjacency form: the roads leaving intersection i are
+    // links[out_begin[i] .. out_begin[i+1]), the ones entering it are
+    // links[in_link[k]] for k in [in_begin[i], in_begin[i+1]).
+    vector<RoadLink> links;            // sorted by `from`
+    vector<int> out_begin;
+    vector<int> in_begin;
+    vector<int> in_link;
+
+    TrafficProfile traffic;
+};
+
+extern Network g_network;
+
+// Driving time along any road (the scenario format has no road lengths yet)
+const double ROAD_TRAVEL_SECONDS = 10.0;
+
+inline int intersection_count() {
+    return (int)g_network.intersections.size();
+}
+
+inline Intersection& intersection_at(IntersectionId id) {
+    return g_network.intersections[(int)id];
+}
+
+// Parking lot attached to an intersection, or nullptr
+inline ParkingLot* parking_at(IntersectionId id) {
+    int p = g_network.parking_of[(int)id];
+    return p < 0 ? nullptr : &g_network.parking[p];
+}
+
+// Road from `from` straight to `to`, or nullptr
+inline const RoadLink* find_road(IntersectionId from, IntersectionId to) {
+    for (int k = g_network.out_begin[(int)from]; k < g_network.out_begin[(int)from + 1]; ++k) {
+        if (g_network.links[k].to == to) return &g_network.links[k];
+    }
+    return nullptr;
+}
+
+// Load a scenario file / the built-in two-intersection F10 & F11 scenario and
+// initialise every intersection and lot. On failure nothing is loaded and
+// `error` says why ("file:line: message").
+bool network_load_file(const string &path, string &error);
+bool network_load_default(string &error);
+
+// Tear down what the loader initialised
+void network_destroy();
+
+// Group `ids` by identical signal plan (cycle offsets compared modulo the cycle)
+vector<SignalPlanGroup> signal_plan_groups(const vector<IntersectionId> &ids);
+vector<SignalPlanGroup> signal_plan_groups(int first, int end);
+
+// Set every light of `group` to what its plan shows at `ms`
+void set_group_lights(const SignalPlanGroup &group, int64_t ms, const char *label);
+
+// "F10 & F11" for small networks, "10000" otherwise
+string network_summary();
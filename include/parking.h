@@ -1,41 +1,109 @@
 #pragma once
 
-#include <semaphore.h>
 #include <pthread.h>
+#include <atomic>
 #include <string>
+#include <vector>
 using namespace std;
 
 #include "vehicle.h"
+#include "wait_list.h"
+#include "spot_map.h"
+#include "latency_histogram.h"
 
-// Parking lot attached to an intersection
+// A vehicle waiting for a spot gives up after this long (blocked threads)
+const double PARKING_PATIENCE_SECONDS = 5.0;
+
+// Parking lot attached to an intersection.
+//
+// Admission is a bounded FIFO queue: a vehicle first takes a queue position
+// (queue_room), then a spot permit (free_spots). Both are atomics taken with
+// a CAS, so a vehicle that finds a spot free never touches the lock. One that
+// does not join `parked` under state_lock. A releaser hands its permit
+// straight to the head of `parked` (the waiter is granted before it is woken,
+// never woken to retry), and only returns it to free_spots when nobody waits;
+// so free_spots > 0 implies an empty queue and a newcomer cannot overtake.
+// Blocked threads sleep on a futex word of their own and leave the queue at
+// their deadline. Which spot a vehicle then takes is the spot map's business.
 struct ParkingLot {
     string name;
+    IntersectionId intersection;   // the one it is attached to
 
     int max_spots;     // total parking spots
     int max_queue;     // max waiting queue size
+    int levels;        // storeys the spots are spread over
 
-    sem_t available_spots;   // semaphore: free parking spots
-    sem_t waiting_slots;     // semaphore: free positions in waiting queue
+    atomic<int> free_spots;      // spot permits nobody holds
+    atomic<int> queue_room;      // free positions in the waiting queue
 
-    pthread_mutex_t state_lock;  // for debug counters
+    pthread_mutex_t state_lock;  // the queue, counters and metrics
     int current_spots;           // how many cars are currently parked
-};
 
-// Global parking lots (one per intersection)
-extern ParkingLot F10_parking;
-extern ParkingLot F11_parking;
+    SpotMap spot_map;            // which spots are taken
 
-// Initialize parking lot with given name, spots, queue size
+    WaitList parked;             // vehicles holding a queue position, waiting for a spot (FIFO)
+    int queued;                  // length of `parked`
+
+    // Metrics, under state_lock
+    double (*clock)();               // seconds; wall clock, or sim_now under the DES
+    LatencyHistogram wait_time;      // joining the queue -> granted a spot
+    vector<uint32_t> queue_length;   // [max_queue]: vehicles already waiting when one joined
+    int gave_up;                     // left the queue at their deadline
+};
+
+// Initialize parking lot with given name, spots, queue size and levels
 void init_parking_lot(ParkingLot &lot, const string &name,
-                      int spots = 10, int queueSize = 5);
+                      int spots = 10, int queueSize = 5, int levels = 1);
+
+// Outcome of a non-blocking reservation attempt
+enum class ParkingReservation {
+    Reserved,   // vehicle holds a spot
+    Queued,     // vehicle holds a waiting-queue slot but no spot yet
+    Skipped     // queue full or emergency preemption active
+};
 
-// Try to reserve a parking spot for a vehicle.
-// Returns true if vehicle successfully reserved a spot,
-// false if waiting queue was full (vehicle skips parking).
+// Try to reserve a parking spot for a vehicle. A reserved vehicle holds the
+// free spot nearest the entrance, in v->parking_spot.
+// Returns true if vehicle successfully reserved a spot, false if the waiting
+// queue was full or it waited PARKING_PATIENCE_SECONDS in vain (vehicle
+// skips parking).
 bool reserve_parking_spot(ParkingLot &lot, Vehicle *v);
 
-// Simulate staying in parking and then release the spot.
-void use_and_release_parking(ParkingLot &lot, Vehicle *v);
+// --- Non-blocking building blocks (task-pool and discrete-event modes) ---
+
+// Like reserve_parking_spot() but never waits for a spot.
+ParkingReservation try_reserve_parking_spot(ParkingLot &lot, Vehicle *v);
+
+// Move a Queued vehicle onto a free spot. If the lot is still full, parks
+// `node` on lot.parked and returns false; the next release hands its spot
+// directly to the first parked node before waking it.
+bool claim_or_park_parking_spot(ParkingLot &lot, Vehicle *v, WaitNode *node);
+
+// Mark a reserved vehicle as parked / give its spot back.
+void park_vehicle(ParkingLot &lot, Vehicle *v);
+void release_parking_spot(ParkingLot &lot, Vehicle *v);
+// Give back the spots of `n` vehicles at once (one pass over the lot's lock)
+void release_parking_spots(ParkingLot &lot, Vehicle *const *vs, int n);
+
+// --- Parking manager (real-time mode) ---
+// A parked vehicle needs no thread of its own: its departure time goes into
+// one min-heap shared by every lot, and a single timer on the timer service
+// (which must be running) fires when the earliest is due. Everything due by
+// then is released in one batch, per lot, after which `done` runs for each
+// vehicle on the timer service thread.
+void parking_manager_start();
+// Waits until every pending departure has been released
+void parking_manager_stop();
+
+// Park `v` (holding a reserved spot) for `seconds`, then release its spot
+// and call done(v)
+void park_until_departure(ParkingLot &lot, Vehicle *v, double seconds, void (*done)(Vehicle *v));
+
+// Random parking dwell duration
+int parking_seconds(Vehicle *v);
 
 // Cleanup parking resources
 void destroy_parking_lot(ParkingLot &lot);
+
+// Log per-lot (or, for big networks, merged) queue wait and length statistics
+void log_parking_metrics();
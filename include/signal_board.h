@@ -0,0 +1,53 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+using namespace std;
+
+#include "vehicle.h"
+
+// Signal state shared between the controller processes, which own it, and the
+// simulation, which only reads it.
+//
+// Controller k runs the signal plan of every intersection with
+// id % controllers == k and is the only writer of their entries. An entry is
+// one word in a MAP_SHARED mapping made before fork(), so a vehicle thread
+// reads light and preemption with a single atomic load and no lock. After
+// publishing, a controller bumps the board's eventfd; the simulation's signal
+// follower thread wakes and admits whoever the new state lets through.
+//
+// Signal plans (network.h) run from a common CLOCK_MONOTONIC epoch, so
+// controllers stay in step without talking to each other: at `now` every
+// light shows what its plan gives for the ms elapsed since the epoch.
+
+const uint32_t SIGNAL_GREEN   = 1u << 0;
+const uint32_t SIGNAL_PREEMPT = 1u << 1;
+
+struct SignalBoard {
+    int64_t epoch_ns;          // time 0 of every signal plan
+    int controllers;
+    int intersections;
+    int event_fd;              // written by controllers, read by the follower
+    atomic<uint32_t> *state;   // [intersections] in the shared mapping
+};
+
+// Null unless the controllers own the signals (wall-clock modes)
+extern SignalBoard *g_signal_board;
+
+// Parent, before fork(): entries start as their plans do at time 0, with no
+// preemption
+bool signal_board_create(int intersections, int controllers);
+void signal_board_destroy();
+
+inline uint32_t signal_board_read(IntersectionId id) {
+    return g_signal_board->state[(int)id].load(memory_order_acquire);
+}
+
+inline int signal_board_owner(IntersectionId id) {
+    return (int)id % g_signal_board->controllers;
+}
+
+// Owning controller only. Returns true if the entry changed; changes reach
+// the simulation at the next signal_board_notify().
+bool signal_board_publish(IntersectionId id, uint32_t state);
+void signal_board_notify();
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <functional>
+#include <vector>
+using namespace std;
+
+#include "vehicle_store.h"
+
+// Discrete-event simulation engine: a virtual clock plus a time-ordered
+// event calendar. Drives the same intersection/parking logic as the
+// real-time thread mode, but jumps from event to event instead of sleeping.
+
+// Current virtual time in seconds since the simulation started
+double sim_now();
+
+// Schedule an action at an absolute / relative virtual time.
+// Events with the same timestamp run in the order they were scheduled.
+void sim_schedule_at(double when, function<void()> action);
+void sim_schedule_after(double delay, function<void()> action);
+
+// Run every vehicle's journey to completion on the virtual clock.
+// Returns the virtual time at which the last event fired.
+double run_discrete_event_simulation(VehicleStore &vehicles);
+
+struct PartitionStats {
+    int partitions;
+    unsigned long events;
+    unsigned long handoffs;     // journeys that drove into another partition
+    double wall_seconds;
+};
+
+// Same engine split across `partitions` threads (<= 0: one per CPU), each
+// owning a contiguous block of intersections with its own calendar. Vehicles
+// also drive the road to their destination and cross it there; entering
+// another partition hands the journey to it through a lock-free mailbox, and
+// partitions advance in lock-step windows one road trip long (conservative
+// synchronisation). Returns the virtual time at which the last event fired.
+double run_partitioned_simulation(VehicleStore &vehicles, int partitions,
+                                  PartitionStats *stats = nullptr);
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <cstdint>
+
+// Simulation randomness: xoshiro256** streams split from one master seed.
+//
+// Every consumer owns its stream (each vehicle one keyed by its id, the
+// arrival process another), so no draw ever takes a lock and what a vehicle
+// does depends only on (seed, id), not on thread scheduling or on which
+// engine runs it. The same --seed therefore gives the same vehicles, routes,
+// crossing and parking times and arrival gaps in every mode.
+//
+// Streams are seeded by running splitmix64 over seed + stream id, the
+// initialisation the xoshiro authors recommend, so neighbouring ids give
+// unrelated sequences. A stream is 32 bytes and not thread-safe.
+//
+// Where 32 bytes per owner is too much (a vehicle's draws while it drives,
+// with millions of vehicles), sim_random_at() gives draw number `counter` of
+// a stream directly: splitmix64 at position `counter` of the stream's key,
+// so the owner keeps only a counter.
+
+struct SimRng {
+    uint64_t s[4];
+};
+
+// Stream ids below SIM_STREAM_VEHICLE are reserved; vehicle n uses SIM_STREAM_VEHICLE + n
+enum : uint64_t {
+    SIM_STREAM_ARRIVALS = 0,
+    SIM_STREAM_VEHICLE = 16
+};
+
+// Set the master seed (before any stream is created); seed_from_clock picks one
+void sim_random_seed(uint64_t seed);
+uint64_t sim_random_seed_from_clock();
+uint64_t sim_random_get_seed();
+
+SimRng sim_rng_stream(uint64_t stream);
+
+// Draw `counter` of `stream`, without state
+uint64_t sim_random_at(uint64_t stream, uint64_t counter);
+
+// Uniform integer in [min, max] from a raw 64-bit draw (multiply-shift; the
+// bias is below 2^-32 for any range we use)
+inline int sim_random_range(uint64_t draw, int min, int max) {
+    uint64_t range = (uint64_t)(max - min) + 1;
+    return min + (int)(((unsigned __int128)draw * range) >> 64);
+}
+
+inline uint64_t sim_rng_rotl(uint64_t x, int k) {
+    return (x << k) | (x >> (64 - k));
+}
+
+inline uint64_t sim_rng_next(SimRng &r) {
+    uint64_t *s = r.s;
+    uint64_t result = sim_rng_rotl(s[1] * 5, 7) * 9;
+    uint64_t t = s[1] << 17;
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = sim_rng_rotl(s[3], 45);
+    return result;
+}
+
+// Uniform integer in [min, max]
+inline int sim_rng_int(SimRng &r, int min, int max) {
+    return sim_random_range(sim_rng_next(r), min, max);
+}
+
+// Uniform double in [0, 1)
+inline double sim_rng_uniform(SimRng &r) {
+    return (sim_rng_next(r) >> 11) * 0x1.0p-53;
+}
+
+inline bool sim_rng_bool(SimRng &r, double probability = 0.5) {
+    return sim_rng_uniform(r) < probability;
+}
+
+// Index in [0, n) drawn with the given relative weights (not all zero)
+inline int sim_rng_pick(SimRng &r, const uint32_t *weights, int n) {
+    uint64_t total = 0;
+    for (int i = 0; i < n; ++i) total += weights[i];
+    uint64_t x = ((unsigned __int128)sim_rng_next(r) * total) >> 64;
+    for (int i = 0; i < n; ++i) {
+        if (x < weights[i]) return i;
+        x -= weights[i];
+    }
+    return n - 1;
+}
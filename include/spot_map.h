@@ -0,0 +1,52 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+using namespace std;
+
+// Lock-free allocator of a parking lot's individual spots.
+//
+// Spot ids run level by level, ground level first, and within a level from
+// the entrance outwards, so the lowest free id is the spot nearest the
+// entrance. One bit per spot (set = occupied) in 64-spot words: a claim is a
+// CAS that sets the lowest free bit of a word, found with count-trailing-zeros,
+// and a release is one fetch_and. A second bitmap with one bit per word marks
+// the words that may still have a free spot, so a scan over a 50k-spot lot
+// skips full stretches 4096 spots at a time instead of touching every word.
+//
+// The map does no admission: callers hold a ParkingLot spot permit before
+// claiming, so a free bit always exists for them.
+
+struct SpotMap {
+    int spots;
+    int levels;
+    int per_level;                // spots per level (the top one may have fewer)
+    int words;
+    atomic<uint64_t> *used;       // [words]; bits past `spots` stay set
+    atomic<uint64_t> *has_free;   // [(words + 63) / 64]; bit w: word w may have a free spot
+};
+
+void spot_map_init(SpotMap &m, int spots, int levels = 1);
+void spot_map_destroy(SpotMap &m);
+
+// Claim the free spot nearest to `from` at or after it (wrapping round to
+// spot 0). Returns its id, or -1 if none was free during the scan.
+int spot_map_claim(SpotMap &m, int from = 0);
+
+void spot_map_release(SpotMap &m, int spot);
+
+// Spots taken right now, a popcount per word. Lock-free, so only as exact
+// as a snapshot can be while claims and releases run.
+int spot_map_used(const SpotMap &m);
+
+inline bool spot_map_occupied(const SpotMap &m, int spot) {
+    return (m.used[spot / 64].load(memory_order_relaxed) >> (spot % 64)) & 1;
+}
+
+inline int spot_map_level(const SpotMap &m, int spot) {
+    return spot / m.per_level;
+}
+
+inline int spot_map_level_start(const SpotMap &m, int level) {
+    return level * m.per_level;
+}
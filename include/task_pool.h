@@ -0,0 +1,44 @@
+#pragma once
+
+#include <vector>
+#include <csignal>
+using namespace std;
+
+#include "journey.h"
+#include "vehicle_store.h"
+#include "timer_wheel.h"
+
+// Fixed pool of worker threads with per-worker work-stealing deques.
+// Vehicle journeys run as resumable tasks on it instead of one pthread each:
+// a journey that has to wait parks on the Intersection/ParkingLot wait list
+// or on the timer service, and its worker moves on to other vehicles.
+
+// A unit of work. Storage is owned by the submitter and must stay valid
+// until fn runs; a task may be queued at most once at a time.
+struct PoolTask {
+    void (*fn)(void *arg);
+    void *arg;
+    TimerNode timer;       // task_pool_submit_after
+};
+
+// Start `workers` worker threads (<= 0: one per online CPU), and the timer
+// service for task_pool_submit_after
+void task_pool_start(int workers);
+
+// Stop and join all pool threads (queued tasks are dropped)
+void task_pool_stop();
+
+int task_pool_worker_count();
+
+// Queue a task. From a worker it goes to that worker's own deque,
+// from any other thread to the shared injection queue.
+void task_pool_submit(PoolTask *t);
+
+// Queue a task after a wall-clock delay, from the timer service thread.
+// Cancel it with timer_service_cancel(&t->timer) before t goes away.
+void task_pool_submit_after(PoolTask *t, double seconds);
+
+// Run every vehicle's journey on the pool (real-time timings).
+// Blocks until all journeys complete or *shutdown becomes non-zero.
+void run_task_pool_simulation(VehicleStore &vehicles, int workers,
+                              volatile sig_atomic_t *shutdown);
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+using namespace std;
+
+// Hierarchical timer wheel (Varghese & Lauck, scheme 7).
+//
+// Time is counted in 1 ms ticks. Level L has 256 slots of 256^L ticks each;
+// a timer sits in the coarsest level that can still tell it apart from the
+// current tick and moves one level down (is "cascaded") when its slot comes
+// round, so insertion, cancellation and expiry are O(1) however many timers
+// are pending. Four levels reach 2^32 ms (~49 days); anything later waits on
+// an overflow list. A bitmap per level lets an idle wheel jump straight to
+// its next occupied slot instead of stepping every tick.
+//
+// Timers are intrusive: the caller owns each TimerNode and must keep it alive
+// while it is pending. The wheel itself is not thread-safe.
+
+const int TIMER_WHEEL_BITS = 8;
+const int TIMER_WHEEL_SLOTS = 1 << TIMER_WHEEL_BITS;
+const int TIMER_WHEEL_LEVELS = 4;
+const int64_t TIMER_TICK_NS = 1000000;   // 1 ms
+
+struct TimerNode {
+    TimerNode *next;
+    TimerNode **pprev;     // the link pointing at this node; null when not pending
+    uint64_t expires;      // tick
+    void (*fn)(void *arg); // run by the timer service on expiry
+    void *arg;
+};
+
+struct TimerWheel {
+    uint64_t now;          // every timer due at or before `now` has been handed out
+    TimerNode *slots[TIMER_WHEEL_LEVELS][TIMER_WHEEL_SLOTS];
+    uint64_t occupied[TIMER_WHEEL_LEVELS][TIMER_WHEEL_SLOTS / 64];
+    TimerNode *overflow;
+    size_t pending;
+};
+
+inline void timer_node_init(TimerNode &n, void (*fn)(void*) = nullptr, void *arg = nullptr) {
+    n.next = nullptr;
+    n.pprev = nullptr;
+    n.expires = 0;
+    n.fn = fn;
+    n.arg = arg;
+}
+
+inline bool timer_pending(const TimerNode &n) {
+    return n.pprev != nullptr;
+}
+
+void timer_wheel_init(TimerWheel &w, uint64_t now);
+
+// Arm `n` to expire at tick `expires` (re-arms it if already pending). A tick
+// at or before `now` expires on the next advance.
+void timer_wheel_add(TimerWheel &w, TimerNode *n, uint64_t expires);
+
+// Returns true if `n` was pending
+bool timer_wheel_cancel(TimerWheel &w, TimerNode *n);
+
+// Move time forward to `now` and return the timers that expired, chained
+// through `next` in expiry order
+TimerNode* timer_wheel_advance(TimerWheel &w, uint64_t now);
+
+// Earliest tick at which an advance may have work to do (expire or cascade);
+// UINT64_MAX when nothing is pending
+uint64_t timer_wheel_next_tick(const TimerWheel &w);
+
+// ---- Timer service ----
+// One wheel for the simulation process, driven by a single thread that
+// blocks in read() on a timerfd armed at the absolute time of the wheel's
+// next tick. Deadlines are CLOCK_MONOTONIC absolutes, so periodic work
+// scheduled as epoch + k * period never drifts. Callbacks run on the service
+// thread, one at a time, without the service lock held; they may arm timers.
+
+// Reference counted: the first start launches the thread, the last stop
+// joins it (timers still pending then are forgotten)
+void timer_service_start();
+void timer_service_stop();
+
+// CLOCK_MONOTONIC nanoseconds
+int64_t timer_service_clock_ns();
+
+// Arm `n` (fn/arg set by timer_node_init) to run at `due_ns`, rounded up to
+// the next tick
+void timer_service_add_at(TimerNode *n, int64_t due_ns);
+void timer_service_add_after(TimerNode *n, double seconds);
+
+// Disarm `n`. If its callback is running right now, waits for it to return
+// (and undoes any re-arming it did). Returns true if it was still pending.
+bool timer_service_cancel(TimerNode *n);
+
+// Block the calling thread for `seconds`, woken by the service (a plain
+// sleep while the service is not running)
+void timer_service_sleep(double seconds);
@@ -1,10 +1,35 @@
 #pragma once
 
-#include <vector>
-#include <pthread.h>
+#include <string>
 #include "vehicle.h"
 #include "intersection.h"
 
+#ifdef TRAFFIC_HEADLESS
+
+// Headless build (traffic_sim_headless): no renderer is linked and every hook
+// is an empty inline, so callers' `if (ui_active())` blocks compile away.
+constexpr bool ui_active() { return false; }
+inline void ui_set_enabled(bool) {}
+
+inline void ui_start() {}
+inline void ui_stop() {}
+
+inline void ui_notify_vehicle_approach(IntersectionId, Vehicle*) {}
+inline void ui_notify_vehicle_enter(IntersectionId, Vehicle*) {}
+inline void ui_notify_vehicle_exit(IntersectionId, Vehicle*) {}
+inline void ui_notify_vehicle_parking(int, bool, int) {}
+inline void ui_update_signal(IntersectionId, LightColor) {}
+inline void ui_notify_emergency_preempt(IntersectionId, bool) {}
+inline void ui_log_event(const std::string&) {}
+
+#else
+
+// Runtime switch (--no-ui). When disabled the hooks return before touching
+// the renderer's lock; callers check ui_active() to skip building messages.
+extern bool g_ui_enabled;
+inline bool ui_active() { return g_ui_enabled; }
+void ui_set_enabled(bool enabled);   // call before ui_start()
+
 // UI lifecycle
 void ui_start();
 void ui_stop();
@@ -13,7 +38,9 @@ void ui_stop();
 void ui_notify_vehicle_approach(IntersectionId id, Vehicle* v);
 void ui_notify_vehicle_enter(IntersectionId id, Vehicle* v);
 void ui_notify_vehicle_exit(IntersectionId id, Vehicle* v);
-void ui_notify_vehicle_parking(int vehicleId, bool entering); // entering=true when parking, false when leaving
+void ui_notify_vehicle_parking(int vehicleId, bool entering, int spot); // entering=true when parking (spot: its SpotMap id), false when leaving
 void ui_update_signal(IntersectionId id, LightColor color);
 void ui_notify_emergency_preempt(IntersectionId id, bool active);
 void ui_log_event(const std::string& message);
+
+#endif
@@ -1,23 +1,40 @@
 #pragma once
 
 #include <string>
+#include <cstdint>
 using namespace std;
 
-// Basic intersections in the system
-enum class IntersectionId {
-    F10,
-    F11
-};
+#include "sim_random.h"
+
+// Index of an intersection in the road network (see network.h). A distinct
+// type rather than a bare int so ids cannot be mixed up with counts or other ids.
+enum class IntersectionId : int32_t {};
 
 // Directions a vehicle can take at an intersection
-enum class Direction {
+enum class Direction : uint8_t {
     Straight,
     Left,
     Right
 };
 
+// Side of the intersection a vehicle arrives from
+enum class Approach : uint8_t {
+    North,
+    East,
+    South,
+    West
+};
+
+// Side a vehicle leaves a four-way crossing on (right-hand traffic)
+inline Approach exit_side(Approach from, Direction d) {
+    int a = (int)from;
+    if (d == Direction::Straight) return (Approach)((a + 2) % 4);
+    if (d == Direction::Left) return (Approach)((a + 1) % 4);
+    return (Approach)((a + 3) % 4);   // Right
+}
+
 // Types of vehicles in the simulation
-enum class VehicleType {
+enum class VehicleType : uint8_t {
     Ambulance,
     FireTruck,
     Bus,
@@ -26,14 +43,17 @@ enum class VehicleType {
     Tractor
 };
 
-// Core vehicle metadata
+// Core vehicle metadata: the cold record of the vehicle table (see
+// vehicle_store.h), read by the vehicle's own journey. 28 bytes.
 struct Vehicle {
-    int id;
-    VehicleType type;
-    int priority;   // smaller value = higher priority
-    time_t arrival_time; // spawn time
+    int32_t id;
     IntersectionId originIntersection;
     IntersectionId destIntersection;
+    int32_t parking_spot;   // spot id in its lot's SpotMap while it holds one, -1 otherwise
+    uint32_t draws;         // random draws taken from its stream (crossing and parking times)
+    VehicleType type;
+    uint8_t priority;       // smaller value = higher priority
+    Approach approach;
     Direction direction;
     bool wantsParking;
 };
@@ -42,13 +62,45 @@ struct Vehicle {
 
 string to_string(VehicleType type);
 string to_string(Direction dir);
+string to_string(Approach approach);
 string to_string(IntersectionId id);
 
-// Compute priority based on type
+// Compute priority based on type (0 = most urgent .. PRIORITY_LEVELS-1)
 int compute_priority(VehicleType type);
+const int PRIORITY_LEVELS = 4;
 
-// Factory to create a random vehicle with given id
+// Factory to create a random vehicle with given id somewhere on the loaded
+// network, drawn from g_network.traffic with the vehicle's own stream
 Vehicle make_random_vehicle(int id);
 
+// Move a drawn vehicle to arrive at `at` from `from`. If it was drawn to
+// drive on, it takes the road its turn leads onto there, if there is one.
+void vehicle_place(Vehicle &v, IntersectionId at, Approach from);
+
+// Gap before the next vehicle arrives (100-500 ms), from the arrival stream
+double arrival_gap_seconds(SimRng &arrivals);
+
 // Thread function that simulates a vehicle's life
 void* vehicle_thread_func(void* arg);
+
+// --- Lifecycle steps shared by the thread and discrete-event modes ---
+struct Intersection;
+struct ParkingLot;
+struct RoadLink;
+
+Intersection* origin_intersection(const Vehicle *v);
+ParkingLot* origin_parking(const Vehicle *v);
+bool vehicle_may_park(const Vehicle *v);
+int crossing_seconds(Vehicle *v);   // random crossing duration
+int vehicle_random_int(Vehicle *v, int min, int max);   // next draw of the vehicle's stream
+
+void vehicle_announce(Vehicle *v);            // spawn banner
+void vehicle_parking_skipped(Vehicle *v);
+void vehicle_approach(Vehicle *v);            // log, UI, emergency preemption
+void vehicle_cleared_intersection(Vehicle *v);// lift preemption after an emergency crossing
+
+// Road to the destination when the engine models driving there
+const RoadLink* vehicle_road(const Vehicle *v); // nullptr: the vehicle stays at its origin
+void vehicle_arrive(Vehicle *v, const RoadLink *road); // now at the road's end, heading straight on
+void vehicle_cleared_destination(Vehicle *v); // lift the preemption it requested there
+void vehicle_complete(Vehicle *v);
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+using namespace std;
+
+#include "vehicle.h"
+#include "workload.h"
+#include "arrival_trace.h"
+#include "arrival_process.h"
+
+// The vehicle table: every vehicle of a run, as columns in one arena.
+//
+// The cold column is the Vehicle record a journey reads as it goes (who it
+// is, where it is headed, its parking spot). The hot columns are what
+// statistics and rendering sweep over every vehicle for: a 1-byte state and
+// the intersection it is at. They sit in arrays of their own, so a census of
+// 10M vehicles streams through 10 MB of state bytes instead of striding
+// through whole records. Each vehicle writes only its own entries; the
+// atomics let a sweep read them while the simulation runs.
+//
+// The arena is one mapping, backed by huge pages when the system has them
+// reserved (MAP_HUGETLB) and otherwise marked for transparent huge pages, so
+// a sweep over millions of vehicles does not thrash the TLB. 33 bytes per
+// vehicle in all. Vehicle ids run 1..count; vehicle i lives at index i - 1.
+//
+// Creating the table only maps the arena; its pages are touched as vehicles
+// spawn. Engines pull vehicles in arrival order with vehicle_store_next(),
+// which draws each one (make_random_vehicle and the arrival process), decodes
+// it from a workload file or reads it from an arrival trace, so startup costs
+// the same for 15 vehicles as for 100M. A trace is not counted up front: the
+// table is mapped for as many arrivals as the file could hold, and the run's
+// vehicles end where the trace does.
+
+enum class VehicleState : uint8_t {
+    Pending,    // not spawned yet
+    Waiting,    // at an intersection, before entering it
+    Crossing,   // inside an intersection
+    Parked,
+    Driving,    // on a road to its destination
+    Done
+};
+const int VEHICLE_STATE_COUNT = 6;
+
+struct VehicleStore {
+    size_t count;
+    Vehicle *info;                       // cold: [count]
+    atomic<uint8_t> *state;              // hot: [count], a VehicleState
+    atomic<IntersectionId> *at;          // hot: [count], where it is (or is driving to)
+
+    void *arena;
+    size_t arena_bytes;
+    bool huge_pages;                     // explicit huge pages (not just THP advice)
+
+    // Arrival cursor (one spawning thread)
+    size_t spawned;
+    bool exhausted;                      // the trace ended before `count`
+    const Workload *workload;            // nullptr: draw vehicles from the seed
+    ArrivalTrace *trace;                 // or read them from a detector log
+    ArrivalProcess arrivals;
+};
+
+static_assert(sizeof(Vehicle) <= 32, "vehicle record must fit half a cache line");
+static_assert(sizeof(atomic<IntersectionId>) == sizeof(IntersectionId), "hot columns are plain arrays");
+const int VEHICLE_BYTES = sizeof(Vehicle) + sizeof(uint8_t) + sizeof(IntersectionId);
+
+extern VehicleStore g_vehicles;
+
+// Map the table for `count` vehicles, drawn from the seed or, if given, read
+// from the first `count` records of `workload` or arrivals of `trace` (which
+// may run out first). False if the arena cannot be mapped.
+bool vehicle_store_create(size_t count, const Workload *workload = nullptr, ArrivalTrace *trace = nullptr);
+void vehicle_store_destroy();
+
+// Spawn the next vehicle in arrival order: fill in its record and return it
+// with its arrival time (seconds after the start). nullptr once all have, or
+// once the trace ends.
+Vehicle* vehicle_store_next(double &arrival_s);
+
+inline Vehicle* vehicle_by_index(size_t i) {
+    return &g_vehicles.info[i];
+}
+
+// Vehicles outside the table (a benchmark's stand-ins) are not tracked
+inline void vehicle_set_state(const Vehicle *v, VehicleState s, IntersectionId at) {
+    size_t i = (size_t)v->id - 1;
+    if (i >= g_vehicles.count) return;
+    g_vehicles.at[i].store(at, memory_order_relaxed);
+    g_vehicles.state[i].store((uint8_t)s, memory_order_release);
+}
+
+inline VehicleState vehicle_state(size_t i) {
+    return (VehicleState)g_vehicles.state[i].load(memory_order_acquire);
+}
+
+// Vehicles per state, one pass over the state column (once spawning is over
+// if a trace supplies them)
+void vehicle_store_census(uint64_t counts[VEHICLE_STATE_COUNT]);
+
+// Log the census (and what the table costs)
+void log_vehicle_census();
@@ -0,0 +1,71 @@
+#pragma once
+
+struct Vehicle;
+
+// Intrusive FIFO of waiting vehicles: suspended journeys (task-pool and
+// discrete-event modes) and, on intersections, blocked vehicle threads. The
+// node lives inside the journey or on the thread's stack, so waiting never
+// allocates. Protected by the owner's lock. The owner grants the resource
+// *before* waking a node (no wake-then-retry). A journey's wake() is called
+// after that lock has been released; see intersection.cpp for threads.
+struct WaitNode {
+    void (*wake)(void *arg);
+    void *arg;
+    Vehicle *vehicle;   // who is waiting (lets the owner decide admission)
+    unsigned long ticket;   // arrival order, for owners that keep several lists
+    double queued_at;       // owner's clock when the node was queued
+    WaitNode *next;
+};
+
+struct WaitList {
+    WaitNode *head;
+    WaitNode *tail;
+};
+
+inline void wait_list_init(WaitList &l) {
+    l.head = l.tail = nullptr;
+}
+
+inline bool wait_list_empty(const WaitList &l) {
+    return l.head == nullptr;
+}
+
+inline void wait_list_push(WaitList &l, WaitNode *n) {
+    n->next = nullptr;
+    if (l.tail) l.tail->next = n;
+    else l.head = n;
+    l.tail = n;
+}
+
+inline WaitNode* wait_list_pop(WaitList &l) {
+    WaitNode *n = l.head;
+    if (n) {
+        l.head = n->next;
+        if (!l.head) l.tail = nullptr;
+        n->next = nullptr;
+    }
+    return n;
+}
+
+// Unlink `n` if it is still queued; false if it is not (an owner took it)
+inline bool wait_list_remove(WaitList &l, WaitNode *n) {
+    WaitNode *prev = nullptr;
+    for (WaitNode *c = l.head; c; prev = c, c = c->next) {
+        if (c != n) continue;
+        if (prev) prev->next = n->next;
+        else l.head = n->next;
+        if (l.tail == n) l.tail = prev;
+        n->next = nullptr;
+        return true;
+    }
+    return false;
+}
+
+// Wake a detached chain in FIFO order
+inline void wait_list_wake_chain(WaitNode *n) {
+    while (n) {
+        WaitNode *next = n->next;   // wake() may re-park the node
+        n->wake(n->arg);
+        n = next;
+    }
+}
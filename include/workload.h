@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+using namespace std;
+
+#include "vehicle.h"
+
+// Binary vehicle workload: the traffic of a run written out once, replayed
+// exactly by any number of runs.
+//
+// A 64-byte header, then one fixed-width 24-byte record per vehicle in
+// arrival order, little-endian. Vehicle ids are implicit (record i is
+// vehicle i + 1). The file is memory-mapped, not read: opening a 100M-vehicle
+// workload only validates the header, and each record is decoded when the
+// engine reaches that vehicle's arrival, so pages stream in behind the
+// simulation. The header records the intersection count of the network the
+// workload was generated for, and loading checks it against the scenario.
+//
+//   tools/gen_workload <file> <vehicles> [--scenario=FILE] [--seed=N]
+//   traffic_sim --workload=<file> [--scenario=FILE]
+
+const char WORKLOAD_MAGIC[8] = {'T', 'R', 'A', 'F', 'F', 'I', 'C', 'W'};
+const uint32_t WORKLOAD_VERSION = 1;
+
+struct WorkloadHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t record_bytes;      // sizeof(WorkloadRecord)
+    uint64_t count;
+    uint64_t seed;              // what generated it (informational)
+    uint32_t intersections;     // of the network it was generated for
+    uint8_t reserved[28];
+};
+
+const uint8_t WORKLOAD_WANTS_PARKING = 1;
+
+struct WorkloadRecord {
+    double arrival_s;           // seconds after the start, non-decreasing
+    int32_t origin;
+    int32_t dest;
+    uint8_t type;               // VehicleType
+    uint8_t approach;           // Approach
+    uint8_t direction;          // Direction
+    uint8_t flags;              // WORKLOAD_WANTS_PARKING
+    uint32_t reserved;
+};
+
+static_assert(sizeof(WorkloadHeader) == 64, "workload header is 64 bytes");
+static_assert(sizeof(WorkloadRecord) == 24, "workload records are 24 bytes");
+
+struct Workload {
+    const WorkloadHeader *header;
+    const WorkloadRecord *records;   // [count]
+    size_t count;
+    size_t map_bytes;
+};
+
+// Map `path` and validate it against the loaded network. On failure nothing
+// stays mapped and `error` says why.
+bool workload_open(const string &path, Workload &w, string &error);
+void workload_close(Workload &w);
+
+// Decode vehicle `i` (id i + 1) and its arrival time. Records are not
+// checked up front; an out-of-range field decodes as intersection 0 / a car /
+// going straight, so a corrupt file cannot index out of bounds.
+Vehicle workload_vehicle(const Workload &w, size_t i, double &arrival_s);
+
+// Write `count` vehicles drawn from the loaded network's traffic profile and
+// the current seed, with the simulator's arrival process
+bool workload_write(const string &path, size_t count, string &error);
@@ -0,0 +1,116 @@
+#include "arrival_process.h"
+#include <cmath>
+#include <ctime>
+#include <limits>
+using namespace std;
+
+#include "network.h"
+#include "timer_wheel.h"
+#include "latency_histogram.h"
+#include "log.h"
+
+static const double DAY_SECONDS = 86400.0;
+static const int64_t PACER_SLICE_NS = 200000000;   // how often a long wait looks at shutdown
+
+double arrival_rate_factor(const TrafficProfile &traffic, double t, double &until) {
+    const vector<RatePeriod> &daily = traffic.daily;
+    if (daily.empty()) {
+        until = numeric_limits<double>::infinity();
+        return 1.0;
+    }
+    double day = fmod(traffic.start_of_day_s + t, DAY_SECONDS);
+    // The last period starting at or before `day`; before the first, yesterday's last
+    size_t k = 0;
+    while (k < daily.size() && daily[k].from_s <= day) k++;
+    const RatePeriod &now = daily[k == 0 ? daily.size() - 1 : k - 1];
+    double next = k < daily.size() ? daily[k].from_s : daily[0].from_s + DAY_SECONDS;
+    until = t + (next - day);
+    return now.factor;
+}
+
+// First arrival after `t`: an exponential amount of integrated rate, spent
+// period by period
+static double poisson_after(ArrivalProcess &p, double t) {
+    double budget = -log(1.0 - sim_rng_uniform(p.rng));
+    while (true) {
+        double until;
+        double rate = p.total_rate * arrival_rate_factor(*p.traffic, t, until);
+        if (rate > 0 && budget <= rate * (until - t)) return t + budget / rate;
+        budget -= rate * (until - t);
+        t = until;
+    }
+}
+
+void arrival_process_init(ArrivalProcess &p, const TrafficProfile &traffic) {
+    p.rng = sim_rng_stream(SIM_STREAM_ARRIVALS);
+    p.traffic = &traffic;
+    p.total_rate = 0;
+    for (double r : traffic.approach_rate) p.total_rate += r;
+    p.poisson = p.total_rate > 0;
+    p.next = p.poisson ? poisson_after(p, 0.0) : 0.0;
+}
+
+double arrival_process_next(ArrivalProcess &p, int &approach) {
+    double at = p.next;
+    if (!p.poisson) {
+        approach = -1;
+        p.next += arrival_gap_seconds(p.rng);
+        return at;
+    }
+    double pick = sim_rng_uniform(p.rng) * p.total_rate;
+    approach = 0;
+    while (approach < 3 && pick >= p.traffic->approach_rate[approach]) {
+        pick -= p.traffic->approach_rate[approach];
+        approach++;
+    }
+    while (p.traffic->approach_rate[approach] == 0) approach--;   // rounding past the last
+    p.next = poisson_after(p, at);
+    return at;
+}
+
+// ---------------- PACING ----------------
+
+static struct {
+    int64_t epoch_ns;
+    LatencyHistogram lag;
+    uint64_t behind;            // released more than ARRIVAL_BEHIND_S late
+    double last_arrival_s;
+} pacer;
+
+void arrival_pacer_start() {
+    pacer.epoch_ns = timer_service_clock_ns();
+    latency_histogram_reset(pacer.lag);
+    pacer.behind = 0;
+    pacer.last_arrival_s = 0;
+}
+
+bool arrival_pacer_wait(double arrival_s, volatile sig_atomic_t *shutdown) {
+    auto &p = pacer;
+    int64_t due = p.epoch_ns + (int64_t)(arrival_s * 1e9);
+    int64_t now;
+    // Absolute sleeps: an early wake-up (or a signal) just sleeps to the same deadline again
+    while ((now = timer_service_clock_ns()) < due) {
+        if (*shutdown) return false;
+        int64_t until = min(due, now + PACER_SLICE_NS);
+        timespec ts = {(time_t)(until / 1000000000), (long)(until % 1000000000)};
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL);
+    }
+    if (*shutdown) return false;
+    double late = (now - due) / 1e9;
+    latency_histogram_record(p.lag, late);
+    if (late > ARRIVAL_BEHIND_S) p.behind++;
+    p.last_arrival_s = arrival_s;
+    return true;
+}
+
+void log_arrival_lag() {
+    const auto &p = pacer;
+    if (p.lag.total == 0) return;
+    const LatencyHistogram &h = p.lag;
+    int perHour = p.last_arrival_s > 0 ? (int)lround(h.total / p.last_arrival_s * 3600) : 0;
+    log_event<LogLevel::Info>(LogEvent::ArrivalLag,
+                              {(int)h.total, perHour,
+                               (int)(latency_histogram_percentile(h, 0.50) * 1e6),
+                               (int)(latency_histogram_percentile(h, 0.99) * 1e6),
+                               (int)min<uint64_t>(h.max_us, INT32_MAX), (int)p.behind});
+}
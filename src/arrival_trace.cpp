@@ -0,0 +1,358 @@
+#include "arrival_trace.h"
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+#include <charconv>
+#include <algorithm>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+using namespace std;
+
+#include "network.h"
+
+static const size_t TRACE_CHUNK = 1 << 20;
+static const size_t TRACE_PADDING = 16;   // a 16-byte load at the last byte stays inside the buffer
+
+enum TraceColumn { ColTime, ColIntersection, ColApproach, ColType, ColTurn, ColPark };
+
+struct Field {
+    const char *p;
+    size_t n;
+};
+
+struct TraceRecord {
+    double time;
+    int origin;
+    Approach approach;
+    int type;       // VehicleType, -1 = draw it
+    int turn;       // Direction, -1 = draw it
+    int park;       // 0/1, -1 = draw it
+};
+
+// ---------------- READING ----------------
+
+// Next line of the file as [begin, end) without its newline, refilling the
+// buffer as needed. False at the end of the file, or with `error` set.
+static bool read_line(ArrivalTrace &t, const char *&begin, const char *&end, string &error) {
+    while (true) {
+        const char *start = t.buf + t.pos;
+        const char *nl = (const char*)memchr(start, '\n', t.len - t.pos);
+        if (nl || (t.eof && t.pos < t.len)) {
+            begin = start;
+            end = nl ? nl : t.buf + t.len;   // the last line may have no newline
+            t.pos = end - t.buf + (nl ? 1 : 0);
+            t.line++;
+            if (end > begin && end[-1] == '\r') end--;
+            return true;
+        }
+        if (t.eof) return false;
+
+        // Move the partial line to the front and read more behind it
+        size_t rest = t.len - t.pos;
+        if (rest == TRACE_CHUNK) {
+            error = t.path + ":" + to_string(t.line + 1) + ": line longer than " + to_string(TRACE_CHUNK) + " bytes";
+            return false;
+        }
+        memmove(t.buf, start, rest);
+        t.pos = 0;
+        t.len = rest;
+        ssize_t got = read(t.fd, t.buf + t.len, TRACE_CHUNK - t.len);
+        if (got < 0) {
+            if (errno == EINTR) continue;
+            error = t.path + ": read failed: " + strerror(errno);
+            return false;
+        }
+        if (got == 0) t.eof = true;
+        t.len += (size_t)got;
+    }
+}
+
+// Split [begin, end) at its commas, keeping at most TRACE_MAX_COLUMNS fields
+static int split_fields(const char *begin, const char *end, Field *fields) {
+    int n = 0;
+    const char *start = begin;
+    auto cut = [&](const char *comma) {
+        if (n < TRACE_MAX_COLUMNS) fields[n++] = {start, (size_t)(comma - start)};
+        start = comma + 1;
+    };
+#ifdef __SSE2__
+    const __m128i comma = _mm_set1_epi8(',');
+    for (const char *p = begin; p < end; p += 16) {
+        __m128i chunk = _mm_loadu_si128((const __m128i*)p);
+        unsigned mask = (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, comma));
+        if (end - p < 16) mask &= (1u << (end - p)) - 1;
+        while (mask) {
+            cut(p + __builtin_ctz(mask));
+            mask &= mask - 1;
+        }
+    }
+#else
+    for (const char *p = begin; p < end; ++p) {
+        if (*p == ',') cut(p);
+    }
+#endif
+    if (n < TRACE_MAX_COLUMNS) fields[n++] = {start, (size_t)(end - start)};
+    return n;
+}
+
+// ---------------- FIELDS ----------------
+
+static Field trim(Field f) {
+    while (f.n && (f.p[0] == ' ' || f.p[0] == '\t')) f.p++, f.n--;
+    while (f.n && (f.p[f.n - 1] == ' ' || f.p[f.n - 1] == '\t')) f.n--;
+    return f;
+}
+
+// ASCII case-insensitive (strncasecmp goes through the locale)
+static bool field_is(Field f, const char *word) {
+    size_t k = 0;
+    for (; k < f.n && word[k]; ++k) {
+        if ((f.p[k] | 0x20) != (word[k] | 0x20)) return false;
+    }
+    return k == f.n && !word[k];
+}
+
+static bool parse_int(Field f, int &v) {
+    auto r = from_chars(f.p, f.p + f.n, v);
+    return f.n && r.ec == errc() && r.ptr == f.p + f.n;
+}
+
+// Plain [-]digits[.digits] (what detectors write) without from_chars, up to
+// 18 significant digits; anything else goes through from_chars
+static bool parse_double(Field f, double &v) {
+    static const double scale[] = {1, 1e-1, 1e-2, 1e-3, 1e-4, 1e-5, 1e-6, 1e-7, 1e-8, 1e-9};
+    const char *p = f.p, *end = f.p + f.n;
+    bool negative = p < end && *p == '-';
+    p += negative;
+    uint64_t mantissa = 0;
+    int digits = 0, decimals = -1;
+    for (; p < end && digits <= 18; ++p) {
+        if (*p >= '0' && *p <= '9') {
+            mantissa = mantissa * 10 + (uint64_t)(*p - '0');
+            digits++;
+            if (decimals >= 0) decimals++;
+        } else if (*p == '.' && decimals < 0) {
+            decimals = 0;
+        } else {
+            break;
+        }
+    }
+    if (p == end && digits > 0 && digits <= 18 && decimals <= 9) {
+        v = (double)mantissa * scale[decimals < 0 ? 0 : decimals];
+        if (negative) v = -v;
+        return true;
+    }
+    auto r = from_chars(f.p, end, v);
+    return f.n && r.ec == errc() && r.ptr == end;
+}
+
+// Seconds, or HH:MM:SS[.fff] as seconds since midnight
+static bool parse_time(Field f, double &t) {
+    const char *colon = (const char*)memchr(f.p, ':', f.n);
+    if (!colon) return parse_double(f, t);
+    const char *colon2 = (const char*)memchr(colon + 1, ':', f.p + f.n - colon - 1);
+    if (!colon2) return false;
+    int h, m;
+    double s;
+    if (!parse_int({f.p, (size_t)(colon - f.p)}, h) ||
+        !parse_int({colon + 1, (size_t)(colon2 - colon - 1)}, m) ||
+        !parse_double({colon2 + 1, (size_t)(f.p + f.n - colon2 - 1)}, s)) {
+        return false;
+    }
+    t = h * 3600.0 + m * 60.0 + s;
+    return true;
+}
+
+// Words are told apart by their first letter, then checked whole
+static bool parse_approach(Field f, Approach &a) {
+    if (f.n == 0) return false;
+    switch (f.p[0] | 0x20) {
+        case 'n': a = Approach::North; return f.n == 1 || field_is(f, "North");
+        case 'e': a = Approach::East;  return f.n == 1 || field_is(f, "East");
+        case 's': a = Approach::South; return f.n == 1 || field_is(f, "South");
+        case 'w': a = Approach::West;  return f.n == 1 || field_is(f, "West");
+    }
+    return false;
+}
+
+static int parse_type(Field f) {
+    switch (f.p[0] | 0x20) {
+        case 'a': return field_is(f, "ambulance") ? (int)VehicleType::Ambulance : -1;
+        case 'f': return field_is(f, "firetruck") || field_is(f, "fire_truck") ? (int)VehicleType::FireTruck : -1;
+        case 'b': return field_is(f, "bus") ? (int)VehicleType::Bus : field_is(f, "bike") ? (int)VehicleType::Bike : -1;
+        case 'c': return field_is(f, "car") ? (int)VehicleType::Car : -1;
+        case 't': return field_is(f, "tractor") ? (int)VehicleType::Tractor : -1;
+    }
+    return -1;
+}
+
+static int parse_turn(Field f) {
+    switch (f.p[0] | 0x20) {
+        case 's': return field_is(f, "straight") ? (int)Direction::Straight : -1;
+        case 'l': return field_is(f, "left") ? (int)Direction::Left : -1;
+        case 'r': return field_is(f, "right") ? (int)Direction::Right : -1;
+    }
+    return -1;
+}
+
+// ---------------- RECORDS ----------------
+
+static bool skip_line(const char *begin, const char *end) {
+    Field f = trim({begin, (size_t)(end - begin)});
+    return f.n == 0 || f.p[0] == '#';
+}
+
+static bool parse_header(ArrivalTrace &t, const char *begin, const char *end, string &error) {
+    Field fields[TRACE_MAX_COLUMNS];
+    t.columns = split_fields(begin, end, fields);
+    for (int &c : t.column) c = -1;
+    for (int k = 0; k < t.columns; ++k) {
+        Field f = trim(fields[k]);
+        if (field_is(f, "time") || field_is(f, "timestamp")) t.column[ColTime] = k;
+        else if (field_is(f, "intersection")) t.column[ColIntersection] = k;
+        else if (field_is(f, "approach")) t.column[ColApproach] = k;
+        else if (field_is(f, "type")) t.column[ColType] = k;
+        else if (field_is(f, "turn") || field_is(f, "direction")) t.column[ColTurn] = k;
+        else if (field_is(f, "park")) t.column[ColPark] = k;
+    }
+    if (t.column[ColTime] < 0 || t.column[ColIntersection] < 0 || t.column[ColApproach] < 0) {
+        error = t.path + ":" + to_string(t.line) + ": header needs time, intersection and approach columns";
+        return false;
+    }
+    return true;
+}
+
+static bool parse_record(ArrivalTrace &t, const char *begin, const char *end, TraceRecord &r, string &error) {
+    Field fields[TRACE_MAX_COLUMNS];
+    int n = split_fields(begin, end, fields);
+    auto fail = [&](const string &msg) {
+        error = t.path + ":" + to_string(t.line) + ": " + msg;
+        return false;
+    };
+    auto field = [&](int col) {
+        int k = t.column[col];
+        return (k < 0 || k >= n) ? Field{begin, 0} : trim(fields[k]);
+    };
+
+    if (!parse_time(field(ColTime), r.time)) return fail("bad time");
+
+    Field at = field(ColIntersection);
+    auto named = t.ids.find(string_view(at.p, at.n));
+    if (named != t.ids.end()) {
+        r.origin = named->second;
+    } else if (!parse_int(at, r.origin) || r.origin < 0 || r.origin >= intersection_count()) {
+        return fail("unknown intersection " + string(at.p, at.n));
+    }
+    if (!parse_approach(field(ColApproach), r.approach)) return fail("approach must be N, E, S or W");
+
+    r.type = r.turn = r.park = -1;
+    Field f = field(ColType);
+    if (f.n && (r.type = parse_type(f)) < 0) return fail("unknown vehicle type " + string(f.p, f.n));
+    f = field(ColTurn);
+    if (f.n && (r.turn = parse_turn(f)) < 0) return fail("turn must be straight, left or right");
+    f = field(ColPark);
+    if (f.n && (!parse_int(f, r.park) || r.park < 0 || r.park > 1)) return fail("park must be 0 or 1");
+    return true;
+}
+
+// Next arrival line: false at the end of the file, or with `error` set. The
+// line stays in the buffer at `start` until the next read.
+static bool read_record(ArrivalTrace &t, TraceRecord &r, string &error, size_t *start = nullptr) {
+    const char *begin, *end;
+    while (read_line(t, begin, end, error)) {
+        if (skip_line(begin, end)) continue;
+        if (start) *start = begin - t.buf;
+        return parse_record(t, begin, end, r, error);
+    }
+    return false;
+}
+
+// The first line that is not blank or a comment
+static bool read_header(ArrivalTrace &t, string &error) {
+    const char *begin, *end;
+    while (read_line(t, begin, end, error)) {
+        if (!skip_line(begin, end)) return parse_header(t, begin, end, error);
+    }
+    if (error.empty()) error = t.path + ": no header line";
+    return false;
+}
+
+// ---------------- API ----------------
+
+bool arrival_trace_open(const string &path, ArrivalTrace &t, string &error) {
+    t = ArrivalTrace{};
+    t.path = path;
+    t.fd = open(path.c_str(), O_RDONLY);
+    if (t.fd == -1) {
+        error = path + ": cannot open trace";
+        return false;
+    }
+    posix_fadvise(t.fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+    t.buf = (char*)malloc(TRACE_CHUNK + TRACE_PADDING);
+    for (int id = 0; id < intersection_count(); ++id) t.ids.emplace(g_network.names[id], id);
+
+    // Only the header and the first arrival are read here; the first is read
+    // again from the buffer when the run asks for it
+    bool ok = read_header(t, error);
+    TraceRecord r;
+    size_t start;
+    if (ok && read_record(t, r, error, &start)) {
+        t.first_time = t.last_time = r.time;
+        t.pos = start;
+        t.line--;
+    } else if (ok) {
+        if (error.empty()) error = path + ": no arrivals";
+        ok = false;
+    }
+
+    // No more arrivals than the rest of the file holds shortest possible lines:
+    // a character per required field, their commas and the newline
+    struct stat st;
+    if (ok && fstat(t.fd, &st) == 0) {
+        off_t consumed = lseek(t.fd, 0, SEEK_CUR);
+        size_t rest = (size_t)(st.st_size - consumed) + (t.len - t.pos);
+        int last = max(t.column[ColTime], max(t.column[ColIntersection], t.column[ColApproach]));
+        t.max_arrivals = rest / (size_t)(last + 4) + 1;
+    } else if (ok) {
+        error = path + ": cannot stat trace";
+        ok = false;
+    }
+    if (!ok) {
+        arrival_trace_close(t);
+        return false;
+    }
+    return true;
+}
+
+void arrival_trace_close(ArrivalTrace &t) {
+    if (t.fd != -1) close(t.fd);
+    free(t.buf);
+    t = ArrivalTrace{};
+}
+
+bool arrival_trace_next(ArrivalTrace &t, int id, Vehicle &v, double &arrival_s, string &error) {
+    TraceRecord r;
+    if (!read_record(t, r, error)) return false;
+    if (r.time < t.last_time) {
+        error = t.path + ":" + to_string(t.line) + ": arrivals out of time order";
+        return false;
+    }
+    t.last_time = r.time;
+    t.arrivals++;
+
+    // Draw the whole vehicle, then put in what the detector saw
+    v = make_random_vehicle(id);
+    if (r.type >= 0) {
+        v.type = (VehicleType)r.type;
+        v.priority = compute_priority(v.type);
+    }
+    if (r.turn >= 0) v.direction = (Direction)r.turn;
+    if (r.park >= 0) v.wantsParking = r.park == 1;
+    vehicle_place(v, (IntersectionId)r.origin, r.approach);
+    arrival_s = r.time - t.first_time;
+    return true;
+}
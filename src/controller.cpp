@@ -1,99 +1,313 @@
 #include "controller.h"
-#include <iostream>
 #include <unistd.h>
-#include <mutex>
+#include <cerrno>
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
 using namespace std;
 // Preemption control functions
 #include "intersection.h"
+#include "log.h"
+#include "network.h"
+#include "latency_histogram.h"
+#include "signal_board.h"
+#include "timer_wheel.h"
 
-// External log mutex
-extern mutex g_log_mutex;
-
-// ANSI Color Codes
-#define ANSI_RESET   "\033[0m"
-#define ANSI_BOLD    "\033[1m"
-#define ANSI_RED     "\033[31m"
-#define ANSI_GREEN   "\033[32m"
-#define ANSI_YELLOW  "\033[33m"
-#define ANSI_CYAN    "\033[36m"
-#define ANSI_MAGENTA "\033[35m"
-
-// Define global pipes (real definitions are in main.cpp)
-// ✔ Correct version (only declaration)
-extern int pipeF10toF11[2];
-extern int pipeF11toF10[2];
+ControllerChannel controller_channels[CONTROLLER_COUNT];
+vector<ControllerChannel> controller_road_channels[CONTROLLER_COUNT];
 
 string signal_name(ControllerSignal s) {
     switch (s) {
         case ControllerSignal::NORMAL:            return "NORMAL_TRAFFIC";
         case ControllerSignal::EMERGENCY_INCOMING:return "EMERGENCY_ALERT";
+        case ControllerSignal::EMERGENCY_CLEARED: return "EMERGENCY_CLEARED";
         case ControllerSignal::SHUTDOWN:          return "SHUTDOWN";
     }
     return "UNKNOWN";
 }
 
 // Helper used by parent/vehicle threads to notify the controllers
-void notify_emergency_from_to(IntersectionId from, IntersectionId to) {
+void notify_emergency_from_to(IntersectionId from, IntersectionId to, int vehicleId) {
     if (from == to) return; // no cross-intersection movement
 
-    ControllerSignal sig = ControllerSignal::EMERGENCY_INCOMING;
+    ControllerMessage msg = controller_message(ControllerSignal::EMERGENCY_INCOMING, (int)from, (int)to, vehicleId);
 
-    if (from == IntersectionId::F10 && to == IntersectionId::F11) {
-        // Preempt destination intersection to clear path
-        set_emergency_preempt(IntersectionId::F11, true);
-        // Message goes F10 -> F11
-        write(pipeF10toF11[1], &sig, sizeof(sig));
-        {
-            std::lock_guard<std::mutex> lk(g_log_mutex);
-            cout << ANSI_BOLD << ANSI_RED << "🚨 [PARENT] Emergency F10→F11: Preempting F11 intersection" << ANSI_RESET << endl;
+    // Preempt destination intersection to clear path. When the controllers
+    // own the signals, the alert below is what sets it.
+    if (!g_signal_board) set_emergency_preempt(to, true);
+    // Tell the destination's controller, if it has one: a controller's own
+    // intersection hears it on the channel of the road the vehicle will
+    // arrive by, the others it runs signals for on its control channel
+    int k = g_signal_board ? signal_board_owner(to) : (int)to;
+    if (k < CONTROLLER_COUNT && k < intersection_count()) {
+        ControllerChannel *ch = &controller_channels[k];
+        for (int i = g_network.in_begin[k]; k == (int)to && i < g_network.in_begin[k + 1]; ++i) {
+            if (g_network.links[g_network.in_link[i]].from == from) {
+                ch = &controller_road_channels[k][i - g_network.in_begin[k]];
+                break;
+            }
         }
-    } else if (from == IntersectionId::F11 && to == IntersectionId::F10) {
-        // Preempt destination intersection to clear path
-        set_emergency_preempt(IntersectionId::F10, true);
-        // Message goes F11 -> F10
-        write(pipeF11toF10[1], &sig, sizeof(sig));
-        {
-            std::lock_guard<std::mutex> lk(g_log_mutex);
-            cout << ANSI_BOLD << ANSI_RED << "🚨 [PARENT] Emergency F11→F10: Preempting F10 intersection" << ANSI_RESET << endl;
+        channel_send(*ch, msg);
+    }
+    log_event<LogLevel::Warn>(LogEvent::EmergencyNotified, {(int)from, (int)to});
+}
+
+bool controller_preempt_forward(IntersectionId id, bool enabled) {
+    if (!g_signal_board) return false;
+    ControllerSignal type = enabled ? ControllerSignal::EMERGENCY_INCOMING : ControllerSignal::EMERGENCY_CLEARED;
+    channel_send(controller_channels[signal_board_owner(id)], controller_message(type, -1, (int)id));
+    return true;
+}
+
+bool open_controller_channels(int k, IpcBackend backend) {
+    if (!channel_open(controller_channels[k], backend)) return false;
+    int roads = g_network.in_begin[k + 1] - g_network.in_begin[k];
+    controller_road_channels[k] = vector<ControllerChannel>(roads);
+    for (ControllerChannel &ch : controller_road_channels[k]) {
+        if (!channel_open(ch, backend)) return false;
+    }
+    return true;
+}
+
+void close_controller_channels(int k) {
+    channel_close(controller_channels[k]);
+    for (ControllerChannel &ch : controller_road_channels[k]) channel_close(ch);
+    controller_road_channels[k].clear();
+}
+
+Controller make_controller(int k) {
+    Controller ctrl;
+    ctrl.name = g_network.names[k];
+    ctrl.intersection = (IntersectionId)k;
+    ctrl.inboxes.push_back(&controller_channels[k]);
+    for (ControllerChannel &ch : controller_road_channels[k]) ctrl.inboxes.push_back(&ch);
+    if (g_signal_board) {
+        for (int i = k; i < intersection_count(); i += g_signal_board->controllers) {
+            ctrl.signals.push_back((IntersectionId)i);
+        }
+    }
+    // A controller only receives: drop every inherited sending end so a
+    // pipe sees end of file once the parent is gone
+    for (int c = 0; c < CONTROLLER_COUNT; ++c) {
+        channel_close_send_end(controller_channels[c]);
+        for (ControllerChannel &ch : controller_road_channels[c]) channel_close_send_end(ch);
+    }
+    return ctrl;
+}
+
+// Emergency handling for one destination intersection
+struct PreemptState {
+    bool active;
+    int64_t alert_ns;       // when the alert that set it was received
+    int64_t cleared_ns;     // sent_ns of the last EMERGENCY_CLEARED
+};
+
+// What one controller process has seen on its inboxes
+struct ControllerStats {
+    LatencyHistogram one_way;       // sent_ns -> received
+    vector<uint32_t> expected_seq;  // per inbox
+    vector<PreemptState> preempt;   // per intersection
+    int messages;
+    int emergencies;                // alerts acted on
+    int coalesced;                  // alerts folded into one already acted on
+};
+
+// Set or clear preemption on the board, keeping the light as it is
+static void publish_preempt(IntersectionId id, bool enabled) {
+    if (!g_signal_board) return;
+    uint32_t s = signal_board_read(id);
+    s = enabled ? (s | SIGNAL_PREEMPT) : (s & ~SIGNAL_PREEMPT);
+    if (signal_board_publish(id, s)) signal_board_notify();
+}
+
+// Returns false on SHUTDOWN
+static bool handle_message(const Controller &ctrl, ControllerStats &stats, uint32_t inbox,
+                           const ControllerMessage &msg, int64_t now) {
+    if (msg.version != CONTROLLER_WIRE_VERSION) {
+        log_event<LogLevel::Warn>(LogEvent::ControllerBadMessage,
+                                  {(int)inbox, (int)msg.version, (int)msg.seq}, ctrl.name.c_str());
+        return true;
+    }
+    uint32_t &expected = stats.expected_seq[inbox];
+    if (msg.seq != expected) {
+        log_event<LogLevel::Warn>(LogEvent::ControllerSequenceGap,
+                                  {(int)inbox, (int)expected, (int)msg.seq}, ctrl.name.c_str());
+    }
+    expected = msg.seq + 1;
+    stats.messages++;
+    latency_histogram_record(stats.one_way, (now - msg.sent_ns) / 1e9);
+
+    log_event<LogLevel::Info>(LogEvent::ControllerReceived,
+                              {(int)msg.type, msg.src, msg.vehicle, (int)msg.seq}, ctrl.name.c_str());
+
+    bool target = msg.dst >= 0 && msg.dst < (int)stats.preempt.size();
+    if (msg.type == ControllerSignal::EMERGENCY_INCOMING && target) {
+        PreemptState &p = stats.preempt[msg.dst];
+        // A burst of alerts needs the intersection cleared once: anything
+        // arriving while the last clearing is still in effect joins it. An
+        // alert sent before the latest all-clear (it came down another
+        // channel) is already over.
+        if ((p.active && now - p.alert_ns < (int64_t)EMERGENCY_COALESCE_MS * 1000000) ||
+            msg.sent_ns < p.cleared_ns) {
+            stats.coalesced++;
+            log_event<LogLevel::Debug>(LogEvent::ControllerEmergencyCoalesced,
+                                       {msg.src, msg.vehicle}, ctrl.name.c_str());
+            return true;
         }
+        p.active = true;
+        p.alert_ns = now;
+        stats.emergencies++;
+        log_event<LogLevel::Warn>(LogEvent::ControllerEmergency, {msg.src, msg.vehicle}, ctrl.name.c_str());
+        publish_preempt((IntersectionId)msg.dst, true);
+    } else if (msg.type == ControllerSignal::EMERGENCY_CLEARED && target) {
+        PreemptState &p = stats.preempt[msg.dst];
+        p.active = false;
+        p.cleared_ns = msg.sent_ns;
+        log_event<LogLevel::Info>(LogEvent::ControllerPreemptCleared, {msg.dst}, ctrl.name.c_str());
+        publish_preempt((IntersectionId)msg.dst, false);
+    } else if (msg.type == ControllerSignal::SHUTDOWN) {
+        log_event<LogLevel::Info>(LogEvent::ControllerShutdown, {}, ctrl.name.c_str());
+        return false;
     }
+    // NORMAL can be used later if you want to reset to normal cycle.
+    return true;
 }
+
+// One signal plan group this controller runs, as a timer on its wheel
+struct SignalTimer {
+    TimerNode node;
+    SignalPlanGroup group;
+};
+
+// Publish what `t`'s plan shows at `ms` and arm it for the next change
+static bool run_signal_timer(const Controller &ctrl, TimerWheel &wheel, SignalTimer &t, int64_t ms) {
+    bool green = signal_plan_green(t.group.plan, ms);
+    bool changed = false;
+    for (IntersectionId id : t.group.members) {
+        uint32_t s = signal_board_read(id) & SIGNAL_PREEMPT;
+        if (green) s |= SIGNAL_GREEN;
+        changed |= signal_board_publish(id, s);
+    }
+    timer_wheel_add(wheel, &t.node, (uint64_t)signal_plan_next_change(t.group.plan, ms));
+    log_event<LogLevel::Debug>(LogEvent::ControllerTick,
+                               {(int)t.group.members.size(), (int)(green ? LightColor::GREEN : LightColor::RED)},
+                               ctrl.name.c_str());
+    return changed;
+}
+
         // Controller main loop (runs inside child process)
 void run_controller(Controller ctrl) {
-    {
-        std::lock_guard<std::mutex> lk(g_log_mutex);
-        cout << ANSI_BOLD << ANSI_GREEN << "📡 [Controller " << ctrl.name << "] ONLINE and listening" << ANSI_RESET << endl;
-    }
+    // Forked child: the parent's log writer thread does not exist here
+    log_start();
+    log_event<LogLevel::Info>(LogEvent::ControllerOnline, {}, ctrl.name.c_str());
 
-    while (true) {
-        ControllerSignal sig;
-        int n = read(ctrl.read_fd, &sig, sizeof(sig));
+    int ep = epoll_create1(EPOLL_CLOEXEC);
+    const uint32_t TIMER_TAG = (uint32_t)ctrl.inboxes.size();
+    for (uint32_t i = 0; i < ctrl.inboxes.size(); ++i) {
+        epoll_event ev = {};
+        ev.events = EPOLLIN;
+        ev.data.u32 = i;
+        epoll_ctl(ep, EPOLL_CTL_ADD, channel_wait_fd(*ctrl.inboxes[i]), &ev);
+    }
 
-        if (n <= 0) {
-            // nothing to read; just continue
-            continue;
+    // Signal plans: one timer per plan group of the signals this controller
+    // owns, on a wheel counting ms since the board's epoch. The timerfd is
+    // only ever armed, at an absolute time, for the wheel's next tick, so the
+    // lights change on the plan's own ms whatever else the loop was doing.
+    vector<SignalPlanGroup> groups = signal_plan_groups(ctrl.signals);
+    vector<SignalTimer> signalTimers(groups.size());
+    TimerWheel wheel;
+    timer_wheel_init(wheel, 0);
+    for (size_t i = 0; i < groups.size(); ++i) {
+        SignalTimer &t = signalTimers[i];
+        timer_node_init(t.node, nullptr, &t);
+        t.group = move(groups[i]);
+        timer_wheel_add(wheel, &t.node, (uint64_t)signal_plan_next_change(t.group.plan, 0));
+    }
+    int timer = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC);
+    auto arm_timer = [&] {
+        itimerspec when = {};
+        uint64_t next = timer_wheel_next_tick(wheel);
+        if (next != UINT64_MAX) {
+            int64_t at = g_signal_board->epoch_ns + (int64_t)next * TIMER_TICK_NS;
+            when.it_value.tv_sec = at / 1000000000;
+            when.it_value.tv_nsec = at % 1000000000;
         }
+        timerfd_settime(timer, TFD_TIMER_ABSTIME, &when, NULL);
+    };
+    if (!signalTimers.empty()) arm_timer();
+    epoll_event tev = {};
+    tev.events = EPOLLIN;
+    tev.data.u32 = TIMER_TAG;
+    epoll_ctl(ep, EPOLL_CTL_ADD, timer, &tev);
 
-        {
-            std::lock_guard<std::mutex> lk(g_log_mutex);
-            cout << "[Controller " << ctrl.name << "] Received Signal: "
-                 << signal_name(sig) << endl;
-
-            if (sig == ControllerSignal::EMERGENCY_INCOMING) {
-                cout << ANSI_BOLD << ANSI_RED << "🚨 [Controller " << ctrl.name
-                     << "] EMERGENCY ALERT - Clearing intersection for emergency vehicle" << ANSI_RESET << endl;
-                // Controller process cannot directly modify parent's intersections.
-                // Logging here; parent sets preemption via notify_emergency_from_to.
-            } else if (sig == ControllerSignal::SHUTDOWN) {
-                cout << "[Controller " << ctrl.name << "] Shutting down.\n";
-            }
+    const int BATCH = 64;
+    const int MAX_EVENTS = 16;
+    ControllerMessage batch[BATCH];
+    epoll_event ready[MAX_EVENTS];
+    int openInboxes = (int)ctrl.inboxes.size();
+    bool running = true;
+
+    ControllerStats stats;
+    latency_histogram_reset(stats.one_way);
+    stats.expected_seq.assign(ctrl.inboxes.size(), 0);
+    stats.preempt.assign(intersection_count(), PreemptState{false, 0, 0});
+    stats.messages = stats.emergencies = stats.coalesced = 0;
+
+    // Take everything waiting on an inbox until it is empty (which arms its
+    // wakeup) or closed (which drops it from the set)
+    auto drain_inbox = [&](uint32_t tag) {
+        ControllerChannel &inbox = *ctrl.inboxes[tag];
+        int got;
+        while (running && (got = channel_try_receive(inbox, batch, BATCH)) > 0) {
+            int64_t now = channel_clock_ns();
+            for (int i = 0; i < got && running; ++i) running = handle_message(ctrl, stats, tag, batch[i], now);
         }
+        if (running && got < 0) {
+            epoll_ctl(ep, EPOLL_CTL_DEL, channel_wait_fd(inbox), NULL);
+            openInboxes--;
+            log_event<LogLevel::Warn>(LogEvent::ControllerInboxClosed, {(int)tag}, ctrl.name.c_str());
+        }
+    };
+    // A ring only signals its eventfd once the consumer has found it empty
+    for (uint32_t i = 0; i < ctrl.inboxes.size() && running; ++i) drain_inbox(i);
 
-        if (sig == ControllerSignal::SHUTDOWN) {
+    while (running && openInboxes > 0) {
+        int n = epoll_wait(ep, ready, MAX_EVENTS, -1);   // idle: asleep here
+        if (n == -1) {
+            if (errno == EINTR) continue;
             break;
         }
-        // NORMAL can be used later if you want to reset to normal cycle.
+
+        for (int e = 0; e < n && running; ++e) {
+            uint32_t tag = ready[e].data.u32;
+            if (tag == TIMER_TAG) {
+                uint64_t expirations = 0;
+                if (read(timer, &expirations, sizeof(expirations)) <= 0) continue;
+                uint64_t tick = (uint64_t)((channel_clock_ns() - g_signal_board->epoch_ns) / TIMER_TICK_NS);
+                bool changed = false;
+                for (TimerNode *due = timer_wheel_advance(wheel, tick); due; ) {
+                    TimerNode *next = due->next;
+                    changed |= run_signal_timer(ctrl, wheel, *(SignalTimer*)due->arg, (int64_t)due->expires);
+                    due = next;
+                }
+                if (changed) signal_board_notify();
+                arm_timer();
+                continue;
+            }
+
+            drain_inbox(tag);
+        }
     }
 
+    close(timer);
+    close(ep);
+    log_event<LogLevel::Info>(LogEvent::ControllerIpcStats,
+                              {stats.messages,
+                               (int)(latency_histogram_percentile(stats.one_way, 0.50) * 1e6),
+                               (int)(latency_histogram_percentile(stats.one_way, 0.99) * 1e6),
+                               (int)stats.one_way.max_us,
+                               stats.emergencies, stats.coalesced},
+                              ctrl.name.c_str());
     // Child process ends
+    log_stop();
 }
@@ -0,0 +1,218 @@
+#include "controller_ipc.h"
+#include <new>
+#include <cerrno>
+#include <sched.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <limits.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <sys/eventfd.h>
+using namespace std;
+
+static_assert(atomic<uint32_t>::is_always_lock_free, "ring indices must work across processes");
+static_assert((SHM_RING_CAPACITY & (SHM_RING_CAPACITY - 1)) == 0, "ring capacity must be a power of two");
+
+// Largest batch one write() delivers atomically
+static const int PIPE_BATCH = PIPE_BUF / sizeof(ControllerMessage);
+
+int64_t channel_clock_ns() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+bool channel_open(ControllerChannel &ch, IpcBackend backend) {
+    ch.open = false;
+    ch.backend = backend;
+    ch.fds[0] = ch.fds[1] = -1;
+    ch.ring = nullptr;
+    ch.event_fd = -1;
+    ch.next_seq = 0;
+
+    if (backend == IpcBackend::Pipe) {
+        // Non-blocking read end: receivers wait in poll/epoll, not in read()
+        if (pipe(ch.fds) != 0) return false;
+        if (fcntl(ch.fds[0], F_SETFL, O_NONBLOCK) != 0) {
+            close(ch.fds[0]);
+            close(ch.fds[1]);
+            return false;
+        }
+        pthread_mutex_init(&ch.send_lock, NULL);
+        ch.open = true;
+        return true;
+    }
+
+    void *mem = mmap(NULL, sizeof(ShmRing), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (mem == MAP_FAILED) return false;
+    ch.event_fd = eventfd(0, EFD_NONBLOCK);
+    if (ch.event_fd == -1) {
+        munmap(mem, sizeof(ShmRing));
+        return false;
+    }
+    ch.ring = new (mem) ShmRing();
+    ch.ring->head.store(0, memory_order_relaxed);
+    ch.ring->tail.store(0, memory_order_relaxed);
+    ch.ring->consumer_sleeping.store(0, memory_order_relaxed);
+    pthread_mutex_init(&ch.send_lock, NULL);
+    ch.open = true;
+    return true;
+}
+
+void channel_close(ControllerChannel &ch) {
+    if (!ch.open) return;
+    ch.open = false;
+    pthread_mutex_destroy(&ch.send_lock);
+    if (ch.backend == IpcBackend::Pipe) {
+        if (ch.fds[0] != -1) close(ch.fds[0]);
+        if (ch.fds[1] != -1) close(ch.fds[1]);
+        ch.fds[0] = ch.fds[1] = -1;
+        return;
+    }
+    close(ch.event_fd);
+    munmap(ch.ring, sizeof(ShmRing));
+    ch.ring = nullptr;
+    ch.event_fd = -1;
+}
+
+// Copy `m` with the sender's stamps applied
+static inline ControllerMessage stamped(ControllerChannel &ch, const ControllerMessage &m, int64_t now) {
+    ControllerMessage s = m;
+    s.version = CONTROLLER_WIRE_VERSION;
+    s.seq = ch.next_seq++;
+    s.sent_ns = now;
+    return s;
+}
+
+static bool pipe_send(ControllerChannel &ch, const ControllerMessage *msgs, int n, int64_t now) {
+    ControllerMessage buf[PIPE_BATCH];
+    for (int done = 0; done < n; ) {
+        int k = (n - done < PIPE_BATCH) ? n - done : PIPE_BATCH;
+        for (int i = 0; i < k; ++i) buf[i] = stamped(ch, msgs[done + i], now);
+        ssize_t bytes = k * sizeof(ControllerMessage);
+        ssize_t w;
+        do {
+            w = write(ch.fds[1], buf, bytes);
+        } while (w == -1 && errno == EINTR);
+        if (w != bytes) return false;
+        done += k;
+    }
+    return true;
+}
+
+// After publishing a new tail
+static bool ring_wake(ControllerChannel &ch) {
+    ShmRing &r = *ch.ring;
+    // Pairs with the fence in channel_try_receive: either the consumer sees the
+    // new tail before sleeping, or we see that it sleeps and wake it
+    atomic_thread_fence(memory_order_seq_cst);
+    if (r.consumer_sleeping.load(memory_order_relaxed) &&
+        r.consumer_sleeping.exchange(0, memory_order_relaxed)) {
+        uint64_t one = 1;
+        if (write(ch.event_fd, &one, sizeof(one)) != (ssize_t)sizeof(one)) return false;
+    }
+    return true;
+}
+
+bool channel_send_batch(ControllerChannel &ch, const ControllerMessage *msgs, int n) {
+    if (!ch.open) return false;
+    if (n <= 0) return true;
+    int64_t now = channel_clock_ns();
+
+    if (ch.backend == IpcBackend::Pipe) {
+        pthread_mutex_lock(&ch.send_lock);
+        bool ok = pipe_send(ch, msgs, n, now);
+        pthread_mutex_unlock(&ch.send_lock);
+        return ok;
+    }
+
+    ShmRing &r = *ch.ring;
+    pthread_mutex_lock(&ch.send_lock);
+    uint32_t tail = r.tail.load(memory_order_relaxed);
+    for (int i = 0; i < n; ) {
+        uint32_t room = SHM_RING_CAPACITY - (tail - r.head.load(memory_order_acquire));
+        if (room == 0) {
+            // Full: publish what we have so the consumer can make progress
+            r.tail.store(tail, memory_order_release);
+            if (!ring_wake(ch)) {
+                pthread_mutex_unlock(&ch.send_lock);
+                return false;
+            }
+            sched_yield();
+            continue;
+        }
+        for (; room > 0 && i < n; --room, ++i, ++tail) {
+            r.slots[tail & (SHM_RING_CAPACITY - 1)] = stamped(ch, msgs[i], now);
+        }
+    }
+    r.tail.store(tail, memory_order_release);
+    pthread_mutex_unlock(&ch.send_lock);
+    return ring_wake(ch);
+}
+
+bool channel_send(ControllerChannel &ch, const ControllerMessage &msg) {
+    return channel_send_batch(ch, &msg, 1);
+}
+
+// Take whatever the producer has published, up to `max`
+static int ring_drain(ShmRing &r, ControllerMessage *out, int max) {
+    uint32_t head = r.head.load(memory_order_relaxed);
+    uint32_t avail = r.tail.load(memory_order_acquire) - head;
+    int n = (int)(avail < (uint32_t)max ? avail : (uint32_t)max);
+    for (int i = 0; i < n; ++i) out[i] = r.slots[(head + i) & (SHM_RING_CAPACITY - 1)];
+    r.head.store(head + n, memory_order_release);
+    return n;
+}
+
+int channel_try_receive(ControllerChannel &ch, ControllerMessage *out, int max) {
+    if (ch.backend == IpcBackend::Pipe) {
+        // Every write is whole records, so a read of whole records never
+        // splits one
+        ssize_t bytes;
+        do {
+            bytes = read(ch.fds[0], out, max * sizeof(ControllerMessage));
+        } while (bytes == -1 && errno == EINTR);
+        if (bytes == -1) return errno == EAGAIN ? 0 : -1;
+        if (bytes == 0) return -1;   // every sender closed its end
+        return (int)(bytes / sizeof(ControllerMessage));
+    }
+
+    ShmRing &r = *ch.ring;
+    int n = ring_drain(r, out, max);
+    if (n > 0) return n;
+
+    // Going idle: clear wakeups already consumed, announce the sleep, then
+    // look once more so a message published meanwhile is not slept through
+    uint64_t stale;
+    if (read(ch.event_fd, &stale, sizeof(stale)) == -1 && errno != EAGAIN) return -1;
+    r.consumer_sleeping.store(1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_seq_cst);
+    n = ring_drain(r, out, max);
+    if (n > 0) r.consumer_sleeping.store(0, memory_order_relaxed);
+    return n;
+}
+
+int channel_wait_fd(const ControllerChannel &ch) {
+    return ch.backend == IpcBackend::Pipe ? ch.fds[0] : ch.event_fd;
+}
+
+int channel_receive(ControllerChannel &ch, ControllerMessage *out, int max) {
+    while (true) {
+        int n = channel_try_receive(ch, out, max);
+        if (n != 0) return n;
+        pollfd pfd = {channel_wait_fd(ch), POLLIN, 0};
+        if (poll(&pfd, 1, -1) == -1 && errno != EINTR) return -1;
+    }
+}
+
+void channel_close_send_end(ControllerChannel &ch) {
+    if (ch.open && ch.backend == IpcBackend::Pipe && ch.fds[1] != -1) {
+        close(ch.fds[1]);
+        ch.fds[1] = -1;
+    }
+}
+
+const char* ipc_backend_name(IpcBackend backend) {
+    return backend == IpcBackend::Pipe ? "pipe" : "shared ring";
+}
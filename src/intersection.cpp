@@ -1,35 +1,27 @@
 #include "intersection.h"
-#include <iostream>
-#include <unistd.h>   // sleep
+#include <unistd.h>
 #include <sstream>
-#include <iomanip>
+#include <algorithm>
+#include <atomic>
+#include <vector>
+#include <ctime>
+#include <cerrno>
 using namespace std;
 // UI hooks
 #include "ui_shared.h"
+#include "log.h"
+#include "network.h"
+#include "signal_board.h"
+#include "timer_wheel.h"
+#include "vehicle_store.h"
 
-// ANSI Color Codes
-#define ANSI_RESET   "\033[0m"
-#define ANSI_BOLD    "\033[1m"
-#define ANSI_RED     "\033[31m"
-#define ANSI_GREEN   "\033[32m"
-#define ANSI_YELLOW  "\033[33m"
-#define ANSI_BLUE    "\033[34m"
-#define ANSI_MAGENTA "\033[35m"
-#define ANSI_CYAN    "\033[36m"
-#define ANSI_BG_RED  "\033[41m"
-#define ANSI_BG_GREEN "\033[42m"
-
-// Define the global intersections here
-Intersection F10_intersection;
-Intersection F11_intersection;
-
-// Internal: traffic light manager thread
+// Internal: traffic light manager (or signal follower) thread
 static pthread_t traffic_thread;
-static bool traffic_running = false;
+static atomic<bool> traffic_running(false);
 
 string intersection_name(IntersectionId id) {
-    if (id == IntersectionId::F10) return "F10";
-    return "F11";
+    if ((int)id < 0 || (int)id >= intersection_count()) return "#" + to_string((int)id);
+    return g_network.names[(int)id];
 }
 
 void init_intersection(Intersection &I, IntersectionId id) {
@@ -37,191 +29,545 @@ void init_intersection(Intersection &I, IntersectionId id) {
     I.busy = false;
     I.light = LightColor::RED;   // will be set properly by traffic manager
     I.emergency_preempt = false;
-    I.active_count = 0;
-    I.active_straight = false;
-    I.active_left = false;
-    I.active_right = false;
+    four_way_conflicts(I.conflicts);
+    I.occupied = 0;
+    for (int &c : I.slot_count) c = 0;
 
     pthread_mutex_init(&I.lock, NULL);
     pthread_cond_init(&I.canPass, NULL);
+    for (auto &row : I.waiting) {
+        for (WaitList &q : row) wait_list_init(q);
+    }
+    I.queued = 0;
+    I.next_ticket = 0;
+    I.clock = intersection_wall_clock;
+    I.wake_policy = WakePolicy::Targeted;
+    I.wakeups = 0;
+    I.admissions = 0;
+    I.wait_time = new LatencyHistogram[PRIORITY_LEVELS];
+    for (int p = 0; p < PRIORITY_LEVELS; ++p) latency_histogram_reset(I.wait_time[p]);
 }
 
-// ---- Vehicle entering intersection respecting lights ----
-void enter_intersection(Intersection &I, Vehicle *v) {
-    pthread_mutex_lock(&I.lock);
+static bool is_emergency(const Vehicle *v) {
+    return v->type == VehicleType::Ambulance || v->type == VehicleType::FireTruck;
+}
+
+static int priority_level(const Vehicle *v) {
+    return min((int)v->priority, PRIORITY_LEVELS - 1);
+}
+
+// Boundary points of the box in clockwise order, starting at the north edge.
+// With right-hand traffic each edge is entered on its first half and left on
+// its second, so a movement is a chord from in(approach) to out(exit).
+static int entry_point(int approach) { return 2 * approach; }
+static int exit_point(int side)      { return 2 * side + 1; }
+
+// Two chords cross when exactly one endpoint of one lies strictly inside the other
+static bool chords_cross(int a1, int a2, int b1, int b2) {
+    if (a1 > a2) swap(a1, a2);
+    auto inside = [a1, a2](int p) { return a1 < p && p < a2; };
+    bool shared = (b1 == a1 || b1 == a2 || b2 == a1 || b2 == a2);
+    return !shared && inside(b1) != inside(b2);
+}
+
+void four_way_conflicts(uint16_t conflicts[MOVEMENT_SLOTS]) {
+    for (int s = 0; s < MOVEMENT_SLOTS; ++s) {
+        conflicts[s] = 0;
+        int sExit = (int)exit_side((Approach)(s / 3), (Direction)(s % 3));
+        for (int t = 0; t < MOVEMENT_SLOTS; ++t) {
+            if (s == t) continue;   // same lane and movement: vehicles follow each other
+            int tExit = (int)exit_side((Approach)(t / 3), (Direction)(t % 3));
+            bool merge = (sExit == tExit);
+            bool cross = chords_cross(entry_point(s / 3), exit_point(sExit),
+                                      entry_point(t / 3), exit_point(tExit));
+            if (merge || cross) conflicts[s] |= (uint16_t)(1u << t);
+        }
+    }
+}
+
+// Determine non-conflicting concurrency eligibility for a movement slot.
+// Caller must hold I.lock.
+static bool movement_open(const Intersection &I, int slot) {
+    return (I.occupied & I.conflicts[slot]) == 0;
+}
+
+// Current light and preemption. When the controllers own the signal the
+// board is authoritative; I.light is a delayed mirror the signal follower
+// keeps for the UI and logging. Caller must hold I.lock.
+static void read_signal(const Intersection &I, bool &green, bool &preempt) {
+    green = (I.light == LightColor::GREEN);
+    preempt = I.emergency_preempt;
+    if (g_signal_board) {
+        uint32_t s = signal_board_read(I.id);
+        green = (s & SIGNAL_GREEN) != 0;
+        preempt = (s & SIGNAL_PREEMPT) != 0;
+    }
+}
+
+// Does the signal (light / emergency preemption) let this vehicle go?
+// Caller must hold I.lock.
+static bool signal_allows(const Intersection &I, const Vehicle *v) {
+    if (is_emergency(v)) {
+        // Emergency vehicles ignore ANSI_RED/ ANSI_GREEN, only wait for intersection to be free.
+        return true;
+    }
+    // Normal vehicle must obey ANSI_GREEN *and* intersection must be free.
+    // Additionally, if emergency preemption is active, non-emergency must wait
+    // Medium priority for Bus: allow entry on ANSI_RED when intersection is free and no emergency preempt
+    bool green, preempt;
+    read_signal(I, green, preempt);
+    bool bus_red_override = (v->type == VehicleType::Bus) && !preempt;
+    return (!preempt && green) || bus_red_override;
+}
+
+// ---- Admission rule shared by the blocking and event-driven paths ----
+// Caller must hold I.lock.
+static bool can_enter_now(const Intersection &I, const Vehicle *v) {
+    return signal_allows(I, v) && movement_open(I, movement_slot(v));
+}
+
+// Register the vehicle as crossing after `waited` seconds. Caller must hold I.lock.
+static void register_entry(Intersection &I, Vehicle *v, double waited) {
+    // Register active movement
+    int slot = movement_slot(v);
+    I.slot_count[slot]++;
+    I.occupied |= (uint16_t)(1u << slot);
+    I.busy = true; // busy now indicates occupancy
+    I.admissions++;
+    latency_histogram_record(I.wait_time[priority_level(v)], waited);
+    vehicle_set_state(v, VehicleState::Crossing, I.id);
+
+    bool green, preempt;
+    read_signal(I, green, preempt);
+    LightColor light = green ? LightColor::GREEN : LightColor::RED;
+    log_event<LogLevel::Info>(LogEvent::IntersectionEntered,
+                              {v->id, (int)v->type, (int)I.id, (int)light});
+    // UI: vehicle enter
+    if (ui_active()) {
+        ui_notify_vehicle_enter(I.id, v);
+        std::ostringstream oss;
+        oss << "V" << v->id << " " << to_string(v->type) << " entered " << intersection_name(I.id);
+        ui_log_event(oss.str());
+    }
 
-    bool isEmergency =
-        (v->type == VehicleType::Ambulance ||
-         v->type == VehicleType::FireTruck);
+    if (I.occupied != (1u << slot) || I.slot_count[slot] > 1) {
+        int inside = 0;
+        for (int c : I.slot_count) inside += c;
+        log_event<LogLevel::Info>(LogEvent::IntersectionConcurrent, {(int)I.id, inside});
+    }
+}
+
+// ---- Admission queue ----
+// A blocked vehicle thread queues this on its own stack. It is signalled while
+// the admitting thread still holds I.lock, so the waiter cannot return and
+// destroy `cv` before the signal completes.
+struct BlockedThread {
+    pthread_cond_t cv;
+    bool admitted;
+};
+
+static void signal_blocked_thread(void *arg) {
+    BlockedThread *t = (BlockedThread*)arg;
+    t->admitted = true;
+    pthread_cond_signal(&t->cv);
+}
 
-    while (true) {
-        // Determine non-conflicting concurrency eligibility
-        bool noActive = (I.active_count == 0);
-        bool straightCompat = (v->direction == Direction::Straight) && I.active_straight && !I.active_left && !I.active_right;
-        bool canEnterNow = noActive || straightCompat;
+double intersection_wall_clock() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Effective priority after aging: every ADMISSION_AGING_SECONDS spent waiting
+// counts as one priority level, so any vehicle eventually outranks newcomers.
+static double admission_rank(const WaitNode *n, double now) {
+    return priority_level(n->vehicle) - (now - n->queued_at) / ADMISSION_AGING_SECONDS;
+}
 
-        if (isEmergency) {
-            // Emergency vehicles ignore ANSI_RED/ ANSI_GREEN, only wait for intersection to be free.
-            if (canEnterNow) break;
+// Admit queued vehicles in rank order (effective priority, then arrival).
+// A vehicle the signal lets go but whose movement conflicts with the vehicles
+// inside is held: nobody whose movement conflicts with it is admitted past it,
+// so a stream of straight-through traffic cannot starve a turn. Vehicles that
+// do not conflict with any held one may still enter alongside.
+//
+// Every vehicle in one (priority, movement) queue is admissible exactly when
+// its head is and ranks behind it, so only the heads are compared.
+// Blocked threads are signalled right here; admitted journeys are returned as
+// a chain for the caller to resume once I.lock is released. Caller must hold I.lock.
+static WaitNode* admit_waiters(Intersection &I) {
+    WaitNode *resumeHead = nullptr, *resumeTail = nullptr;
+    if (I.queued == 0) return nullptr;
+    double now = I.clock();
+
+    struct Candidate { double rank; unsigned long ticket; WaitList *q; };
+    Candidate cand[PRIORITY_LEVELS * MOVEMENT_SLOTS];
+
+    for (;;) {
+        int count = 0;
+        for (auto &row : I.waiting) {
+            for (WaitList &q : row) {
+                if (!q.head || !signal_allows(I, q.head->vehicle)) continue;
+                cand[count++] = {admission_rank(q.head, now), q.head->ticket, &q};
+            }
+        }
+        sort(cand, cand + count, [](const Candidate &a, const Candidate &b) {
+            return a.rank < b.rank || (a.rank == b.rank && a.ticket < b.ticket);
+        });
+
+        WaitList *best = nullptr;
+        uint16_t held = 0;
+        for (int i = 0; i < count && !best; ++i) {
+            int slot = movement_slot(cand[i].q->head->vehicle);
+            if (movement_open(I, slot) && (I.conflicts[slot] & held) == 0) best = cand[i].q;
+            else held |= (uint16_t)(1u << slot);
+        }
+        if (!best) break;
+
+        WaitNode *n = wait_list_pop(*best);
+        I.queued--;
+        register_entry(I, n->vehicle, now - n->queued_at);
+        if (n->wake == signal_blocked_thread) {
+            n->wake(n->arg);
         } else {
-            // Normal vehicle must obey ANSI_GREEN *and* intersection must be free.
-            // Additionally, if emergency preemption is active, non-emergency must wait
-            // Medium priority for Bus: allow entry on ANSI_RED when intersection is free and no emergency preempt
-            bool bus_red_override = (v->type == VehicleType::Bus) && !I.emergency_preempt && canEnterNow;
-            if ((!I.emergency_preempt && I.light == LightColor::GREEN && canEnterNow) || bus_red_override) break;
+            if (resumeTail) resumeTail->next = n;
+            else resumeHead = n;
+            resumeTail = n;
         }
+    }
+    return resumeHead;
+}
 
+// Caller must hold I.lock
+static void queue_waiter(Intersection &I, WaitNode *node) {
+    node->ticket = I.next_ticket++;
+    node->queued_at = I.clock();
+    wait_list_push(I.waiting[priority_level(node->vehicle)][movement_slot(node->vehicle)], node);
+    I.queued++;
+}
+
+// Let waiters re-check after a state change, then release I.lock and resume
+// the journeys that were admitted.
+static void admit_and_unlock(Intersection &I) {
+    if (I.wake_policy == WakePolicy::Broadcast) pthread_cond_broadcast(&I.canPass);
+    WaitNode *admitted = admit_waiters(I);
+    for (WaitNode *n = admitted; n; n = n->next) I.wakeups++;
+    pthread_mutex_unlock(&I.lock);
+    wait_list_wake_chain(admitted);
+}
+
+// Admission pass right after queueing `node`. The signal board changes
+// outside I.lock, so the pass may admit other waiters too: true if `node`
+// was admitted, and `others` gets the rest of the admitted journeys for the
+// caller to resume once I.lock is released. Caller must hold I.lock.
+static bool admit_queued(Intersection &I, WaitNode *node, WaitNode *&others) {
+    bool admitted = false;
+    others = admit_waiters(I);
+    for (WaitNode **link = &others; *link;) {
+        if (*link == node) {
+            *link = node->next;
+            node->next = nullptr;
+            admitted = true;
+        } else {
+            I.wakeups++;
+            link = &(*link)->next;
+        }
+    }
+    return admitted;
+}
+
+// ---- Vehicle entering intersection respecting lights ----
+void enter_intersection(Intersection &I, Vehicle *v) {
+    pthread_mutex_lock(&I.lock);
+
+    if (I.wake_policy == WakePolicy::Broadcast) {
+        double since = I.clock();
         // Wait for condition: either light changes or intersection/movement becomes available
-        pthread_cond_wait(&I.canPass, &I.lock);
+        while (!can_enter_now(I, v)) {
+            pthread_cond_wait(&I.canPass, &I.lock);
+            I.wakeups++;
+        }
+        register_entry(I, v, I.clock() - since);
+        pthread_mutex_unlock(&I.lock);
+        return;
+    }
+    if (I.queued == 0 && can_enter_now(I, v)) {
+        register_entry(I, v, 0.0);
+        pthread_mutex_unlock(&I.lock);
+        return;
     }
 
-    // Register active movement
-    if (v->direction == Direction::Straight) I.active_straight = true;
-    else if (v->direction == Direction::Left) I.active_left = true;
-    else I.active_right = true;
-    I.active_count++;
-    I.busy = (I.active_count > 0); // busy now indicates occupancy
-
-    cout << ANSI_BOLD << ANSI_GREEN << "▶️  [Vehicle #" << setw(2) << v->id
-         << " " << to_string(v->type)
-         << "] ENTERED " << intersection_name(I.id) << ANSI_RESET;
-    if (I.light == LightColor::GREEN) {
-        cout << ANSI_BG_GREEN << " [GREEN] " << ANSI_RESET << endl;
-    } else {
-        cout << ANSI_BG_RED << " [RED] " << ANSI_RESET << " (Emergency/Bus Priority)" << endl;
+    // Take a place in the queue; whoever admits us registers the entry first.
+    // The admission pass may also admit journeys queued before us (the board
+    // changed since they were last checked): resume them outside I.lock.
+    BlockedThread self;
+    pthread_cond_init(&self.cv, NULL);
+    self.admitted = false;
+    WaitNode node;
+    node.wake = signal_blocked_thread;
+    node.arg = &self;
+    node.vehicle = v;
+    queue_waiter(I, &node);
+    WaitNode *others;
+    admit_queued(I, &node, others);   // a blocked thread is signalled, never chained
+    if (others) {
+        pthread_mutex_unlock(&I.lock);
+        wait_list_wake_chain(others);
+        pthread_mutex_lock(&I.lock);
     }
-    // UI: vehicle enter
-    ui_notify_vehicle_enter(I.id, v);
-    std::ostringstream oss;
-    oss << "V" << v->id << " " << to_string(v->type) << " entered " << intersection_name(I.id);
-    ui_log_event(oss.str());
+    while (!self.admitted) {
+        pthread_cond_wait(&self.cv, &I.lock);
+        I.wakeups++;
+    }
+    pthread_cond_destroy(&self.cv);
+
+    pthread_mutex_unlock(&I.lock);
+}
 
-    if (I.active_count > 1) {
-        cout << ANSI_BOLD << ANSI_MAGENTA << "  🔀 [" << intersection_name(I.id)
-             << "] Concurrent movement: " << I.active_count << " vehicles crossing" << ANSI_RESET << endl;
+// ---- Non-blocking entry for suspended journeys ----
+bool try_enter_or_park(Intersection &I, Vehicle *v, WaitNode *node) {
+    pthread_mutex_lock(&I.lock);
+    bool entered = false;
+    WaitNode *others = nullptr;
+    if (I.queued == 0 && can_enter_now(I, v)) {
+        register_entry(I, v, 0.0);
+        entered = true;
+    } else {
+        // Checked and queued atomically: no lost wakeup. If the admission
+        // pass admits this node it need not sleep; others it admits, as above,
+        // are resumed after unlocking.
+        queue_waiter(I, node);
+        entered = admit_queued(I, node, others);
     }
+    pthread_mutex_unlock(&I.lock);
+    wait_list_wake_chain(others);
+    return entered;
+}
 
+void drop_suspended_journeys(Intersection &I) {
+    pthread_mutex_lock(&I.lock);
+    for (auto &row : I.waiting) {
+        for (WaitList &q : row) wait_list_init(q);
+    }
+    I.queued = 0;
     pthread_mutex_unlock(&I.lock);
 }
 
+// ---- Admission metrics ----
+static void log_wait_stats(int intersection, const LatencyHistogram *wait) {
+    static const char *levelNames[PRIORITY_LEVELS] = {"ambulance", "fire truck", "bus", "car/bike/tractor"};
+    for (int p = 0; p < PRIORITY_LEVELS; ++p) {
+        const LatencyHistogram &h = wait[p];
+        if (h.total == 0) continue;
+        log_event<LogLevel::Info>(LogEvent::IntersectionWaitStats,
+                                  {intersection, p, (int)h.total,
+                                   (int)(latency_histogram_percentile(h, 0.50) * 1000),
+                                   (int)(latency_histogram_percentile(h, 0.99) * 1000),
+                                   (int)(h.max_us / 1000)},
+                                  levelNames[p]);
+    }
+}
+
+void log_admission_metrics() {
+    const int PER_INTERSECTION_LIMIT = 4;
+    if (intersection_count() <= PER_INTERSECTION_LIMIT) {
+        for (Intersection &I : g_network.intersections) {
+            pthread_mutex_lock(&I.lock);
+            log_wait_stats((int)I.id, I.wait_time);
+            pthread_mutex_unlock(&I.lock);
+        }
+        return;
+    }
+    vector<LatencyHistogram> merged(PRIORITY_LEVELS);
+    for (LatencyHistogram &h : merged) latency_histogram_reset(h);
+    for (Intersection &I : g_network.intersections) {
+        pthread_mutex_lock(&I.lock);
+        for (int p = 0; p < PRIORITY_LEVELS; ++p) latency_histogram_merge(merged[p], I.wait_time[p]);
+        pthread_mutex_unlock(&I.lock);
+    }
+    log_wait_stats(-1, merged.data());
+}
+
 // ---- Vehicle leaving intersection ----
 void leave_intersection(Intersection &I, Vehicle *v) {
     pthread_mutex_lock(&I.lock);
 
     // Deregister movement
-    if (v->direction == Direction::Straight) I.active_straight = false;
-    else if (v->direction == Direction::Left) I.active_left = false;
-    else I.active_right = false;
-    if (I.active_count > 0) I.active_count--;
-    I.busy = (I.active_count > 0);
-
-    cout << ANSI_BOLD << ANSI_BLUE << "◀️  [Vehicle #" << setw(2) << v->id
-         << " " << to_string(v->type)
-         << "] EXITED " << intersection_name(I.id) << ANSI_RESET << endl;
+    int slot = movement_slot(v);
+    if (I.slot_count[slot] > 0 && --I.slot_count[slot] == 0) {
+        I.occupied &= (uint16_t)~(1u << slot);
+    }
+    I.busy = (I.occupied != 0);
+
+    log_event<LogLevel::Info>(LogEvent::IntersectionExited, {v->id, (int)v->type, (int)I.id});
     // UI: vehicle exit
-    ui_notify_vehicle_exit(I.id, v);
-    std::ostringstream oss;
-    oss << "V" << v->id << " exited " << intersection_name(I.id);
-    ui_log_event(oss.str());
+    if (ui_active()) {
+        ui_notify_vehicle_exit(I.id, v);
+        std::ostringstream oss;
+        oss << "V" << v->id << " exited " << intersection_name(I.id);
+        ui_log_event(oss.str());
+    }
 
-    // Wake up waiting vehicles to re-check conditions
-    pthread_cond_broadcast(&I.canPass);
-    pthread_mutex_unlock(&I.lock);
+    // Admit whoever the freed movement lets through
+    admit_and_unlock(I);
 }
 
 // ---- Traffic light manager thread function ----
-static void set_light(Intersection &I, LightColor color, const char *label) {
+void set_light(Intersection &I, LightColor color, const char *label) {
     pthread_mutex_lock(&I.lock);
     I.light = color;
-    
-    if (color == LightColor::GREEN) {
-        cout << ANSI_BOLD << ANSI_BG_GREEN << " 🚦 " << ANSI_RESET << ANSI_GREEN << " [" << label << "] "
-             << intersection_name(I.id) << " → GREEN" << ANSI_RESET << endl;
-    } else {
-        cout << ANSI_BOLD << ANSI_BG_RED << " 🚦 " << ANSI_RESET << ANSI_RED << " [" << label << "] "
-             << intersection_name(I.id) << " → RED" << ANSI_RESET << endl;
-    }
+
+    log_event<LogLevel::Info>(LogEvent::LightChanged, {(int)I.id, (int)color}, label);
     // notify UI
-    ui_update_signal(I.id, color);
-    std::ostringstream oss;
-    oss << intersection_name(I.id) << " light -> " << (color == LightColor::GREEN ? "GREEN" : "RED");
-    ui_log_event(oss.str());
-    // Wake all vehicles waiting here so they can re-check the light
-    pthread_cond_broadcast(&I.canPass);
-    pthread_mutex_unlock(&I.lock);
+    if (ui_active()) {
+        ui_update_signal(I.id, color);
+        std::ostringstream oss;
+        oss << intersection_name(I.id) << " light -> " << (color == LightColor::GREEN ? "GREEN" : "RED");
+        ui_log_event(oss.str());
+    }
+    // Admit the vehicles the new light lets through
+    admit_and_unlock(I);
 }
 
-static void* traffic_light_manager(void* arg) {
-    (void)arg;
+// ---- Traffic light manager ----
+// One timer on the timer service per group of intersections sharing a signal
+// plan. Each change is scheduled at the plan's absolute time since the
+// manager started, so cycles never drift however late a callback runs.
+struct LightTimer {
+    TimerNode node;
+    SignalPlanGroup group;
+    int64_t due_ms;        // plan time the timer is armed for
+};
+
+static vector<LightTimer> light_timers;
+static int64_t lights_epoch_ns;
+
+static void light_timer_fired(void *arg) {
+    LightTimer &t = *(LightTimer*)arg;
+    if (!traffic_running) return;
+    set_group_lights(t.group, t.due_ms, "Cycle");
+    t.due_ms = signal_plan_next_change(t.group.plan, t.due_ms);
+    timer_service_add_at(&t.node, lights_epoch_ns + t.due_ms * 1000000);
+}
 
-    cout << ANSI_BOLD << ANSI_YELLOW << "\n🚦 [TRAFFIC CONTROL] Light manager started - 3s cycle" << ANSI_RESET << endl;
+static void start_light_manager() {
+    vector<SignalPlanGroup> groups = signal_plan_groups(0, intersection_count());
+    log_event<LogLevel::Info>(LogEvent::LightManagerStarted, {(int)groups.size()});
+
+    timer_service_start();
+    light_timers.resize(groups.size());
+    lights_epoch_ns = timer_service_clock_ns();
+    for (size_t i = 0; i < groups.size(); ++i) {
+        LightTimer &t = light_timers[i];
+        timer_node_init(t.node, light_timer_fired, &t);
+        t.group = move(groups[i]);
+        set_group_lights(t.group, 0, "Initial");
+        t.due_ms = signal_plan_next_change(t.group.plan, 0);
+        timer_service_add_at(&t.node, lights_epoch_ns + t.due_ms * 1000000);
+    }
+}
 
-    // Initial state: F10 ANSI_GREEN, F11 ANSI_RED
-    set_light(F10_intersection, LightColor::GREEN, "Initial");
-    set_light(F11_intersection, LightColor::RED,   "Initial");
+static void stop_light_manager() {
+    for (LightTimer &t : light_timers) timer_service_cancel(&t.node);
+    light_timers.clear();
+    timer_service_stop();
+    log_event<LogLevel::Info>(LogEvent::LightManagerStopped);
+}
 
-    while (traffic_running) {
-        // F10 ANSI_GREEN, F11 ANSI_RED
-        sleep(3); // keep this state for 3 seconds
-        if (!traffic_running) break;
+static void apply_emergency_preempt(Intersection &I, bool enabled);
 
-        // Switch: F10 ANSI_RED, F11 ANSI_GREEN
-        set_light(F10_intersection, LightColor::RED,   "Cycle");
-        set_light(F11_intersection, LightColor::GREEN, "Cycle");
+// ---- Signal follower thread ----
+// Used instead of the light manager while the controllers own the signals.
+// It keeps no time: it sleeps until a controller publishes, then mirrors every
+// changed board entry into its intersection and admits whoever the new state
+// lets through.
+static void* signal_follower(void* arg) {
+    (void)arg;
+    SignalBoard &board = *g_signal_board;
+    log_event<LogLevel::Info>(LogEvent::SignalFollowerStarted, {board.controllers, (int)signal_plan_groups(0, board.intersections).size()});
 
-        sleep(3);
-        if (!traffic_running) break;
+    vector<uint32_t> seen(board.intersections, SIGNAL_GREEN);
+    const char *label = "Initial";
+    bool first = true;
+    while (traffic_running) {
+        for (int i = 0; i < board.intersections; ++i) {
+            uint32_t s = board.state[i].load(memory_order_acquire);
+            uint32_t changed = first ? (SIGNAL_GREEN | SIGNAL_PREEMPT) : (s ^ seen[i]);
+            seen[i] = s;
+            if (!changed) continue;
+            Intersection &I = g_network.intersections[i];
+            if (changed & SIGNAL_GREEN) set_light(I, (s & SIGNAL_GREEN) ? LightColor::GREEN : LightColor::RED, label);
+            if ((changed & SIGNAL_PREEMPT) && (!first || (s & SIGNAL_PREEMPT))) {
+                apply_emergency_preempt(I, (s & SIGNAL_PREEMPT) != 0);
+            }
+        }
+        first = false;
+        label = "Cycle";
 
-        // Switch back: F10 ANSI_GREEN, F11 ANSI_RED
-        set_light(F10_intersection, LightColor::GREEN, "Cycle");
-        set_light(F11_intersection, LightColor::RED,   "Cycle");
+        uint64_t posted;
+        if (read(board.event_fd, &posted, sizeof(posted)) == -1 && errno != EINTR) break;
     }
 
-    cout << "[TRAFFIC] Traffic light manager stopping.\n";
+    log_event<LogLevel::Info>(LogEvent::SignalFollowerStopped);
     return NULL;
 }
 
 // ---- Public API for main.cpp ----
 void start_traffic_lights() {
     traffic_running = true;
-    pthread_create(&traffic_thread, NULL, traffic_light_manager, NULL);
+    if (g_signal_board) {
+        pthread_create(&traffic_thread, NULL, signal_follower, NULL);
+    } else {
+        start_light_manager();
+    }
 }
 
 void stop_traffic_lights() {
     traffic_running = false;
+    if (g_signal_board) {
+        uint64_t one = 1;
+        if (write(g_signal_board->event_fd, &one, sizeof(one)) == -1) {
+            // Cannot fail on a fresh counter; the follower would block
+        }
+    }
     // Wake all waiting vehicles so they don't block forever
-    pthread_mutex_lock(&F10_intersection.lock);
-    pthread_cond_broadcast(&F10_intersection.canPass);
-    pthread_mutex_unlock(&F10_intersection.lock);
-
-    pthread_mutex_lock(&F11_intersection.lock);
-    pthread_cond_broadcast(&F11_intersection.canPass);
-    pthread_mutex_unlock(&F11_intersection.lock);
+    for (Intersection &I : g_network.intersections) {
+        pthread_mutex_lock(&I.lock);
+        admit_and_unlock(I);
+    }
 
-    pthread_join(traffic_thread, NULL);
+    if (g_signal_board) {
+        pthread_join(traffic_thread, NULL);
+    } else {
+        stop_light_manager();
+    }
 }
 
 // ---- Emergency preemption controls ----
-void set_emergency_preempt(IntersectionId id, bool enabled) {
-    Intersection *I = (id == IntersectionId::F10) ? &F10_intersection : &F11_intersection;
-    pthread_mutex_lock(&I->lock);
-    I->emergency_preempt = enabled;
-    // Setting preempt to true should wake threads to re-check conditions (they will block if non-emergency)
-    // Clearing preempt should also wake threads to allow progress
-    pthread_cond_broadcast(&I->canPass);
-    pthread_mutex_unlock(&I->lock);
+bool (*emergency_preempt_forward)(IntersectionId id, bool enabled) = nullptr;
+
+static void apply_emergency_preempt(Intersection &I, bool enabled) {
+    pthread_mutex_lock(&I.lock);
+    I.emergency_preempt = enabled;
+    // Clearing preempt lets queued vehicles through; setting it admits nobody new
+    admit_and_unlock(I);
     // Notify UI
-    ui_notify_emergency_preempt(id, enabled);
+    if (!ui_active()) return;
+    ui_notify_emergency_preempt(I.id, enabled);
     if (enabled) {
         std::ostringstream oss;
-        oss << "EMERGENCY preempt at " << intersection_name(id);
+        oss << "EMERGENCY preempt at " << intersection_name(I.id);
         ui_log_event(oss.str());
     }
 }
 
+void set_emergency_preempt(IntersectionId id, bool enabled) {
+    if (emergency_preempt_forward && emergency_preempt_forward(id, enabled)) return;
+    apply_emergency_preempt(intersection_at(id), enabled);
+}
+
 bool is_emergency_preempt(IntersectionId id) {
-    Intersection *I = (id == IntersectionId::F10) ? &F10_intersection : &F11_intersection;
-    return I->emergency_preempt;
+    if (g_signal_board) return (signal_board_read(id) & SIGNAL_PREEMPT) != 0;
+    return intersection_at(id).emergency_preempt;
 }
 
 // ---- Resource cleanup ----
@@ -233,4 +579,6 @@ void destroy_intersection(Intersection &I) {
     pthread_mutex_unlock(&I.lock);
     pthread_mutex_destroy(&I.lock);
     pthread_cond_destroy(&I.canPass);
+    delete[] I.wait_time;
+    I.wait_time = nullptr;
 }
@@ -0,0 +1,164 @@
+#include "journey.h"
+#include <exception>
+using namespace std;
+
+#include "intersection.h"
+#include "parking.h"
+#include "network.h"
+#include "ui_shared.h"
+#include "vehicle_store.h"
+
+// ---------------- COROUTINE TYPE ----------------
+struct JourneyCoroutine {
+    struct promise_type {
+        JourneyCoroutine get_return_object() {
+            return JourneyCoroutine{coroutine_handle<promise_type>::from_promise(*this)};
+        }
+        suspend_always initial_suspend() noexcept { return {}; }
+        suspend_never final_suspend() noexcept { return {}; }   // frame frees itself when done
+        void return_void() {}
+        void unhandled_exception() { std::terminate(); }
+    };
+
+    coroutine_handle<promise_type> handle;
+};
+
+// ---------------- AWAITABLES ----------------
+// In every await_suspend below, once the node is parked (or the timer armed)
+// the journey may already be resumed on another worker: nothing after that
+// point may touch the awaiter.
+
+// Wait for the light / a compatible movement; resumes already inside.
+struct EnterIntersection {
+    Intersection &I;
+    VehicleJourney *j;
+
+    bool await_ready() const noexcept { return false; }
+    bool await_suspend(coroutine_handle<>) {
+        return !try_enter_or_park(I, j->v, &j->node);
+    }
+    void await_resume() const noexcept {}
+};
+
+// Reserve a spot through the bounded queue; resumes with true if holding one.
+struct ReserveParking {
+    ParkingLot &lot;
+    VehicleJourney *j;
+    ParkingReservation result;
+
+    bool await_ready() {
+        result = try_reserve_parking_spot(lot, j->v);
+        return result != ParkingReservation::Queued;
+    }
+    bool await_suspend(coroutine_handle<>) {
+        return !claim_or_park_parking_spot(lot, j->v, &j->node);
+    }
+    bool await_resume() const noexcept {
+        return result != ParkingReservation::Skipped;
+    }
+};
+
+// Crossing / parking time on the executor's clock
+struct Delay {
+    VehicleJourney *j;
+    double seconds;
+
+    bool await_ready() const noexcept { return seconds <= 0.0; }
+    void await_suspend(coroutine_handle<>) { j->host->resume_after(j, seconds); }
+    void await_resume() const noexcept {}
+};
+
+// Drive to the next intersection; may resume on another thread
+struct Travel {
+    VehicleJourney *j;
+    IntersectionId to;
+    double seconds;
+
+    bool await_ready() const noexcept { return false; }
+    void await_suspend(coroutine_handle<>) { j->host->travel(j, to, seconds); }
+    void await_resume() const noexcept {}
+};
+
+// ---------------- VEHICLE COROUTINE ----------------
+// Same lifecycle as vehicle_thread_func, suspending instead of blocking
+static JourneyCoroutine vehicle_journey(VehicleJourney *j) {
+    Vehicle *v = j->v;
+
+    vehicle_announce(v);
+
+    // Determine intersection + parking lot
+    Intersection *I = origin_intersection(v);
+    ParkingLot *lot = origin_parking(v);
+
+    bool hasReservedParking = false;
+
+    if (vehicle_may_park(v)) {
+        hasReservedParking = co_await ReserveParking{*lot, j, ParkingReservation::Skipped};
+        if (!hasReservedParking) vehicle_parking_skipped(v);
+    }
+
+    vehicle_approach(v);
+
+    // Request to enter intersection (suspends until admitted)
+    co_await EnterIntersection{*I, j};
+
+    // Time taken to cross intersection
+    co_await Delay{j, (double)crossing_seconds(v)};
+
+    leave_intersection(*I, v);
+
+    // Hosts that model roads drive the vehicle on and across its destination
+    const RoadLink *road = j->host->travel ? vehicle_road(v) : nullptr;
+    if (!road) vehicle_cleared_intersection(v);
+
+    // If parking was reserved, now simulate actual parking usage
+    if (hasReservedParking) {
+        if (ui_active()) ui_notify_vehicle_parking(v->id, true, v->parking_spot);
+        park_vehicle(*lot, v);
+        co_await Delay{j, (double)parking_seconds(v)};
+        release_parking_spot(*lot, v);
+        if (ui_active()) ui_notify_vehicle_parking(v->id, false, -1);
+    }
+
+    if (road) {
+        vehicle_set_state(v, VehicleState::Driving, road->to);
+        co_await Travel{j, road->to, ROAD_TRAVEL_SECONDS};
+        vehicle_arrive(v, road);
+        vehicle_approach(v);
+
+        Intersection *D = &intersection_at(road->to);
+        co_await EnterIntersection{*D, j};
+        co_await Delay{j, (double)crossing_seconds(v)};
+        leave_intersection(*D, v);
+
+        vehicle_cleared_destination(v);
+    }
+
+    vehicle_complete(v);
+    j->handle = nullptr;   // the frame frees itself at the final suspend
+    j->host->finished(j);
+}
+
+// ---------------- HOST INTERFACE ----------------
+static void journey_wake(void *arg) {
+    VehicleJourney *j = (VehicleJourney*)arg;
+    j->host->resume(j);
+}
+
+void journey_init(VehicleJourney &j, Vehicle *v, const JourneyHost *host, void *host_data) {
+    j.v = v;
+    j.host = host;
+    j.host_data = host_data;
+    j.node.wake = journey_wake;
+    j.node.arg = &j;
+    j.node.vehicle = v;
+    j.node.ticket = 0;
+    j.node.queued_at = 0;
+    j.node.next = nullptr;
+    j.handle = vehicle_journey(&j).handle;
+}
+
+void journey_destroy(VehicleJourney &j) {
+    if (j.handle) j.handle.destroy();
+    j.handle = nullptr;
+}
@@ -0,0 +1,511 @@
+#include "log.h"
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <cstdio>
+#include <ctime>
+#include <sched.h>
+#include <unistd.h>
+using namespace std;
+
+#include "vehicle.h"
+#include "intersection.h"
+#include "controller.h"
+
+// ANSI Color Codes
+#define ANSI_RESET   "\033[0m"
+#define ANSI_BOLD    "\033[1m"
+#define ANSI_RED     "\033[31m"
+#define ANSI_GREEN   "\033[32m"
+#define ANSI_YELLOW  "\033[33m"
+#define ANSI_BLUE    "\033[34m"
+#define ANSI_MAGENTA "\033[35m"
+#define ANSI_CYAN    "\033[36m"
+#define ANSI_BG_RED  "\033[41m"
+#define ANSI_BG_GREEN "\033[42m"
+
+static_assert(sizeof(LogRecord) == 64, "LogRecord should stay one cache line");
+
+// ------------- PER-THREAD RINGS -----------------
+// Single producer (the owning thread), single consumer (the writer thread).
+// A ring whose thread has exited is reused by the next new thread once drained.
+static const size_t RING_CAPACITY = 512;   // power of two
+
+struct LogRing {
+    alignas(64) atomic<size_t> head{0};    // next record to read  (consumer)
+    alignas(64) atomic<size_t> tail{0};    // next record to write (producer)
+    atomic<bool> retired{false};
+    LogRecord slots[RING_CAPACITY];
+};
+
+static mutex registry_mutex;                // only taken when a thread first logs
+static vector<LogRing*> registry;
+static atomic<unsigned> registry_version(0);
+
+static atomic<bool> writer_running(false);
+static atomic<bool> writer_stop(false);
+static thread writer_thread;
+static mutex sync_write_mutex;              // fallback path when no writer runs
+
+// Retires the ring when its thread exits
+struct RingOwner {
+    LogRing *ring = nullptr;
+    ~RingOwner() {
+        if (ring) ring->retired.store(true, memory_order_release);
+    }
+};
+static thread_local RingOwner tl_ring;
+
+static LogRing* acquire_ring() {
+    lock_guard<mutex> lk(registry_mutex);
+    for (LogRing *r : registry) {
+        if (r->retired.load(memory_order_acquire) &&
+            r->head.load(memory_order_acquire) == r->tail.load(memory_order_acquire)) {
+            r->retired.store(false, memory_order_relaxed);
+            return r;
+        }
+    }
+    LogRing *r = new LogRing();
+    registry.push_back(r);
+    registry_version.fetch_add(1, memory_order_release);
+    return r;
+}
+
+// ------------- FORMATTING (writer thread) -----------------
+static const char* vehicle_emoji(VehicleType type) {
+    switch (type) {
+        case VehicleType::Ambulance: return "🚑";
+        case VehicleType::FireTruck: return "🚒";
+        case VehicleType::Bus:       return "🚌";
+        case VehicleType::Car:       return "🚗";
+        case VehicleType::Bike:      return "🚲";
+        case VehicleType::Tractor:   return "🚜";
+    }
+    return "🚙";
+}
+
+static const char* vehicle_color(VehicleType type) {
+    if (type == VehicleType::Ambulance || type == VehicleType::FireTruck) return ANSI_RED;
+    if (type == VehicleType::Bus) return ANSI_YELLOW;
+    if (type == VehicleType::Bike || type == VehicleType::Tractor) return ANSI_GREEN;
+    return ANSI_BLUE;
+}
+
+// Equivalent of `setw(2) << id`
+static void append_id2(string &out, int id) {
+    if (id >= 0 && id < 10) out += ' ';
+    out += to_string(id);
+}
+
+static void append_fixed(string &out, double value, int precision) {
+    char buf[64];
+    snprintf(buf, sizeof(buf), "%.*f", precision, value);
+    out += buf;
+}
+
+static void format_record(const LogRecord &r, string &out) {
+    const int32_t *a = r.arg;
+    const char *text = r.text ? r.text : "";
+    VehicleType type = static_cast<VehicleType>(a[1]);
+
+    switch (r.event) {
+    case LogEvent::VehicleSpawned: {
+        IntersectionId origin = static_cast<IntersectionId>(a[2]);
+        IntersectionId dest = static_cast<IntersectionId>(a[3]);
+        out += ANSI_BOLD; out += vehicle_color(type); out += "\n"; out += vehicle_emoji(type);
+        out += " [Vehicle #"; append_id2(out, a[0]); out += "] "; out += to_string(type); out += ANSI_RESET "\n";
+        out += "  ├─ Origin: " ANSI_CYAN; out += to_string(origin);
+        out += ANSI_RESET " → Destination: " ANSI_CYAN; out += to_string(dest); out += ANSI_RESET "\n";
+        out += "  ├─ Direction: "; out += to_string(static_cast<Direction>(a[4]));
+        out += " | Priority: " ANSI_MAGENTA; out += to_string(compute_priority(type)); out += ANSI_RESET "\n";
+        out += "  └─ Parking: "; out += a[5] ? ANSI_GREEN "YES" : "NO"; out += ANSI_RESET "\n";
+        break;
+    }
+    case LogEvent::VehicleParkingPassThrough:
+        out += ANSI_YELLOW "  ⚠️  [Vehicle #"; out += to_string(a[0]);
+        out += "] Could not reserve parking - will pass through" ANSI_RESET "\n";
+        break;
+    case LogEvent::VehicleApproaching:
+        out += ANSI_CYAN "  ➤ [Vehicle #"; out += to_string(a[0]); out += "] Approaching 🚦 ";
+        out += intersection_name(static_cast<IntersectionId>(a[1]));
+        out += " from "; out += to_string(static_cast<Approach>(a[2]));
+        out += " ("; out += to_string(static_cast<Direction>(a[3])); out += ")" ANSI_RESET "\n";
+        break;
+    case LogEvent::VehicleArrived:
+        out += ANSI_CYAN "  🛣️  [Vehicle #"; out += to_string(a[0]); out += "] Drove from ";
+        out += intersection_name(static_cast<IntersectionId>(a[1])); out += " to ";
+        out += intersection_name(static_cast<IntersectionId>(a[2])); out += ANSI_RESET "\n";
+        break;
+    case LogEvent::VehicleCompleted:
+        out += ANSI_BOLD ANSI_GREEN "  ✓ [Vehicle #"; out += to_string(a[0]);
+        out += "] Journey completed successfully" ANSI_RESET "\n";
+        break;
+    case LogEvent::VehicleStoreReady:
+        out += ANSI_BLUE "  📦 [VEHICLES] "; out += to_string(a[0]); out += " vehicles, ";
+        out += to_string(a[1]); out += " bytes each, in a "; out += to_string(a[2]);
+        out += " MB arena ("; out += a[3] ? "huge pages" : "THP advised"; out += ")" ANSI_RESET "\n";
+        break;
+    case LogEvent::VehicleCensus:
+        out += ANSI_BLUE "  📊 [VEHICLES] Pending "; out += to_string(a[0]);
+        out += " | waiting "; out += to_string(a[1]);
+        out += " | crossing "; out += to_string(a[2]);
+        out += " | parked "; out += to_string(a[3]);
+        out += " | driving "; out += to_string(a[4]);
+        out += " | done "; out += to_string(a[5]); out += ANSI_RESET "\n";
+        break;
+    case LogEvent::TraceReadFailed:
+        out += ANSI_BOLD ANSI_RED "  ⚠️  [TRACE] "; out += text; out += ":"; out += to_string(a[1]);
+        out += " is not a valid arrival: the run's vehicles end before #"; out += to_string(a[0]);
+        out += ANSI_RESET "\n";
+        break;
+    case LogEvent::ArrivalLag:
+        out += ANSI_BLUE "  ⏱️  [ARRIVALS] "; out += to_string(a[0]); out += " released at ";
+        out += to_string(a[1]); out += " vehicles/h, behind schedule p50 "; out += to_string(a[2]);
+        out += " us | p99 "; out += to_string(a[3]); out += " us | max "; out += to_string(a[4]);
+        out += " us | "; out += to_string(a[5]); out += " over 10 ms late" ANSI_RESET "\n";
+        break;
+
+    case LogEvent::IntersectionEntered:
+        out += ANSI_BOLD ANSI_GREEN "▶️  [Vehicle #"; append_id2(out, a[0]);
+        out += " "; out += to_string(type); out += "] ENTERED ";
+        out += intersection_name(static_cast<IntersectionId>(a[2])); out += ANSI_RESET;
+        if (static_cast<LightColor>(a[3]) == LightColor::GREEN) out += ANSI_BG_GREEN " [GREEN] " ANSI_RESET "\n";
+        else out += ANSI_BG_RED " [RED] " ANSI_RESET " (Emergency/Bus Priority)\n";
+        break;
+    case LogEvent::IntersectionConcurrent:
+        out += ANSI_BOLD ANSI_MAGENTA "  🔀 ["; out += intersection_name(static_cast<IntersectionId>(a[0]));
+        out += "] Concurrent movement: "; out += to_string(a[1]); out += " vehicles crossing" ANSI_RESET "\n";
+        break;
+    case LogEvent::IntersectionWaitStats:
+        out += ANSI_BLUE "  📊 [";
+        out += (a[0] < 0) ? "all intersections" : intersection_name(static_cast<IntersectionId>(a[0]));
+        out += "] Wait before entry, priority "; out += to_string(a[1]);
+        out += " ("; out += text; out += "): "; out += to_string(a[2]);
+        out += " vehicles | p50 "; out += to_string(a[3]);
+        out += " ms | p99 "; out += to_string(a[4]);
+        out += " ms | max "; out += to_string(a[5]); out += " ms" ANSI_RESET "\n";
+        break;
+    case LogEvent::IntersectionExited:
+        out += ANSI_BOLD ANSI_BLUE "◀️  [Vehicle #"; append_id2(out, a[0]);
+        out += " "; out += to_string(type); out += "] EXITED ";
+        out += intersection_name(static_cast<IntersectionId>(a[2])); out += ANSI_RESET "\n";
+        break;
+    case LogEvent::LightChanged: {
+        bool green = static_cast<LightColor>(a[1]) == LightColor::GREEN;
+        out += green ? ANSI_BOLD ANSI_BG_GREEN " 🚦 " ANSI_RESET ANSI_GREEN " ["
+                     : ANSI_BOLD ANSI_BG_RED " 🚦 " ANSI_RESET ANSI_RED " [";
+        out += text; out += "] "; out += intersection_name(static_cast<IntersectionId>(a[0]));
+        out += green ? " → GREEN" ANSI_RESET "\n" : " → RED" ANSI_RESET "\n";
+        break;
+    }
+    case LogEvent::LightManagerStarted:
+        out += ANSI_BOLD ANSI_YELLOW "\n🚦 [TRAFFIC CONTROL] Light manager started - "; out += to_string(a[0]);
+        out += " signal plan(s)" ANSI_RESET "\n";
+        break;
+    case LogEvent::LightManagerStopped:
+        out += "[TRAFFIC] Traffic light manager stopping.\n";
+        break;
+    case LogEvent::SignalFollowerStarted:
+        out += ANSI_BOLD ANSI_YELLOW "\n🚦 [TRAFFIC CONTROL] Signals run by "; out += to_string(a[0]);
+        out += " controller process(es) - "; out += to_string(a[1]); out += " signal plan(s)" ANSI_RESET "\n";
+        break;
+    case LogEvent::SignalFollowerStopped:
+        out += "[TRAFFIC] Signal follower stopping.\n";
+        break;
+
+    case LogEvent::ParkingRequested:
+        out += ANSI_CYAN "  🅿️  [Vehicle #"; out += to_string(a[0]); out += "] Requesting parking at ";
+        out += text; out += ANSI_RESET "\n";
+        break;
+    case LogEvent::ParkingPreemptSkip:
+        out += ANSI_BOLD ANSI_RED "  ⚠️  [Vehicle #"; out += to_string(a[0]);
+        out += "] Emergency preemption active - skipping parking" ANSI_RESET "\n";
+        break;
+    case LogEvent::ParkingQueueFull:
+        out += ANSI_YELLOW "  ⚠️  [Vehicle #"; out += to_string(a[0]);
+        out += "] Parking queue FULL - skipping parking" ANSI_RESET "\n";
+        break;
+    case LogEvent::ParkingQueued:
+        out += "[Vehicle "; out += to_string(a[0]); out += "] entered waiting queue at "; out += text; out += "\n";
+        break;
+    case LogEvent::ParkingWaiting:
+        out += "[Vehicle "; out += to_string(a[0]); out += "] waiting for free spot at "; out += text; out += "\n";
+        break;
+    case LogEvent::ParkingReserved:
+        out += ANSI_BOLD ANSI_GREEN "  ✓ [Vehicle #"; out += to_string(a[0]); out += "] RESERVED parking spot #"; out += to_string(a[4]);
+        out += " (level "; out += to_string(a[3]); out += ") at ";
+        out += text; out += " ("; out += to_string(a[1]); out += "/"; out += to_string(a[2]);
+        out += " occupied)" ANSI_RESET "\n";
+        break;
+    case LogEvent::ParkingParked:
+        out += ANSI_MAGENTA "  🅿️  [Vehicle #"; out += to_string(a[0]); out += "] Now PARKED at ";
+        out += text; out += ANSI_RESET "\n";
+        break;
+    case LogEvent::ParkingLeft:
+        out += ANSI_CYAN "  ➤ [Vehicle #"; out += to_string(a[0]); out += "] LEFT parking at ";
+        out += text; out += " ("; out += to_string(a[1]); out += "/"; out += to_string(a[2]);
+        out += " occupied)" ANSI_RESET "\n";
+        break;
+    case LogEvent::ParkingDeparturesDue:
+        out += "[PARKING] "; out += to_string(a[0]); out += " departure(s) due\n";
+        break;
+    case LogEvent::ParkingManagerStopped:
+        out += ANSI_CYAN "🅿️  [PARKING] Manager released "; out += to_string(a[0]);
+        out += " parked vehicle(s) in "; out += to_string(a[1]); out += " batch(es), at most ";
+        out += to_string(a[2]); out += " parked at once" ANSI_RESET "\n";
+        break;
+    case LogEvent::ParkingGaveUp:
+        out += ANSI_YELLOW "  ⌛ [Vehicle #"; out += to_string(a[0]); out += "] Gave up waiting for parking at ";
+        out += text; out += " after "; out += to_string(a[1]); out += " ms" ANSI_RESET "\n";
+        break;
+    case LogEvent::ParkingWaitStats:
+        out += ANSI_BLUE "  📊 ["; out += (a[0] < 0) ? "all parking lots" : text;
+        out += "] Wait for a spot: "; out += to_string(a[1]);
+        out += " granted, "; out += to_string(a[2]);
+        out += " gave up | p50 "; out += to_string(a[3]);
+        out += " ms | p99 "; out += to_string(a[4]);
+        out += " ms | max "; out += to_string(a[5]); out += " ms" ANSI_RESET "\n";
+        break;
+    case LogEvent::ParkingQueueStats:
+        out += ANSI_BLUE "  📊 ["; out += (a[0] < 0) ? "all parking lots" : text;
+        out += "] Queue on joining: "; out += to_string(a[1]);
+        out += " vehicles | p50 "; out += to_string(a[2]);
+        out += " | p99 "; out += to_string(a[3]);
+        out += " | max "; out += to_string(a[4]);
+        out += " of "; out += to_string(a[5]); out += ANSI_RESET "\n";
+        break;
+
+    case LogEvent::EmergencyNotified: {
+        string from = intersection_name(static_cast<IntersectionId>(a[0]));
+        string to = intersection_name(static_cast<IntersectionId>(a[1]));
+        out += ANSI_BOLD ANSI_RED "🚨 [PARENT] Emergency "; out += from; out += "→"; out += to;
+        out += ": Preempting "; out += to; out += " intersection" ANSI_RESET "\n";
+        break;
+    }
+    case LogEvent::ControllerOnline:
+        out += ANSI_BOLD ANSI_GREEN "📡 [Controller "; out += text; out += "] ONLINE and listening" ANSI_RESET "\n";
+        break;
+    case LogEvent::ControllerReceived:
+        out += "[Controller "; out += text; out += "] Received Signal: ";
+        out += signal_name(static_cast<ControllerSignal>(a[0]));
+        out += " (#"; out += to_string(a[3]);
+        if (a[1] >= 0) { out += " from "; out += intersection_name(static_cast<IntersectionId>(a[1])); }
+        if (a[2] > 0) { out += ", vehicle #"; append_id2(out, a[2]); }
+        out += ")\n";
+        break;
+    case LogEvent::ControllerEmergency:
+        out += ANSI_BOLD ANSI_RED "🚨 [Controller "; out += text;
+        out += "] EMERGENCY ALERT - Clearing intersection for emergency vehicle #"; append_id2(out, a[1]);
+        out += " from "; out += intersection_name(static_cast<IntersectionId>(a[0])); out += ANSI_RESET "\n";
+        break;
+    case LogEvent::ControllerEmergencyCoalesced:
+        out += "[Controller "; out += text; out += "] Emergency alert for vehicle #"; append_id2(out, a[1]);
+        out += " joins the clearing already in progress\n";
+        break;
+    case LogEvent::ControllerPreemptCleared:
+        out += "[Controller "; out += text; out += "] Emergency over, releasing ";
+        out += intersection_name(static_cast<IntersectionId>(a[0])); out += "\n";
+        break;
+    case LogEvent::ControllerShutdown:
+        out += "[Controller "; out += text; out += "] Shutting down.\n";
+        break;
+
+    case LogEvent::ControllerTick:
+        out += "[Controller "; out += text; out += "] "; out += to_string(a[0]);
+        out += a[1] == (int)LightColor::GREEN ? " signal(s) GREEN\n" : " signal(s) RED\n";
+        break;
+
+    case LogEvent::ControllerInboxClosed:
+        out += "[Controller "; out += text; out += "] Inbox "; out += to_string(a[0]);
+        out += " closed by sender.\n";
+        break;
+
+    case LogEvent::ControllerBadMessage:
+        out += ANSI_YELLOW "[Controller "; out += text; out += "] Inbox "; out += to_string(a[0]);
+        out += ": dropped message #"; out += to_string(a[2]); out += " with wire version ";
+        out += to_string(a[1]); out += ANSI_RESET "\n";
+        break;
+
+    case LogEvent::ControllerSequenceGap:
+        out += ANSI_YELLOW "[Controller "; out += text; out += "] Inbox "; out += to_string(a[0]);
+        out += ": expected message #"; out += to_string(a[1]); out += ", got #";
+        out += to_string(a[2]); out += ANSI_RESET "\n";
+        break;
+
+    case LogEvent::ControllerIpcStats:
+        out += ANSI_BLUE "  📊 [Controller "; out += text; out += "] "; out += to_string(a[0]);
+        out += " messages | one-way p50 "; out += to_string(a[1]);
+        out += " us | p99 "; out += to_string(a[2]);
+        out += " us | max "; out += to_string(a[3]); out += " us | emergencies ";
+        out += to_string(a[4]); out += " (+"; out += to_string(a[5]); out += " coalesced)" ANSI_RESET "\n";
+        break;
+
+    case LogEvent::DesStarted:
+        out += ANSI_BOLD ANSI_YELLOW "\n⏱️  [DES] Discrete-event engine started - virtual clock, ";
+        out += to_string(a[0]); out += "s light cycle" ANSI_RESET "\n";
+        break;
+    case LogEvent::DesFinished:
+        out += ANSI_BOLD ANSI_GREEN "\n✓ [DES] Simulated "; append_fixed(out, r.x[0], 1);
+        out += "s of traffic in "; append_fixed(out, r.x[1], 3); out += "s wall-clock" ANSI_RESET "\n";
+        out += ANSI_BLUE "  └─ Events processed: "; out += to_string(a[0]);
+        out += " | Vehicles still waiting: "; out += to_string(a[1]); out += ANSI_RESET "\n";
+        break;
+    case LogEvent::PoolStarted:
+        out += ANSI_BOLD ANSI_YELLOW "\n🧵 [POOL] "; out += to_string(a[0]);
+        out += " workers with work-stealing deques - vehicles run as tasks" ANSI_RESET "\n";
+        break;
+    case LogEvent::PoolStopped:
+        out += ANSI_BOLD ANSI_GREEN "\n✓ [POOL] Worker pool stopped" ANSI_RESET "\n";
+        out += ANSI_BLUE "  └─ Journeys unfinished: "; out += to_string(a[0]); out += ANSI_RESET "\n";
+        break;
+    case LogEvent::PartitionsStarted:
+        out += ANSI_BOLD ANSI_YELLOW "\n⏱️  [PDES] "; out += to_string(a[1]);
+        out += " intersections in "; out += to_string(a[0]);
+        out += " partitions - virtual clock, "; out += to_string(a[2]);
+        out += "s light cycle, "; append_fixed(out, r.x[0], 1); out += "s lookahead" ANSI_RESET "\n";
+        break;
+    case LogEvent::PartitionsFinished:
+        out += ANSI_BOLD ANSI_GREEN "\n✓ [PDES] Simulated "; append_fixed(out, r.x[0], 1);
+        out += "s of traffic in "; append_fixed(out, r.x[1], 3); out += "s wall-clock" ANSI_RESET "\n";
+        out += ANSI_BLUE "  └─ Events processed: "; out += to_string(a[0]);
+        out += " | Partition handoffs: "; out += to_string(a[1]);
+        out += " | Vehicles still waiting: "; out += to_string(a[2]); out += ANSI_RESET "\n";
+        break;
+
+    case LogEvent::SystemSpawning:
+        out += ANSI_BOLD ANSI_YELLOW "\n🚗 [SIMULATION] Spawning ";
+        out += a[0] < 0 ? string("the trace's") : to_string(a[0]);
+        out += " vehicles..." ANSI_RESET "\n";
+        out += ANSI_CYAN; out += string(70, '-'); out += ANSI_RESET "\n\n";
+        break;
+    case LogEvent::SystemAllCompleted:
+        out += ANSI_BOLD ANSI_CYAN "\n"; out += string(70, '='); out += ANSI_RESET "\n";
+        out += ANSI_BOLD ANSI_GREEN "✓ [SYSTEM] All vehicles completed their journeys" ANSI_RESET "\n";
+        out += ANSI_YELLOW "  └─ Initiating graceful shutdown sequence..." ANSI_RESET "\n";
+        break;
+    case LogEvent::SystemCleanupIntersections:
+        out += ANSI_BLUE "  └─ Cleaning up intersection resources..." ANSI_RESET "\n";
+        break;
+    case LogEvent::SystemCleanupParking:
+        out += ANSI_BLUE "  └─ Cleaning up parking lot resources..." ANSI_RESET "\n";
+        break;
+    }
+}
+
+static void write_all(const string &out) {
+    size_t done = 0;
+    while (done < out.size()) {
+        ssize_t n = write(STDOUT_FILENO, out.data() + done, out.size() - done);
+        if (n <= 0) return;
+        done += (size_t)n;
+    }
+}
+
+// ------------- WRITER THREAD -----------------
+static const size_t WRITE_BATCH_BYTES = 64 * 1024;
+
+static void writer_loop() {
+    vector<LogRing*> rings;
+    unsigned seenVersion = ~0u;
+    vector<LogRecord> batch;
+    string out;
+    out.reserve(2 * WRITE_BATCH_BYTES);
+
+    while (true) {
+        bool stopping = writer_stop.load(memory_order_acquire);
+
+        if (registry_version.load(memory_order_acquire) != seenVersion) {
+            lock_guard<mutex> lk(registry_mutex);
+            rings = registry;
+            seenVersion = registry_version.load(memory_order_relaxed);
+        }
+
+        // Collect everything published so far from every ring...
+        batch.clear();
+        for (LogRing *r : rings) {
+            size_t head = r->head.load(memory_order_relaxed);
+            size_t tail = r->tail.load(memory_order_acquire);
+            for (; head != tail; ++head) batch.push_back(r->slots[head & (RING_CAPACITY - 1)]);
+            r->head.store(head, memory_order_release);
+        }
+
+        // ...and emit it in call order across threads
+        stable_sort(batch.begin(), batch.end(),
+                    [](const LogRecord &x, const LogRecord &y) { return x.ns < y.ns; });
+        for (const LogRecord &r : batch) {
+            format_record(r, out);
+            if (out.size() >= WRITE_BATCH_BYTES) {
+                write_all(out);
+                out.clear();
+            }
+        }
+        if (!out.empty()) {
+            write_all(out);
+            out.clear();
+        }
+
+        if (batch.empty()) {
+            if (stopping) break;   // stop was requested before this final empty sweep
+            usleep(1000);
+        }
+    }
+}
+
+// ------------- PUBLIC API -----------------
+void log_start() {
+    if (writer_running.load()) return;
+    fflush(stdout);
+    writer_stop.store(false);
+    writer_running.store(true);
+    writer_thread = thread(writer_loop);
+}
+
+void log_stop() {
+    if (!writer_running.load()) return;
+    writer_stop.store(true, memory_order_release);
+    writer_thread.join();
+    writer_running.store(false);
+}
+
+static uint64_t monotonic_ns() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+void log_push(LogEvent event, LogLevel level, std::initializer_list<int32_t> args,
+              const char *text, double x0, double x1) {
+    LogRecord rec;
+    rec.ns = monotonic_ns();
+    rec.event = event;
+    rec.level = level;
+    size_t i = 0;
+    for (int32_t v : args) {
+        if (i == 6) break;
+        rec.arg[i++] = v;
+    }
+    for (; i < 6; ++i) rec.arg[i] = 0;
+    rec.x[0] = x0;
+    rec.x[1] = x1;
+    rec.text = text;
+
+    if (!writer_running.load(memory_order_acquire)) {
+        string out;
+        format_record(rec, out);
+        lock_guard<mutex> lk(sync_write_mutex);
+        write_all(out);
+        return;
+    }
+
+    LogRing *r = tl_ring.ring;
+    if (!r) r = tl_ring.ring = acquire_ring();
+
+    size_t tail = r->tail.load(memory_order_relaxed);
+    // Full ring: wait for the writer rather than drop simulation output
+    while (tail - r->head.load(memory_order_acquire) >= RING_CAPACITY) sched_yield();
+    r->slots[tail & (RING_CAPACITY - 1)] = rec;
+    r->tail.store(tail + 1, memory_order_release);
+}
@@ -2,13 +2,14 @@
 #include <pthread.h>
 #include <vector>
 #include <cstdlib>
+#include <climits>
 #include <ctime>
 #include <unistd.h>
 #include <sys/wait.h>
 #include <signal.h>
 #include <iomanip>
-#include <mutex>
 #include <sstream>
+#include <algorithm>
 using namespace std;
 
 // ANSI color codes for terminal output
@@ -28,13 +29,13 @@ using namespace std;
 #include "parking.h"
 #include "controller.h"
 #include "ui_shared.h"
-
-// Global log mutex for thread-safe output
-mutex g_log_mutex;
-
-// Define the pipes here (storage for the extern in controller.cpp)
-int pipeF10toF11[2];
-int pipeF11toF10[2];
+#include "sim_engine.h"
+#include "task_pool.h"
+#include "log.h"
+#include "network.h"
+#include "signal_board.h"
+#include "timer_wheel.h"
+#include "vehicle_store.h"
 
 static volatile sig_atomic_t g_shutdown = 0;
 
@@ -42,133 +43,288 @@ static void sigint_handler(int){
     g_shutdown = 1;
 }
 
+// How vehicle journeys are executed
+enum class RunMode {
+    Realtime,   // one pthread per vehicle, wall-clock sleeps (default)
+    Discrete,   // discrete-event engine on a virtual clock
+    Pool,       // vehicles as resumable tasks on a work-stealing worker pool
+    Parallel    // discrete-event engine split into per-thread network partitions
+};
+
+static void print_usage(const char *prog) {
+    cerr << "Usage: " << prog << " [num_vehicles] [--mode=realtime|des|pool|parallel] [--workers=N] [--scenario=FILE] [--ipc=shm|pipe] [--seed=N] [--rate=V] [--workload=FILE | --trace=FILE] [--no-ui]\n";
+}
+
 int main(int argc, char** argv) {
-    srand(time(NULL));
     signal(SIGINT, sigint_handler);
 
+    int NUM_VEHICLES = 15;
+    bool countGiven = false;
+    RunMode mode = RunMode::Realtime;
+    int NUM_WORKERS = 0;   // pool threads / partitions: 0 = one per CPU
+    string scenario;       // empty = built-in F10 & F11 layout
+    IpcBackend ipc = IpcBackend::SharedRing;
+    uint64_t seed = sim_random_seed_from_clock();   // --seed=N repeats a run
+    bool seedGiven = false;
+    string workloadPath;   // empty = draw vehicles from the seed
+    string tracePath;      // or replay a CSV arrival trace
+    double rate = -1;      // Poisson arrivals per second, overriding the scenario's
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        if (arg == "--mode=realtime") {
+            mode = RunMode::Realtime;
+        } else if (arg == "--mode=des") {
+            mode = RunMode::Discrete;
+        } else if (arg == "--mode=pool") {
+            mode = RunMode::Pool;
+        } else if (arg == "--mode=parallel") {
+            mode = RunMode::Parallel;
+        } else if (arg.rfind("--workers=", 0) == 0) {
+            NUM_WORKERS = atoi(arg.c_str() + 10);
+        } else if (arg.rfind("--scenario=", 0) == 0) {
+            scenario = arg.substr(11);
+        } else if (arg == "--ipc=shm") {
+            ipc = IpcBackend::SharedRing;
+        } else if (arg == "--ipc=pipe") {
+            ipc = IpcBackend::Pipe;
+        } else if (arg.rfind("--seed=", 0) == 0) {
+            seed = strtoull(arg.c_str() + 7, NULL, 10);
+            seedGiven = true;
+        } else if (arg.rfind("--workload=", 0) == 0) {
+            workloadPath = arg.substr(11);
+        } else if (arg.rfind("--rate=", 0) == 0) {
+            rate = atof(arg.c_str() + 7);
+            if (rate <= 0) {
+                print_usage(argv[0]);
+                return 1;
+            }
+        } else if (arg.rfind("--trace=", 0) == 0) {
+            tracePath = arg.substr(8);
+        } else if (arg == "--no-ui") {
+            ui_set_enabled(false);
+        } else if (arg.rfind("--", 0) == 0) {
+            print_usage(argv[0]);
+            return 1;
+        } else {
+            int n = atoi(argv[i]);
+            if (n > 0) {
+                NUM_VEHICLES = n;
+                countGiven = true;
+            }
+        }
+    }
+
+    if (!workloadPath.empty() && !tracePath.empty()) {
+        cerr << "--workload and --trace both supply the vehicles: pick one\n";
+        return 1;
+    }
+    sim_random_seed(seed);
+
+    // Load the road network before forking so the controllers know it too
+    string error;
+    bool loaded = scenario.empty() ? network_load_default(error) : network_load_file(scenario, error);
+    if (!loaded) {
+        cerr << "Failed to load scenario: " << error << "\n";
+        return 1;
+    }
+    int numControllers = min(CONTROLLER_COUNT, intersection_count());
+    TrafficProfile &traffic = g_network.traffic;
+    if (rate > 0) {
+        for (double &r : traffic.approach_rate) r = rate / 4;
+    }
+    double totalRate = 0;
+    for (double r : traffic.approach_rate) totalRate += r;
+
+    // A workload supplies the vehicles (all of them, unless a count is given)
+    // and, unless overridden, the seed that drew them, so the run replays the
+    // one it was generated from
+    Workload workload = {};
+    if (!workloadPath.empty()) {
+        if (!workload_open(workloadPath, workload, error)) {
+            cerr << "Failed to load workload: " << error << "\n";
+            return 1;
+        }
+        size_t available = min(workload.count, (size_t)INT_MAX);
+        NUM_VEHICLES = countGiven ? (int)min((size_t)NUM_VEHICLES, available) : (int)available;
+        if (!seedGiven) {
+            seed = workload.header->seed;
+            sim_random_seed(seed);
+        }
+    }
+    // A trace supplies the arrivals (all of them, unless a count is given);
+    // what it leaves out is drawn from the seed
+    ArrivalTrace trace;
+    if (!tracePath.empty()) {
+        if (!arrival_trace_open(tracePath, trace, error)) {
+            cerr << "Failed to load trace: " << error << "\n";
+            return 1;
+        }
+        size_t available = min(trace.max_arrivals, (size_t)INT_MAX);
+        NUM_VEHICLES = countGiven ? (int)min((size_t)NUM_VEHICLES, available) : (int)available;
+    }
+
     cout << ANSI_BOLD << ANSI_CYAN << "\n" << string(70, '=') << ANSI_RESET << endl;
-    cout << ANSI_BOLD << ANSI_CYAN << "       TRAFFIC SIMULATION SYSTEM - F10 & F11 INTERSECTIONS" << ANSI_RESET << endl;
+    cout << ANSI_BOLD << ANSI_CYAN << "       TRAFFIC SIMULATION SYSTEM - " << network_summary() << " INTERSECTIONS" << ANSI_RESET << endl;
     cout << ANSI_BOLD << ANSI_CYAN << string(70, '=') << ANSI_RESET << endl;
-    cout << ANSI_YELLOW << "  📍 Two Intersections | 🚗 Concurrent Vehicles | 🚨 Emergency Priority" << ANSI_RESET << endl;
-    cout << ANSI_YELLOW << "  🅿️  Parking System | 🚦 Traffic Controllers | 🔄 IPC via Pipes" << ANSI_RESET << endl;
+    cout << ANSI_YELLOW << "  📍 " << intersection_count() << " Intersections, " << g_network.links.size()
+         << " Roads | 🚗 Concurrent Vehicles | 🚨 Emergency Priority" << ANSI_RESET << endl;
+    cout << ANSI_YELLOW << "  🅿️  Parking System | 🚦 Traffic Controllers | 🔄 IPC via Shared Memory / Pipes" << ANSI_RESET << endl;
+    cout << ANSI_YELLOW << "  🎲 Seed " << seed << " (--seed=" << seed << " repeats this run)" << ANSI_RESET << endl;
+    if (totalRate > 0 && !workload.header && trace.fd == -1) {
+        cout << ANSI_YELLOW << "  ⏱️  Poisson arrivals at " << totalRate << " vehicles/s"
+             << (traffic.daily.empty() ? "" : " (times the daily factors)") << ANSI_RESET << endl;
+    }
+    if (workload.header) {
+        cout << ANSI_YELLOW << "  📼 Workload " << workloadPath << ": " << NUM_VEHICLES << " of "
+             << workload.count << " vehicles" << ANSI_RESET << endl;
+    }
+    if (trace.fd != -1) {
+        cout << ANSI_YELLOW << "  📈 Trace " << tracePath << ": "
+             << (countGiven ? "up to " + to_string(NUM_VEHICLES) : string("all")) << " arrivals"
+             << ANSI_RESET << endl;
+    }
     cout << ANSI_BOLD << ANSI_CYAN << string(70, '=') << ANSI_RESET << "\n" << endl;
 
-    // Create pipes for two-way controller communication
-    if (pipe(pipeF10toF11) == -1 || pipe(pipeF11toF10) == -1) {
-        cerr << "Failed to create pipes.\n";
+    // Create vehicles before anything is forked or started, so a failure
+    // leaves nothing to shut down
+    if (!vehicle_store_create(NUM_VEHICLES, workload.header ? &workload : nullptr,
+                              trace.fd != -1 ? &trace : nullptr)) {
+        cerr << "Failed to allocate the vehicle table.\n";
         return 1;
     }
 
-    // Fork controller for F10
-    pid_t f10 = fork();
-    if (f10 == 0) {
-        // Child process: Controller F10
-        Controller ctrl10;
-        ctrl10.name = "F10";
-        ctrl10.read_fd  = pipeF11toF10[0]; // reads messages sent F11 -> F10
-        ctrl10.write_fd = pipeF10toF11[1]; // could write F10 -> F11
-        run_controller(ctrl10);
-        return 0;
+    // In the wall-clock modes the controllers own the signal plans: create
+    // the board they publish to before they are forked (the discrete-event
+    // engines drive their own light cycle on the virtual clock)
+    bool virtualClock = (mode == RunMode::Discrete || mode == RunMode::Parallel);
+    if (!virtualClock && !signal_board_create(intersection_count(), numControllers)) {
+        cerr << "Failed to create the signal board.\n";
+        return 1;
     }
 
-    // Fork controller for F11
-    pid_t f11 = fork();
-    if (f11 == 0) {
-        // Child process: Controller F11
-        Controller ctrl11;
-        ctrl11.name = "F11";
-        ctrl11.read_fd  = pipeF10toF11[0]; // reads messages sent F10 -> F11
-        ctrl11.write_fd = pipeF11toF10[1]; // could write F11 -> F10
-        run_controller(ctrl11);
-        return 0;
+    // Create the channels into each controller: control plus one per road
+    for (int k = 0; k < numControllers; ++k) {
+        if (!open_controller_channels(k, ipc)) {
+            cerr << "Failed to create controller channels (" << ipc_backend_name(ipc) << ").\n";
+            return 1;
+        }
     }
 
-    // Parent process continues here: simulation engine
-    cout << ANSI_BOLD << ANSI_GREEN << "\n✓ [SYSTEM] Both traffic controllers initialized successfully" << ANSI_RESET << endl;
-    cout << ANSI_BLUE << "  └─ Controller F10: Process ID " << f10 << ANSI_RESET << endl;
-    cout << ANSI_BLUE << "  └─ Controller F11: Process ID " << f11 << ANSI_RESET << endl;
-
-    // Initialize intersections
-    init_intersection(F10_intersection, IntersectionId::F10);
-    init_intersection(F11_intersection, IntersectionId::F11);
+    // Fork a controller for each of the first intersections
+    pid_t controllers[CONTROLLER_COUNT];
+    for (int k = 0; k < numControllers; ++k) {
+        controllers[k] = fork();
+        if (controllers[k] == 0) {
+            // Child process: controller k reads its own channels
+            run_controller(make_controller(k));
+            return 0;
+        }
+    }
 
-    // Initialize parking lots
-    init_parking_lot(F10_parking, "F10 Parking Lot", 10, 5);
-    init_parking_lot(F11_parking, "F11 Parking Lot", 10, 5);
+    // Parent process continues here: simulation engine
+    cout << ANSI_BOLD << ANSI_GREEN << "\n✓ [SYSTEM] Traffic controllers initialized successfully" << ANSI_RESET << endl;
+    for (int k = 0; k < numControllers; ++k) {
+        cout << ANSI_BLUE << "  └─ Controller " << g_network.names[k] << ": Process ID " << controllers[k]
+             << " (" << ipc_backend_name(ipc) << ")" << ANSI_RESET << endl;
+    }
 
-    // 🔹 Start traffic lights
-    start_traffic_lights();
-    // 🔹 Start UI
-    cout << ANSI_BOLD << ANSI_GREEN << "\n✓ [SYSTEM] Starting SFML Visual Interface..." << ANSI_RESET << endl;
-    ui_start();
+    // From here on every thread logs through the asynchronous writer
+    log_start();
 
-    int NUM_VEHICLES = 15;
-    if (argc >= 2) {
-        int n = atoi(argv[1]);
-        if (n > 0) NUM_VEHICLES = n;
+    // 🔹 Follow the controllers' signals and start the UI (the discrete-event
+    //    engines finish too fast to animate)
+    if (!virtualClock) {
+        // Crossings and parking stays wait on the timer service's wheel
+        timer_service_start();
+        emergency_preempt_forward = controller_preempt_forward;
+        start_traffic_lights();
+        if (ui_active()) {
+            cout << ANSI_BOLD << ANSI_GREEN << "\n✓ [SYSTEM] Starting SFML Visual Interface..." << ANSI_RESET << endl;
+            ui_start();
+        }
+    }
+    if (virtualClock || !ui_active()) {
+        // Nobody renders: hooks stay cold and the renderer never competes for locks
+        ui_set_enabled(false);
     }
 
-    cout << ANSI_BOLD << ANSI_YELLOW << "\n🚗 [SIMULATION] Spawning " << NUM_VEHICLES << " vehicles..." << ANSI_RESET << endl;
-    cout << ANSI_CYAN << string(70, '-') << ANSI_RESET << "\n" << endl;
+    log_event<LogLevel::Info>(LogEvent::SystemSpawning,
+                              {trace.fd != -1 && !countGiven ? -1 : NUM_VEHICLES});
 
-    vector<Vehicle> vehicles;
-    vector<pthread_t> threads(NUM_VEHICLES);
+    vector<pthread_t> threads;
 
-    // Create vehicles
-    for (int i = 0; i < NUM_VEHICLES; ++i) {
-        vehicles.push_back(make_random_vehicle(i + 1));
-    }
+    VehicleStore &vehicles = g_vehicles;
+
+    if (mode == RunMode::Discrete) {
+        run_discrete_event_simulation(vehicles);
+    } else if (mode == RunMode::Parallel) {
+        run_partitioned_simulation(vehicles, NUM_WORKERS);
+    } else if (mode == RunMode::Pool) {
+        run_task_pool_simulation(vehicles, NUM_WORKERS, &g_shutdown);
+    } else {
+        // Parked vehicles wait on the parking manager, not in their threads
+        parking_manager_start();
 
-    // Spawn vehicle threads
-    for (int i = 0; i < NUM_VEHICLES; ++i) {
-        if (g_shutdown) break;
-        int ret = pthread_create(&threads[i], NULL, vehicle_thread_func, &vehicles[i]);
-        if (ret != 0) {
-            cerr << "Error creating thread for vehicle " << vehicles[i].id
-                 << ", pthread_create returned " << ret << endl;
+        // Spawn vehicle threads, each at its arrival time
+        arrival_pacer_start();
+        double arrival;
+        while (Vehicle *v = vehicle_store_next(arrival)) {
+            if (!arrival_pacer_wait(arrival, &g_shutdown)) break;
+            pthread_t &thread = threads.emplace_back();
+            int ret = pthread_create(&thread, NULL, vehicle_thread_func, v);
+            if (ret != 0) {
+                thread = 0;
+                cerr << "Error creating thread for vehicle " << v->id
+                     << ", pthread_create returned " << ret << endl;
+            }
         }
-        // randomized spawn delay 100-500ms
-        int delay_ms = 100 + rand() % 401;
-        usleep(delay_ms * 1000);
-    }
 
-    // Join vehicle threads (respect shutdown)
-    for (int i = 0; i < NUM_VEHICLES; ++i) {
-        if (threads[i]) pthread_join(threads[i], NULL);
-        if (g_shutdown) break;
+        // Join vehicle threads (respect shutdown)
+        for (pthread_t thread : threads) {
+            if (thread) pthread_join(thread, NULL);
+            if (g_shutdown) break;
+        }
+        parking_manager_stop();
     }
 
-    cout << ANSI_BOLD << ANSI_CYAN << "\n" << string(70, '=') << ANSI_RESET << endl;
-    cout << ANSI_BOLD << ANSI_GREEN << "✓ [SYSTEM] All vehicles completed their journeys" << ANSI_RESET << endl;
-    cout << ANSI_YELLOW << "  └─ Initiating graceful shutdown sequence..." << ANSI_RESET << endl;
+    log_event<LogLevel::Info>(LogEvent::SystemAllCompleted);
+    log_admission_metrics();
+    log_parking_metrics();
+    log_arrival_lag();
+    log_vehicle_census();
 
-    // 🔹 Stop traffic lights thread (new in Step 6)
-    stop_traffic_lights();
+    // 🔹 Stop the signal follower
+    if (!virtualClock) {
+        stop_traffic_lights();
+        emergency_preempt_forward = nullptr;
+        timer_service_stop();
+    }
     // Stop UI
     ui_stop();
 
-    // Send SHUTDOWN signal to both controllers
-    ControllerSignal shutdownSig = ControllerSignal::SHUTDOWN;
-    write(pipeF10toF11[1], &shutdownSig, sizeof(shutdownSig)); // to F11
-    write(pipeF11toF10[1], &shutdownSig, sizeof(shutdownSig)); // to F10
+    // Send SHUTDOWN signal to every controller
+    for (int k = 0; k < numControllers; ++k) {
+        channel_send(controller_channels[k], controller_message(ControllerSignal::SHUTDOWN, -1, k));
+    }
 
     // Wait for child processes (controllers) to exit
-    waitpid(f10, NULL, 0);
-    waitpid(f11, NULL, 0);
+    for (int k = 0; k < numControllers; ++k) waitpid(controllers[k], NULL, 0);
 
-    // Close pipes
-    close(pipeF10toF11[0]);
-    close(pipeF10toF11[1]);
-    close(pipeF11toF10[0]);
-    close(pipeF11toF10[1]);
+    // Close channels
+    for (int k = 0; k < numControllers; ++k) close_controller_channels(k);
+    signal_board_destroy();
 
     // Cleanup resources
-    cout << ANSI_BLUE << "  └─ Cleaning up intersection resources..." << ANSI_RESET << endl;
-    destroy_intersection(F10_intersection);
-    destroy_intersection(F11_intersection);
-    cout << ANSI_BLUE << "  └─ Cleaning up parking lot resources..." << ANSI_RESET << endl;
-    destroy_parking_lot(F10_parking);
-    destroy_parking_lot(F11_parking);
+    log_event<LogLevel::Info>(LogEvent::SystemCleanupIntersections);
+    log_event<LogLevel::Info>(LogEvent::SystemCleanupParking);
+
+    // Drain and stop the writer before the final banner; queued records still
+    // refer to intersection and lot names, so the network goes after it
+    log_stop();
+    vehicle_store_destroy();
+    workload_close(workload);
+    arrival_trace_close(trace);
+    network_destroy();
 
     cout << ANSI_BOLD << ANSI_GREEN << "\n✓ [SYSTEM] Simulation ended cleanly - All resources released" << ANSI_RESET << endl;
     cout << ANSI_BOLD << ANSI_CYAN << string(70, '=') << ANSI_RESET << "\n" << endl;
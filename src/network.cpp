@@ -0,0 +1,320 @@
+#include "network.h"
+#include <fstream>
+#include <sstream>
+#include <unordered_map>
+#include <map>
+#include <tuple>
+#include <algorithm>
+using namespace std;
+
+Network g_network;
+
+// The original layout: F10 west of F11, one two-way road between them
+static const char *DEFAULT_SCENARIO =
+    "intersection F10 0\n"
+    "intersection F11 1\n"
+    "road F10 F11 W\n"
+    "road F11 F10 E\n"
+    "parking F10 10 5\n"
+    "parking F11 10 5\n";
+
+struct LotSpec {
+    int node;
+    int spots;
+    int queue;
+    int levels;
+};
+
+static bool parse_approach(const string &s, Approach &a) {
+    if (s == "N") a = Approach::North;
+    else if (s == "E") a = Approach::East;
+    else if (s == "S") a = Approach::South;
+    else if (s == "W") a = Approach::West;
+    else return false;
+    return true;
+}
+
+// HH:MM[:SS] as seconds after midnight
+static bool parse_clock(const string &s, double &seconds) {
+    int h, m, sec = 0;
+    char c1, c2;
+    istringstream cs(s);
+    if (!(cs >> h >> c1 >> m) || c1 != ':') return false;
+    if (cs >> c2 && (c2 != ':' || !(cs >> sec))) return false;
+    if (h < 0 || h > 23 || m < 0 || m > 59 || sec < 0 || sec > 59) return false;
+    seconds = h * 3600.0 + m * 60.0 + sec;
+    return true;
+}
+
+static bool parse_scenario(istream &in, const string &source, Network &net,
+                           vector<LotSpec> &lots, string &error) {
+    unordered_map<string, int> ids;
+    int lineNo = 0;
+    auto fail = [&](const string &msg) {
+        error = source + ":" + to_string(lineNo) + ": " + msg;
+        return false;
+    };
+    auto add_node = [&](const string &name, int group) {
+        int id = (int)net.names.size();
+        ids.emplace(name, id);
+        net.names.push_back(name);
+        net.light_group.push_back((uint8_t)group);
+        const int phase = LIGHT_PHASE_SECONDS * 1000;
+        net.plans.push_back({phase, phase, group == 0 ? 0 : phase});
+        return id;
+    };
+    auto add_road = [&](int from, int to, Approach a) {
+        net.links.push_back({(IntersectionId)from, (IntersectionId)to, a});
+    };
+
+    string line;
+    while (getline(in, line)) {
+        lineNo++;
+        size_t hash = line.find('#');
+        if (hash != string::npos) line.resize(hash);
+        istringstream ls(line);
+        string cmd;
+        if (!(ls >> cmd)) continue;
+
+        if (cmd == "intersection") {
+            string name;
+            int group = (int)(net.names.size() % 2);
+            if (!(ls >> name)) return fail("intersection needs a name");
+            ls >> group;
+            if (ids.count(name)) return fail("duplicate intersection " + name);
+            if (group != 0 && group != 1) return fail("light group must be 0 or 1");
+            add_node(name, group);
+        } else if (cmd == "plan") {
+            string at;
+            double green, red, offset = 0.0;
+            if (!(ls >> at >> green >> red)) return fail("plan needs <intersection> <green_s> <red_s> [offset_s]");
+            ls >> offset;
+            if (!ids.count(at)) return fail("unknown intersection " + at);
+            if (green < 0.001 || red < 0.001) return fail("plan needs green and red of at least 1 ms");
+            net.plans[ids[at]] = {(int)(green * 1000 + 0.5), (int)(red * 1000 + 0.5), (int)(offset * 1000 + 0.5)};
+        } else if (cmd == "road") {
+            string from, to, side;
+            Approach a;
+            if (!(ls >> from >> to >> side)) return fail("road needs <from> <to> <N|E|S|W>");
+            if (!ids.count(from)) return fail("unknown intersection " + from);
+            if (!ids.count(to)) return fail("unknown intersection " + to);
+            if (!parse_approach(side, a)) return fail("approach must be N, E, S or W");
+            add_road(ids[from], ids[to], a);
+        } else if (cmd == "parking") {
+            string at;
+            LotSpec lot;
+            if (!(ls >> at >> lot.spots >> lot.queue)) return fail("parking needs <intersection> <spots> <queue> [levels]");
+            if (!(ls >> lot.levels)) lot.levels = 1;
+            if (!ids.count(at)) return fail("unknown intersection " + at);
+            if (lot.spots <= 0 || lot.queue < 0) return fail("parking needs spots > 0 and queue >= 0");
+            if (lot.levels < 1 || lot.levels > lot.spots) return fail("parking needs 1 to <spots> levels");
+            lot.node = ids[at];
+            lots.push_back(lot);
+        } else if (cmd == "mix" || cmd == "turns") {
+            uint32_t *weights = cmd == "mix" ? net.traffic.type_weight : net.traffic.turn_weight;
+            int n = cmd == "mix" ? 6 : 3;
+            uint64_t total = 0;
+            for (int k = 0; k < n; ++k) {
+                long w;
+                if (!(ls >> w) || w < 0) return fail(cmd == "mix" ? "mix needs 6 weights >= 0"
+                                                                  : "turns needs 3 weights >= 0");
+                weights[k] = (uint32_t)w;
+                total += w;
+            }
+            if (total == 0) return fail(cmd + " needs a weight above 0");
+        } else if (cmd == "through" || cmd == "park") {
+            double p;
+            if (!(ls >> p) || p < 0 || p > 1) return fail(cmd + " needs a probability between 0 and 1");
+            (cmd == "through" ? net.traffic.through_probability : net.traffic.parking_probability) = p;
+        } else if (cmd == "crossing" || cmd == "dwell") {
+            int lo, hi;
+            if (!(ls >> lo >> hi) || lo < 0 || hi < lo) return fail(cmd + " needs <min_s> <max_s> with 0 <= min <= max");
+            if (cmd == "crossing") {
+                net.traffic.crossing_min_s = lo;
+                net.traffic.crossing_max_s = hi;
+            } else {
+                net.traffic.dwell_min_s = lo;
+                net.traffic.dwell_max_s = hi;
+            }
+        } else if (cmd == "rate") {
+            string first;
+            double rate;
+            Approach a;
+            if (!(ls >> first)) return fail("rate needs [N|E|S|W] <vehicles_per_s>");
+            bool one = parse_approach(first, a);
+            bool read = one ? (bool)(ls >> rate) : (bool)(istringstream(first) >> rate);
+            if (!read || rate < 0) return fail("rate needs [N|E|S|W] <vehicles_per_s> >= 0");
+            if (one) net.traffic.approach_rate[(int)a] = rate;
+            else for (double &r : net.traffic.approach_rate) r = rate / 4;
+        } else if (cmd == "daily") {
+            string at;
+            double factor;
+            if (!(ls >> at >> factor) || factor < 0) return fail("daily needs <HH:MM> <factor >= 0>");
+            double from;
+            if (!parse_clock(at, from)) return fail("daily needs a time of day HH:MM");
+            vector<RatePeriod> &daily = net.traffic.daily;
+            auto pos = lower_bound(daily.begin(), daily.end(), from,
+                                   [](const RatePeriod &p, double s) { return p.from_s < s; });
+            if (pos != daily.end() && pos->from_s == from) pos->factor = factor;
+            else daily.insert(pos, {from, factor});
+        } else if (cmd == "start") {
+            string at;
+            if (!(ls >> at) || !parse_clock(at, net.traffic.start_of_day_s)) return fail("start needs a time of day HH:MM");
+        } else if (cmd == "grid") {
+            int rows, cols, spots = 0, queue = 0;
+            if (!(ls >> rows >> cols) || rows <= 0 || cols <= 0) return fail("grid needs <rows> <cols>");
+            ls >> spots >> queue;
+            int base = (int)net.names.size();
+            for (int r = 0; r < rows; ++r) {
+                for (int c = 0; c < cols; ++c) {
+                    string name = "R" + to_string(r) + "C" + to_string(c);
+                    if (ids.count(name)) return fail("duplicate intersection " + name);
+                    add_node(name, (r + c) % 2);
+                    if (spots > 0) lots.push_back({base + r * cols + c, spots, queue, 1});
+                }
+            }
+            for (int r = 0; r < rows; ++r) {
+                for (int c = 0; c < cols; ++c) {
+                    int id = base + r * cols + c;
+                    if (c + 1 < cols) {
+                        add_road(id, id + 1, Approach::West);       // eastbound
+                        add_road(id + 1, id, Approach::East);       // westbound
+                    }
+                    if (r + 1 < rows) {
+                        add_road(id, id + cols, Approach::North);   // southbound
+                        add_road(id + cols, id, Approach::South);   // northbound
+                    }
+                }
+            }
+        } else {
+            return fail("unknown directive " + cmd);
+        }
+    }
+    lineNo = 0;
+    if (net.names.empty()) return fail("no intersections");
+    bool someDaily = net.traffic.daily.empty();
+    for (const RatePeriod &p : net.traffic.daily) someDaily = someDaily || p.factor > 0;
+    if (!someDaily) {
+        error = source + ": daily factors are all 0, no vehicle would ever arrive";
+        return false;
+    }
+
+    vector<bool> hasLot(net.names.size(), false);
+    for (const LotSpec &lot : lots) {
+        if (hasLot[lot.node]) {
+            error = source + ": more than one parking lot at " + net.names[lot.node];
+            return false;
+        }
+        hasLot[lot.node] = true;
+    }
+    return true;
+}
+
+// Build the adjacency index over net.links
+static void index_roads(Network &net) {
+    int n = (int)net.names.size();
+    stable_sort(net.links.begin(), net.links.end(), [](const RoadLink &a, const RoadLink &b) {
+        return (int)a.from < (int)b.from;
+    });
+
+    net.out_begin.assign(n + 1, 0);
+    net.in_begin.assign(n + 1, 0);
+    for (const RoadLink &l : net.links) {
+        net.out_begin[(int)l.from + 1]++;
+        net.in_begin[(int)l.to + 1]++;
+    }
+    for (int i = 0; i < n; ++i) {
+        net.out_begin[i + 1] += net.out_begin[i];
+        net.in_begin[i + 1] += net.in_begin[i];
+    }
+
+    net.in_link.assign(net.links.size(), 0);
+    vector<int> fill(net.in_begin.begin(), net.in_begin.end() - 1);
+    for (int k = 0; k < (int)net.links.size(); ++k) {
+        net.in_link[fill[(int)net.links[k].to]++] = k;
+    }
+}
+
+static bool load(istream &in, const string &source, string &error) {
+    Network net;
+    vector<LotSpec> lots;
+    if (!parse_scenario(in, source, net, lots, error)) return false;
+    index_roads(net);
+
+    int n = (int)net.names.size();
+    net.intersections = vector<Intersection>(n);
+    net.parking = vector<ParkingLot>(lots.size());
+    net.parking_of.assign(n, -1);
+
+    // Initialise in place: from here on nothing may move
+    g_network = std::move(net);
+    for (int i = 0; i < n; ++i) {
+        init_intersection(g_network.intersections[i], (IntersectionId)i);
+    }
+    for (size_t p = 0; p < lots.size(); ++p) {
+        ParkingLot &lot = g_network.parking[p];
+        init_parking_lot(lot, g_network.names[lots[p].node] + " Parking Lot", lots[p].spots, lots[p].queue, lots[p].levels);
+        lot.intersection = (IntersectionId)lots[p].node;
+        g_network.parking_of[lots[p].node] = (int)p;
+    }
+    return true;
+}
+
+bool network_load_file(const string &path, string &error) {
+    ifstream in(path);
+    if (!in) {
+        error = path + ": cannot open scenario";
+        return false;
+    }
+    return load(in, path, error);
+}
+
+bool network_load_default(string &error) {
+    istringstream in(DEFAULT_SCENARIO);
+    return load(in, "<default scenario>", error);
+}
+
+void network_destroy() {
+    for (Intersection &I : g_network.intersections) destroy_intersection(I);
+    for (ParkingLot &lot : g_network.parking) destroy_parking_lot(lot);
+    g_network = Network();
+}
+
+vector<SignalPlanGroup> signal_plan_groups(const vector<IntersectionId> &ids) {
+    map<tuple<int, int, int>, int> index;   // (green, red, offset in cycle) -> group
+    vector<SignalPlanGroup> groups;
+    for (IntersectionId id : ids) {
+        const SignalPlan &p = g_network.plans[(int)id];
+        int offset = p.offset_ms % (p.green_ms + p.red_ms);
+        auto key = make_tuple(p.green_ms, p.red_ms, offset);
+        auto it = index.find(key);
+        if (it == index.end()) {
+            it = index.emplace(key, (int)groups.size()).first;
+            groups.push_back({{p.green_ms, p.red_ms, offset}, {}});
+        }
+        groups[it->second].members.push_back(id);
+    }
+    return groups;
+}
+
+vector<SignalPlanGroup> signal_plan_groups(int first, int end) {
+    vector<IntersectionId> ids;
+    for (int i = first; i < end; ++i) ids.push_back((IntersectionId)i);
+    return signal_plan_groups(ids);
+}
+
+void set_group_lights(const SignalPlanGroup &group, int64_t ms, const char *label) {
+    LightColor color = signal_plan_green(group.plan, ms) ? LightColor::GREEN : LightColor::RED;
+    for (IntersectionId id : group.members) set_light(intersection_at(id), color, label);
+}
+
+string network_summary() {
+    int n = intersection_count();
+    if (n > 4) return to_string(n);
+    string s;
+    for (int i = 0; i < n; ++i) {
+        if (i) s += " & ";
+        s += g_network.names[i];
+    }
+    return s;
+}
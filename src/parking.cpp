@@ -1,134 +1,391 @@
 #include "parking.h"
-#include <iostream>
-#include <unistd.h>   // sleep
 #include <cstdlib>
-#include <iomanip>
-#include <mutex>
+#include <sched.h>
+#include <queue>
+#include <vector>
+#include <algorithm>
+#include <cerrno>
+#include <ctime>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
 using namespace std;
 // For emergency preemption awareness
 #include "intersection.h"
+#include "log.h"
+#include "timer_wheel.h"
+#include "network.h"
+#include "vehicle_store.h"
 
-// External log mutex
-extern mutex g_log_mutex;
-
-// ANSI Color Codes
-#define ANSI_RESET   "\033[0m"
-#define ANSI_BOLD    "\033[1m"
-#define ANSI_RED     "\033[31m"
-#define ANSI_GREEN   "\033[32m"
-#define ANSI_YELLOW  "\033[33m"
-#define ANSI_CYAN    "\033[36m"
-#define ANSI_MAGENTA "\033[35m"
-
-// Define global parking lots
-ParkingLot F10_parking;
-ParkingLot F11_parking;
-
-// simple random helper
-static int rand_int_p(int min, int max) {
-    return min + rand() % (max - min + 1);
+int parking_seconds(Vehicle *v) {
+    return vehicle_random_int(v, g_network.traffic.dwell_min_s, g_network.traffic.dwell_max_s);
 }
 
 void init_parking_lot(ParkingLot &lot, const string &name,
-                      int spots, int queueSize) {
+                      int spots, int queueSize, int levels) {
     lot.name = name;
+    lot.intersection = IntersectionId(0);
     lot.max_spots = spots;
     lot.max_queue = queueSize;
     lot.current_spots = 0;
+    spot_map_init(lot.spot_map, spots, levels);
+    lot.levels = lot.spot_map.levels;
 
-    sem_init(&lot.available_spots, 0, spots);   // all spots free
-    sem_init(&lot.waiting_slots, 0, queueSize); // queue capacity
+    lot.free_spots.store(spots);        // all spots free
+    lot.queue_room.store(queueSize);    // queue capacity
 
     pthread_mutex_init(&lot.state_lock, NULL);
+    wait_list_init(lot.parked);
+    lot.queued = 0;
+    lot.clock = intersection_wall_clock;
+    latency_histogram_reset(lot.wait_time);
+    lot.queue_length.assign(max(queueSize, 1), 0);
+    lot.gave_up = 0;
 }
 
-bool reserve_parking_spot(ParkingLot &lot, Vehicle *v) {
-    {
-        std::lock_guard<std::mutex> lk(g_log_mutex);
-        cout << ANSI_CYAN << "  🅿️  [Vehicle #" << v->id << "] Requesting parking at "
-             << lot.name << ANSI_RESET << endl;
+// Take one unit of a permit count if there is one
+static bool take_permit(atomic<int> &count) {
+    int n = count.load(memory_order_relaxed);
+    while (n > 0) {
+        if (count.compare_exchange_weak(n, n - 1, memory_order_acquire, memory_order_relaxed)) return true;
     }
+    return false;
+}
+
+// Step 3 of a reservation: vehicle holds a spot, leave the waiting queue
+static void finish_reservation(ParkingLot &lot, Vehicle *v) {
+    lot.queue_room.fetch_add(1, memory_order_release);
+
+    // The permit guarantees a free spot; a scan can only miss it while
+    // other vehicles are moving in and out of the same words
+    int spot;
+    while ((spot = spot_map_claim(lot.spot_map)) < 0) sched_yield();
+    v->parking_spot = spot;
+
+    pthread_mutex_lock(&lot.state_lock);
+    lot.current_spots++;
+    int usingNow = lot.current_spots;
+    pthread_mutex_unlock(&lot.state_lock);
+
+    log_event<LogLevel::Info>(LogEvent::ParkingReserved,
+                              {v->id, usingNow, lot.max_spots, spot_map_level(lot.spot_map, spot), spot},
+                              lot.name.c_str());
+}
+
+ParkingReservation try_reserve_parking_spot(ParkingLot &lot, Vehicle *v) {
+    log_event<LogLevel::Info>(LogEvent::ParkingRequested, {v->id}, lot.name.c_str());
 
      // If emergency preemption is active at the origin intersection, avoid blocking by skipping parking
-     // Determine intersection id from lot name (simple map: F10/F11 in name)
-     IntersectionId originId = (lot.name.find("F10") != string::npos) ? IntersectionId::F10 : IntersectionId::F11;
-     if (is_emergency_preempt(originId)) {
-          {
-              std::lock_guard<std::mutex> lk(g_log_mutex);
-              cout << ANSI_BOLD << ANSI_RED << "  ⚠️  [Vehicle #" << v->id << "] Emergency preemption active - "
-                   << "skipping parking" << ANSI_RESET << endl;
-          }
-          return false;
+     if (is_emergency_preempt(lot.intersection)) {
+          log_event<LogLevel::Warn>(LogEvent::ParkingPreemptSkip, {v->id}, lot.name.c_str());
+          return ParkingReservation::Skipped;
      }
 
     // Step 1: Try to enter waiting queue (bounded)
-    if (sem_trywait(&lot.waiting_slots) != 0) {
-        {
-            std::lock_guard<std::mutex> lk(g_log_mutex);
-            cout << ANSI_YELLOW << "  ⚠️  [Vehicle #" << v->id << "] Parking queue FULL - "
-                 << "skipping parking" << ANSI_RESET << endl;
-        }
-        return false;
+    if (!take_permit(lot.queue_room)) {
+        log_event<LogLevel::Warn>(LogEvent::ParkingQueueFull, {v->id}, lot.name.c_str());
+        return ParkingReservation::Skipped;
     }
 
-    cout << "[Vehicle " << v->id << "] entered waiting queue at "
-         << lot.name << endl;
-
-    // Step 2: Wait for an available parking spot
-    cout << "[Vehicle " << v->id << "] waiting for free spot at "
-         << lot.name << endl;
+    log_event<LogLevel::Debug>(LogEvent::ParkingQueued, {v->id}, lot.name.c_str());
 
-    sem_wait(&lot.available_spots);   // blocks until a spot is free
+    // Step 2: Take a free spot right away if there is one
+    if (take_permit(lot.free_spots)) {
+        finish_reservation(lot, v);
+        return ParkingReservation::Reserved;
+    }
 
-    // Step 3: Now vehicle has reserved a spot; leave waiting queue
-    sem_post(&lot.waiting_slots);
+    log_event<LogLevel::Debug>(LogEvent::ParkingWaiting, {v->id}, lot.name.c_str());
+    return ParkingReservation::Queued;
+}
 
+bool claim_or_park_parking_spot(ParkingLot &lot, Vehicle *v, WaitNode *node) {
+    // Permits are returned under state_lock, so checking and parking under it cannot miss a release
     pthread_mutex_lock(&lot.state_lock);
-    lot.current_spots++;
-    int usingNow = lot.current_spots;
+    bool claimed = take_permit(lot.free_spots);
+    if (!claimed) {
+        lot.queue_length[min(lot.queued, (int)lot.queue_length.size() - 1)]++;
+        node->queued_at = lot.clock();
+        wait_list_push(lot.parked, node);
+        lot.queued++;
+    }
     pthread_mutex_unlock(&lot.state_lock);
 
-    {
-        std::lock_guard<std::mutex> lk(g_log_mutex);
-        cout << ANSI_BOLD << ANSI_GREEN << "  ✓ [Vehicle #" << v->id << "] RESERVED parking spot at "
-             << lot.name << " (" << usingNow << "/" << lot.max_spots << " occupied)" << ANSI_RESET << endl;
+    if (claimed) finish_reservation(lot, v);
+    return claimed;
+}
+
+// ---- Blocked vehicle threads (real-time mode) ----
+// A queued thread sleeps on a futex word on its own stack. The releaser
+// reserves the spot for it first, then sets the word and wakes it: one
+// wake per handoff, and the thread never has to race anyone for the spot.
+struct ParkedThread {
+    atomic<uint32_t> granted;
+};
+
+static long futex(atomic<uint32_t> *word, int op, uint32_t val, const timespec *deadline) {
+    return syscall(SYS_futex, (uint32_t*)word, op | FUTEX_PRIVATE_FLAG, val, deadline, NULL,
+                   FUTEX_BITSET_MATCH_ANY);
+}
+
+static void wake_parked_thread(void *arg) {
+    ParkedThread *t = (ParkedThread*)arg;
+    t->granted.store(1, memory_order_release);
+    // The thread may already have returned; a wake on a dead word is harmless
+    futex(&t->granted, FUTEX_WAKE, 1, NULL);
+}
+
+// Leave the queue at the deadline. False if a releaser has already taken
+// the node off it, i.e. the spot is on its way.
+static bool leave_parking_queue(ParkingLot &lot, WaitNode *node) {
+    pthread_mutex_lock(&lot.state_lock);
+    bool left = wait_list_remove(lot.parked, node);
+    if (left) {
+        lot.queued--;
+        lot.gave_up++;
     }
+    pthread_mutex_unlock(&lot.state_lock);
+    if (left) lot.queue_room.fetch_add(1, memory_order_release);
+    return left;
+}
 
-    // Important: we DO NOT release available_spots here.
-    // It remains reserved until use_and_release_parking() is called.
+// Wait in the queue for a spot, at most `patience` seconds
+static bool wait_for_parking_spot(ParkingLot &lot, Vehicle *v, double patience) {
+    ParkedThread t;
+    t.granted.store(0, memory_order_relaxed);
+    WaitNode node;
+    node.wake = wake_parked_thread;
+    node.arg = &t;
+    node.vehicle = v;
+    if (claim_or_park_parking_spot(lot, v, &node)) return true;
 
+    timespec deadline;
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+    deadline.tv_sec += (time_t)patience;
+    deadline.tv_nsec += (long)((patience - (time_t)patience) * 1e9);
+    if (deadline.tv_nsec >= 1000000000) {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000;
+    }
+    // FUTEX_WAIT_BITSET takes an absolute CLOCK_MONOTONIC deadline, so
+    // spurious wakeups do not stretch the wait
+    while (!t.granted.load(memory_order_acquire)) {
+        if (futex(&t.granted, FUTEX_WAIT_BITSET, 0, &deadline) == -1 && errno == ETIMEDOUT) {
+            if (leave_parking_queue(lot, &node)) {
+                log_event<LogLevel::Warn>(LogEvent::ParkingGaveUp, {v->id, (int)(patience * 1000)},
+                                          lot.name.c_str());
+                return false;
+            }
+            // Granted at the deadline: the wake is imminent
+            while (!t.granted.load(memory_order_acquire)) futex(&t.granted, FUTEX_WAIT_BITSET, 0, NULL);
+        }
+    }
     return true;
 }
 
-void use_and_release_parking(ParkingLot &lot, Vehicle *v) {
-    {
-        std::lock_guard<std::mutex> lk(g_log_mutex);
-        cout << ANSI_MAGENTA << "  🅿️  [Vehicle #" << v->id << "] Now PARKED at " << lot.name << ANSI_RESET << endl;
-    }
+bool reserve_parking_spot(ParkingLot &lot, Vehicle *v) {
+    ParkingReservation r = try_reserve_parking_spot(lot, v);
+    if (r == ParkingReservation::Skipped) return false;
 
-    // Simulate some parking duration
-    sleep(rand_int_p(1, 3));
+    // Important: the spot is NOT given back here.
+    // It remains reserved until release_parking_spot() is called.
+    return r == ParkingReservation::Reserved || wait_for_parking_spot(lot, v, PARKING_PATIENCE_SECONDS);
+}
+
+void park_vehicle(ParkingLot &lot, Vehicle *v) {
+    vehicle_set_state(v, VehicleState::Parked, lot.intersection);
+    log_event<LogLevel::Info>(LogEvent::ParkingParked, {v->id}, lot.name.c_str());
+}
+
+void release_parking_spot(ParkingLot &lot, Vehicle *v) {
+    release_parking_spots(lot, &v, 1);
+}
 
+void release_parking_spots(ParkingLot &lot, Vehicle *const *vs, int n) {
+    // Free the spots before their permits go to anyone else
+    for (int i = 0; i < n; ++i) {
+        spot_map_release(lot.spot_map, vs[i]->parking_spot);
+        vs[i]->parking_spot = -1;
+    }
+
+    vector<WaitNode*> handed;
     pthread_mutex_lock(&lot.state_lock);
-    lot.current_spots--;
+    lot.current_spots -= n;
     int usingNow = lot.current_spots;
+    // Hand each spot straight to the first waiter, otherwise return the permit
+    double now = lot.clock();
+    for (int i = 0; i < n; ++i) {
+        WaitNode *next = wait_list_pop(lot.parked);
+        if (next) {
+            lot.queued--;
+            latency_histogram_record(lot.wait_time, now - next->queued_at);
+            handed.push_back(next);
+        } else {
+            lot.free_spots.fetch_add(1, memory_order_release);
+        }
+    }
     pthread_mutex_unlock(&lot.state_lock);
 
-    // Release the parking spot
-    sem_post(&lot.available_spots);
+    for (int i = 0; i < n; ++i) {
+        log_event<LogLevel::Info>(LogEvent::ParkingLeft, {vs[i]->id, usingNow + n - 1 - i, lot.max_spots},
+                                  lot.name.c_str());
+    }
+    for (WaitNode *next : handed) {
+        finish_reservation(lot, next->vehicle);
+        next->wake(next->arg);
+    }
+}
+
+// ---------------- PARKING MANAGER ----------------
+struct Departure {
+    int64_t due_ns;
+    ParkingLot *lot;
+    Vehicle *v;
+    void (*done)(Vehicle *v);
+};
+
+struct DepartureLater {
+    bool operator()(const Departure &a, const Departure &b) const {
+        return a.due_ns > b.due_ns;
+    }
+};
 
-    {
-        std::lock_guard<std::mutex> lk(g_log_mutex);
-        cout << ANSI_CYAN << "  ➤ [Vehicle #" << v->id << "] LEFT parking at "
-             << lot.name << " (" << usingNow << "/" << lot.max_spots << " occupied)" << ANSI_RESET << endl;
+static pthread_mutex_t manager_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t manager_drained = PTHREAD_COND_INITIALIZER;
+static priority_queue<Departure, vector<Departure>, DepartureLater> departures;
+static TimerNode departure_timer;
+static int departures_in_flight = 0;   // taken off the heap, done() not run yet
+static int departures_total = 0;
+static int departure_batches = 0;
+static int departures_peak = 0;
+
+// Timer service thread: release everything that is due
+static void departures_due(void *) {
+    vector<Departure> batch;
+    pthread_mutex_lock(&manager_lock);
+    int64_t now = timer_service_clock_ns();
+    while (!departures.empty() && departures.top().due_ns <= now) {
+        batch.push_back(departures.top());
+        departures.pop();
+    }
+    if (!departures.empty()) timer_service_add_at(&departure_timer, departures.top().due_ns);
+    departures_in_flight += (int)batch.size();
+    departure_batches += batch.empty() ? 0 : 1;
+    pthread_mutex_unlock(&manager_lock);
+    if (batch.empty()) return;
+
+    log_event<LogLevel::Debug>(LogEvent::ParkingDeparturesDue, {(int)batch.size()});
+    // One release per lot
+    stable_sort(batch.begin(), batch.end(),
+                [](const Departure &a, const Departure &b) { return a.lot < b.lot; });
+    vector<Vehicle*> leaving;
+    for (size_t i = 0; i < batch.size(); ) {
+        size_t j = i;
+        leaving.clear();
+        for (; j < batch.size() && batch[j].lot == batch[i].lot; ++j) leaving.push_back(batch[j].v);
+        release_parking_spots(*batch[i].lot, leaving.data(), (int)leaving.size());
+        i = j;
+    }
+    for (const Departure &d : batch) d.done(d.v);
+
+    pthread_mutex_lock(&manager_lock);
+    departures_in_flight -= (int)batch.size();
+    if (departures.empty() && departures_in_flight == 0) pthread_cond_broadcast(&manager_drained);
+    pthread_mutex_unlock(&manager_lock);
+}
+
+void parking_manager_start() {
+    timer_node_init(departure_timer, departures_due, nullptr);
+    departures_total = departure_batches = departures_peak = 0;
+}
+
+void parking_manager_stop() {
+    pthread_mutex_lock(&manager_lock);
+    while (!departures.empty() || departures_in_flight > 0) {
+        pthread_cond_wait(&manager_drained, &manager_lock);
+    }
+    pthread_mutex_unlock(&manager_lock);
+    timer_service_cancel(&departure_timer);
+    log_event<LogLevel::Info>(LogEvent::ParkingManagerStopped,
+                              {departures_total, departure_batches, departures_peak});
+}
+
+void park_until_departure(ParkingLot &lot, Vehicle *v, double seconds, void (*done)(Vehicle *v)) {
+    int64_t due = timer_service_clock_ns() + (int64_t)(seconds * 1e9);
+    pthread_mutex_lock(&manager_lock);
+    bool earliest = departures.empty() || due < departures.top().due_ns;
+    departures.push(Departure{due, &lot, v, done});
+    departures_total++;
+    departures_peak = max(departures_peak, (int)departures.size());
+    if (earliest) timer_service_add_at(&departure_timer, due);
+    pthread_mutex_unlock(&manager_lock);
+}
+
+// ---- Queue metrics ----
+// Queue length at which the running count of joins reaches fraction p
+static int queue_length_percentile(const vector<uint32_t> &counts, double p) {
+    uint64_t total = 0;
+    for (uint32_t c : counts) total += c;
+    uint64_t want = (uint64_t)(p * total + 0.5), seen = 0;
+    for (int len = 0; len < (int)counts.size(); ++len) {
+        seen += counts[len];
+        if (seen >= want && seen > 0) return len;
+    }
+    return 0;
+}
+
+static void log_lot_stats(int lot, const char *name, const LatencyHistogram &wait, int gaveUp,
+                          const vector<uint32_t> &lengths, int capacity) {
+    uint64_t joined = 0;
+    int longest = 0;
+    for (int len = 0; len < (int)lengths.size(); ++len) {
+        joined += lengths[len];
+        if (lengths[len]) longest = len;
+    }
+    if (joined == 0) return;
+    log_event<LogLevel::Info>(LogEvent::ParkingWaitStats,
+                              {lot, (int)wait.total, gaveUp,
+                               (int)(latency_histogram_percentile(wait, 0.50) * 1000),
+                               (int)(latency_histogram_percentile(wait, 0.99) * 1000),
+                               (int)(wait.max_us / 1000)},
+                              name);
+    log_event<LogLevel::Info>(LogEvent::ParkingQueueStats,
+                              {lot, (int)joined, queue_length_percentile(lengths, 0.50),
+                               queue_length_percentile(lengths, 0.99), longest, capacity},
+                              name);
+}
+
+void log_parking_metrics() {
+    const int PER_LOT_LIMIT = 4;
+    if (g_network.parking.size() <= (size_t)PER_LOT_LIMIT) {
+        for (size_t i = 0; i < g_network.parking.size(); ++i) {
+            ParkingLot &lot = g_network.parking[i];
+            pthread_mutex_lock(&lot.state_lock);
+            log_lot_stats((int)i, lot.name.c_str(), lot.wait_time, lot.gave_up, lot.queue_length, lot.max_queue);
+            pthread_mutex_unlock(&lot.state_lock);
+        }
+        return;
+    }
+    LatencyHistogram wait;
+    latency_histogram_reset(wait);
+    vector<uint32_t> lengths;
+    int gaveUp = 0, capacity = 0;
+    for (ParkingLot &lot : g_network.parking) {
+        pthread_mutex_lock(&lot.state_lock);
+        latency_histogram_merge(wait, lot.wait_time);
+        if (lengths.size() < lot.queue_length.size()) lengths.resize(lot.queue_length.size(), 0);
+        for (size_t len = 0; len < lot.queue_length.size(); ++len) lengths[len] += lot.queue_length[len];
+        gaveUp += lot.gave_up;
+        capacity = max(capacity, lot.max_queue);
+        pthread_mutex_unlock(&lot.state_lock);
     }
+    log_lot_stats(-1, "", wait, gaveUp, lengths, capacity);
 }
 
 void destroy_parking_lot(ParkingLot &lot) {
-     // Ensure counters consistent, then destroy semaphores and mutex
+     // Ensure counters consistent, then destroy the mutex
      pthread_mutex_lock(&lot.state_lock);
      pthread_mutex_unlock(&lot.state_lock);
-     sem_destroy(&lot.available_spots);
-     sem_destroy(&lot.waiting_slots);
      pthread_mutex_destroy(&lot.state_lock);
+     spot_map_destroy(lot.spot_map);
 }
@@ -0,0 +1,52 @@
+#include "signal_board.h"
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/eventfd.h>
+using namespace std;
+
+#include "controller_ipc.h"
+#include "network.h"
+
+static_assert(atomic<uint32_t>::is_always_lock_free, "signal entries must work across processes");
+
+SignalBoard *g_signal_board = nullptr;
+static SignalBoard board;
+
+bool signal_board_create(int intersections, int controllers) {
+    size_t bytes = intersections * sizeof(atomic<uint32_t>);
+    void *mem = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (mem == MAP_FAILED) return false;
+    board.event_fd = eventfd(0, 0);
+    if (board.event_fd == -1) {
+        munmap(mem, bytes);
+        return false;
+    }
+    board.epoch_ns = channel_clock_ns();
+    board.controllers = controllers;
+    board.intersections = intersections;
+    board.state = (atomic<uint32_t>*)mem;
+    for (int i = 0; i < intersections; ++i) {
+        new (&board.state[i]) atomic<uint32_t>(signal_plan_green(g_network.plans[i], 0) ? SIGNAL_GREEN : 0);
+    }
+    g_signal_board = &board;
+    return true;
+}
+
+void signal_board_destroy() {
+    if (!g_signal_board) return;
+    g_signal_board = nullptr;
+    close(board.event_fd);
+    munmap(board.state, board.intersections * sizeof(atomic<uint32_t>));
+    board.state = nullptr;
+}
+
+bool signal_board_publish(IntersectionId id, uint32_t state) {
+    return board.state[(int)id].exchange(state, memory_order_release) != state;
+}
+
+void signal_board_notify() {
+    uint64_t one = 1;
+    if (write(board.event_fd, &one, sizeof(one)) != (ssize_t)sizeof(one)) {
+        // Counter saturated: the follower is far behind and will rescan anyway
+    }
+}
@@ -0,0 +1,369 @@
+#include "sim_engine.h"
+#include <queue>
+#include <deque>
+#include <chrono>
+#include <cstdlib>
+#include <cmath>
+#include <atomic>
+#include <thread>
+#include <barrier>
+#include <algorithm>
+using namespace std;
+
+#include "intersection.h"
+#include "journey.h"
+#include "network.h"
+#include "log.h"
+
+// ------------- EVENT CALENDAR -----------------
+struct SimEvent {
+    double when;
+    unsigned long seq;        // tie-breaker: FIFO among equal timestamps
+    function<void()> action;
+};
+
+struct SimEventLater {
+    bool operator()(const SimEvent &a, const SimEvent &b) const {
+        if (a.when != b.when) return a.when > b.when;
+        return a.seq > b.seq;
+    }
+};
+
+// One virtual clock and its pending events. The sequential engine has one;
+// the partitioned engine gives each partition its own, and the sim_* calls
+// below act on the calendar of the calling thread.
+struct SimCalendar {
+    priority_queue<SimEvent, vector<SimEvent>, SimEventLater> events;
+    double now = 0.0;
+    unsigned long next_seq = 0;
+};
+
+static SimCalendar main_calendar;
+static thread_local SimCalendar *tl_calendar = &main_calendar;
+
+static void calendar_push(SimCalendar &c, double when, function<void()> action) {
+    if (when < c.now) when = c.now;   // never schedule into the past
+    c.events.push(SimEvent{when, c.next_seq++, std::move(action)});
+}
+
+// Run the earliest event. Returns false once the calendar is empty.
+static bool calendar_step(SimCalendar &c) {
+    if (c.events.empty()) return false;
+    SimEvent ev = c.events.top();
+    c.events.pop();
+    c.now = ev.when;
+    ev.action();
+    return true;
+}
+
+double sim_now() {
+    return tl_calendar->now;
+}
+
+void sim_schedule_at(double when, function<void()> action) {
+    calendar_push(*tl_calendar, when, std::move(action));
+}
+
+void sim_schedule_after(double delay, function<void()> action) {
+    sim_schedule_at(tl_calendar->now + delay, std::move(action));
+}
+
+// ------------- VEHICLE JOURNEYS -----------------
+// Journeys suspend on the virtual clock: a wake from a wait list resumes at
+// the current virtual time, a timed wait after the given virtual delay.
+static atomic<int> vehicles_remaining(0);
+
+static void des_resume(VehicleJourney *j) {
+    sim_schedule_after(0.0, [j] { journey_resume(j); });
+}
+
+static void des_resume_after(VehicleJourney *j, double seconds) {
+    sim_schedule_after(seconds, [j] { journey_resume(j); });
+}
+
+static void des_finished(VehicleJourney *) {
+    vehicles_remaining--;
+}
+
+static const JourneyHost des_host = { des_resume, des_resume_after, des_finished, nullptr };
+
+// Vehicles are pulled from the table one arrival at a time: each arrival
+// schedules the next, so the calendar holds one pending arrival, not all of
+// them. Until the last one, the arrivals to come count as a vehicle remaining.
+static void des_schedule_next_arrival(deque<VehicleJourney> *journeys) {
+    double arrival;
+    Vehicle *v = vehicle_store_next(arrival);
+    if (!v) {
+        vehicles_remaining--;
+        return;
+    }
+    VehicleJourney *j = &journeys->emplace_back();   // deque: earlier journeys stay put
+    journey_init(*j, v, &des_host, nullptr);
+    vehicles_remaining++;
+    sim_schedule_at(arrival, [j, journeys] {
+        des_schedule_next_arrival(journeys);
+        journey_resume(j);
+    });
+}
+
+// ------------- TRAFFIC LIGHTS -----------------
+// The intersections' signal plans, on the virtual clock: one event per group
+// of intersections sharing a plan, at each of its light changes
+static vector<SignalPlanGroup> plan_groups;
+
+static int64_t virtual_ms() {
+    return (int64_t)llround(sim_now() * 1000.0);
+}
+
+static void light_phase(const SignalPlanGroup *g, const char *label) {
+    int64_t ms = virtual_ms();
+    set_group_lights(*g, ms, label);
+
+    // Keep cycling only while there is traffic left to serve
+    if (vehicles_remaining > 0) {
+        sim_schedule_at(signal_plan_next_change(g->plan, ms) / 1000.0, [g] { light_phase(g, "Cycle"); });
+    }
+}
+
+// ------------- DRIVER -----------------
+double run_discrete_event_simulation(VehicleStore &vehicles) {
+    auto wallStart = chrono::steady_clock::now();
+
+    deque<VehicleJourney> journeys;
+    vehicles_remaining = 1;
+
+    log_event<LogLevel::Info>(LogEvent::DesStarted, {LIGHT_PHASE_SECONDS});
+
+    // Admission order ages and wait times are measured on the virtual clock
+    for (Intersection &I : g_network.intersections) I.clock = sim_now;
+    for (ParkingLot &lot : g_network.parking) lot.clock = sim_now;
+
+    plan_groups = signal_plan_groups(0, intersection_count());
+    for (const SignalPlanGroup &g : plan_groups) {
+        const SignalPlanGroup *gp = &g;
+        sim_schedule_at(0.0, [gp] { light_phase(gp, "Initial"); });
+    }
+
+    // Same arrival process as the thread spawner
+    des_schedule_next_arrival(&journeys);
+
+    unsigned long processed = 0;
+    while (calendar_step(main_calendar)) processed++;
+
+    // Journeys still parked when the calendar ran dry can never resume
+    for (VehicleJourney &j : journeys) journey_destroy(j);
+
+    double wallSeconds = chrono::duration<double>(chrono::steady_clock::now() - wallStart).count();
+    log_event<LogLevel::Info>(LogEvent::DesFinished, {(int)processed, vehicles_remaining.load()},
+                              nullptr, main_calendar.now, wallSeconds);
+    return main_calendar.now;
+}
+
+// ------------- PARTITIONED ENGINE -----------------
+// Each partition owns a contiguous block of intersection ids (row bands of a
+// grid) with their parking lots, and runs their events on its own thread and
+// calendar. Partitions only interact through messages: a vehicle driving into
+// another partition's intersection, or a preemption notice sent ahead of an
+// emergency vehicle. Both take at least `lookahead` = ROAD_TRAVEL_SECONDS of
+// virtual time to land, so partitions can advance in lock-step windows
+// [t, t + lookahead): nothing sent inside a window is due inside it.
+
+enum class MailKind : uint8_t {
+    Arrival,   // journey reaches an intersection of the receiving partition
+    Preempt    // emergency preemption change at one of its intersections
+};
+
+struct Mail {
+    double when;
+    MailKind kind;
+    VehicleJourney *j;      // Arrival
+    IntersectionId at;      // Preempt
+    bool enabled;           // Preempt
+    Mail *next;
+};
+
+struct Partition {
+    int first, end;                        // owned intersections [first, end)
+    vector<SignalPlanGroup> plan_groups;   // of the owned intersections
+    SimCalendar calendar;
+    alignas(64) atomic<Mail*> mailbox{nullptr};   // lock-free stack, many senders
+    alignas(64) double next_event = 0.0;   // published between windows
+    unsigned long events = 0;
+    unsigned long handoffs = 0;
+};
+
+static vector<Partition> partitions;
+static vector<int> partition_of;           // by IntersectionId
+static thread_local Partition *tl_partition = nullptr;
+static const double lookahead = ROAD_TRAVEL_SECONDS;
+
+static void mailbox_post(Partition &p, Mail *m) {
+    Mail *head = p.mailbox.load(memory_order_relaxed);
+    do {
+        m->next = head;
+    } while (!p.mailbox.compare_exchange_weak(head, m, memory_order_release, memory_order_relaxed));
+}
+
+// Move everything delivered during the last window onto the calendar. Sorted
+// first so that equal timestamps keep the same order whatever the senders' timing.
+static void mailbox_drain(Partition &p) {
+    Mail *m = p.mailbox.exchange(nullptr, memory_order_acquire);
+    if (!m) return;
+    vector<Mail*> mail;
+    for (; m; m = m->next) mail.push_back(m);
+    sort(mail.begin(), mail.end(), [](const Mail *a, const Mail *b) {
+        if (a->when != b->when) return a->when < b->when;
+        if (a->kind != b->kind) return a->kind < b->kind;
+        if (a->kind == MailKind::Arrival) return a->j->v->id < b->j->v->id;
+        return (int)a->at < (int)b->at;
+    });
+    for (Mail *item : mail) {
+        if (item->kind == MailKind::Arrival) {
+            VehicleJourney *j = item->j;
+            calendar_push(p.calendar, item->when, [j] { journey_resume(j); });
+        } else {
+            IntersectionId at = item->at;
+            bool enabled = item->enabled;
+            calendar_push(p.calendar, item->when, [at, enabled] { set_emergency_preempt(at, enabled); });
+            delete item;
+        }
+    }
+}
+
+// Journeys drive on to their destination: hand over to the partition owning it
+static void partition_travel(VehicleJourney *j, IntersectionId to, double seconds) {
+    Partition &owner = partitions[partition_of[(int)to]];
+    double when = sim_now() + max(seconds, lookahead);
+    if (&owner == tl_partition) {
+        sim_schedule_at(when, [j] { journey_resume(j); });
+        return;
+    }
+    Mail *m = (Mail*)j->host_data;   // one per journey: a journey travels once
+    m->when = when;
+    m->kind = MailKind::Arrival;
+    m->j = j;
+    tl_partition->handoffs++;
+    mailbox_post(owner, m);
+}
+
+static const JourneyHost partition_host = { des_resume, des_resume_after, des_finished, partition_travel };
+
+// Preemption of a foreign intersection becomes a notice to its owner, landing
+// one lookahead later (the emergency vehicle still has the road to drive)
+static bool partition_forward_preempt(IntersectionId id, bool enabled) {
+    Partition &owner = partitions[partition_of[(int)id]];
+    if (!tl_partition || &owner == tl_partition) return false;
+    mailbox_post(owner, new Mail{sim_now() + lookahead, MailKind::Preempt, nullptr, id, enabled, nullptr});
+    return true;
+}
+
+static void partition_light_phase(const SignalPlanGroup *g, const char *label) {
+    int64_t ms = virtual_ms();
+    set_group_lights(*g, ms, label);
+
+    if (vehicles_remaining.load(memory_order_relaxed) > 0) {
+        sim_schedule_at(signal_plan_next_change(g->plan, ms) / 1000.0, [g] {
+            partition_light_phase(g, "Cycle");
+        });
+    }
+}
+
+static void partition_worker(Partition *p, barrier<> *window) {
+    tl_partition = p;
+    tl_calendar = &p->calendar;
+
+    while (true) {
+        // Between windows: collect the mail, agree on where the next window starts
+        mailbox_drain(*p);
+        p->next_event = p->calendar.events.empty() ? INFINITY : p->calendar.events.top().when;
+        window->arrive_and_wait();
+
+        double start = INFINITY;
+        for (const Partition &q : partitions) start = min(start, q.next_event);
+        if (start == INFINITY) break;   // every partition agrees: nothing left anywhere
+
+        double end = start + lookahead;
+        while (!p->calendar.events.empty() && p->calendar.events.top().when < end) {
+            calendar_step(p->calendar);
+            p->events++;
+        }
+        window->arrive_and_wait();   // all mail of this window is posted
+    }
+
+    tl_partition = nullptr;
+    tl_calendar = &main_calendar;
+}
+
+double run_partitioned_simulation(VehicleStore &vehicles, int count, PartitionStats *stats) {
+    auto wallStart = chrono::steady_clock::now();
+
+    int n = intersection_count();
+    if (count <= 0) count = (int)thread::hardware_concurrency();
+    count = max(1, min(count, n));
+
+    partitions = vector<Partition>(count);
+    partition_of.assign(n, 0);
+    for (int k = 0; k < count; ++k) {
+        partitions[k].first = (int)((long)n * k / count);
+        partitions[k].end = (int)((long)n * (k + 1) / count);
+        for (int i = partitions[k].first; i < partitions[k].end; ++i) partition_of[i] = k;
+    }
+
+    deque<VehicleJourney> journeys;
+    deque<Mail> travel_mail;
+
+    log_event<LogLevel::Info>(LogEvent::PartitionsStarted, {count, n, LIGHT_PHASE_SECONDS}, nullptr, lookahead);
+
+    for (Intersection &I : g_network.intersections) I.clock = sim_now;
+    for (ParkingLot &lot : g_network.parking) lot.clock = sim_now;
+    emergency_preempt_forward = partition_forward_preempt;
+
+    for (Partition &p : partitions) {
+        p.plan_groups = signal_plan_groups(p.first, p.end);
+        for (const SignalPlanGroup &g : p.plan_groups) {
+            const SignalPlanGroup *gp = &g;
+            calendar_push(p.calendar, 0.0, [gp] { partition_light_phase(gp, "Initial"); });
+        }
+    }
+
+    // Same arrival process as the sequential engine, each vehicle starting in
+    // the partition that owns its origin (all queued up front: the windows
+    // need every partition's next event)
+    double arrival;
+    while (Vehicle *v = vehicle_store_next(arrival)) {
+        VehicleJourney *j = &journeys.emplace_back();
+        journey_init(*j, v, &partition_host, &travel_mail.emplace_back());
+        Partition &p = partitions[partition_of[(int)v->originIntersection]];
+        calendar_push(p.calendar, arrival, [j] { journey_resume(j); });
+    }
+    vehicles_remaining = (int)journeys.size();
+
+    barrier<> window(count);
+    vector<thread> workers;
+    for (Partition &p : partitions) workers.emplace_back(partition_worker, &p, &window);
+    for (thread &t : workers) t.join();
+
+    emergency_preempt_forward = nullptr;
+    for (VehicleJourney &j : journeys) journey_destroy(j);
+
+    unsigned long events = 0, handoffs = 0;
+    double last = 0.0;
+    for (const Partition &p : partitions) {
+        events += p.events;
+        handoffs += p.handoffs;
+        last = max(last, p.calendar.now);
+    }
+    partitions.clear();
+
+    double wallSeconds = chrono::duration<double>(chrono::steady_clock::now() - wallStart).count();
+    log_event<LogLevel::Info>(LogEvent::PartitionsFinished,
+                              {(int)events, (int)handoffs, vehicles_remaining.load()},
+                              nullptr, last, wallSeconds);
+    if (stats) {
+        stats->partitions = count;
+        stats->events = events;
+        stats->handoffs = handoffs;
+        stats->wall_seconds = wallSeconds;
+    }
+    return last;
+}
@@ -0,0 +1,49 @@
+#include "sim_random.h"
+#include <ctime>
+#include <unistd.h>
+
+static uint64_t master_seed = 0;
+
+static uint64_t splitmix64(uint64_t &x) {
+    uint64_t z = (x += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+void sim_random_seed(uint64_t seed) {
+    master_seed = seed;
+}
+
+uint64_t sim_random_seed_from_clock() {
+    timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    uint64_t x = (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+    x ^= (uint64_t)getpid() << 32;
+    // Keep it short enough to retype after --seed=
+    return splitmix64(x) % 1000000000ull;
+}
+
+uint64_t sim_random_get_seed() {
+    return master_seed;
+}
+
+// Mix the stream id in first so streams n and n+1 do not share state words
+static uint64_t stream_key(uint64_t stream) {
+    uint64_t x = master_seed;
+    return (splitmix64(x) ^ stream) * 0xD1B54A32D192ED03ull;
+}
+
+SimRng sim_rng_stream(uint64_t stream) {
+    uint64_t x = stream_key(stream);
+    SimRng r;
+    for (uint64_t &w : r.s) w = splitmix64(x);
+    return r;
+}
+
+uint64_t sim_random_at(uint64_t stream, uint64_t counter) {
+    // The xoshiro seeding above starts at position 0, so counter draws start
+    // past the four words it used
+    uint64_t x = stream_key(stream) + (counter + 4) * 0x9E3779B97F4A7C15ull;
+    return splitmix64(x);
+}
@@ -0,0 +1,99 @@
+#include "spot_map.h"
+using namespace std;
+
+static const uint64_t FULL = ~(uint64_t)0;
+
+void spot_map_init(SpotMap &m, int spots, int levels) {
+    if (levels < 1) levels = 1;
+    if (levels > spots) levels = spots;
+    m.spots = spots;
+    m.levels = levels;
+    m.per_level = (spots + levels - 1) / levels;
+    m.words = (spots + 63) / 64;
+    int summaryWords = (m.words + 63) / 64;
+    m.used = new atomic<uint64_t>[m.words];
+    m.has_free = new atomic<uint64_t>[summaryWords];
+    for (int w = 0; w < m.words; ++w) m.used[w].store(0, memory_order_relaxed);
+    if (spots % 64) m.used[m.words - 1].store(FULL << (spots % 64), memory_order_relaxed);
+    for (int s = 0; s < summaryWords; ++s) {
+        int inWord = m.words - s * 64;
+        m.has_free[s].store(inWord >= 64 ? FULL : ((uint64_t)1 << inWord) - 1, memory_order_relaxed);
+    }
+}
+
+void spot_map_destroy(SpotMap &m) {
+    delete[] m.used;
+    delete[] m.has_free;
+    m.used = nullptr;
+    m.has_free = nullptr;
+    m.spots = m.words = 0;
+}
+
+// First word at or after `w` whose has_free bit is set, or m.words
+static int next_hinted_word(const SpotMap &m, int w) {
+    while (w < m.words) {
+        uint64_t bits = m.has_free[w / 64].load() >> (w % 64);
+        if (bits) return w + __builtin_ctzll(bits);
+        w = (w / 64 + 1) * 64;
+    }
+    return m.words;
+}
+
+// A claim filled word `w`: drop its hint, then look again, so a release that
+// raced with us (it sets the hint after freeing its bit) is never hidden
+static void mark_full(SpotMap &m, int w) {
+    uint64_t bit = (uint64_t)1 << (w % 64);
+    m.has_free[w / 64].fetch_and(~bit);
+    if (m.used[w].load() != FULL) m.has_free[w / 64].fetch_or(bit);
+}
+
+// Set the lowest free bit of word `w` within `mask`; its index, or -1
+static int claim_in_word(SpotMap &m, int w, uint64_t mask) {
+    uint64_t cur = m.used[w].load(memory_order_relaxed);
+    while (true) {
+        uint64_t free = ~cur & mask;
+        if (!free) return -1;
+        uint64_t bit = free & -free;
+        if (m.used[w].compare_exchange_weak(cur, cur | bit)) {
+            if ((cur | bit) == FULL) mark_full(m, w);
+            return __builtin_ctzll(bit);
+        }
+    }
+}
+
+int spot_map_claim(SpotMap &m, int from) {
+    if (from < 0 || from >= m.spots) from = 0;
+    int w = from / 64;
+    uint64_t mask = FULL << (from % 64);
+    bool wrapped = false;
+    while (true) {
+        int hinted = next_hinted_word(m, w);
+        if (hinted != w) mask = FULL;
+        w = hinted;
+        if (w == m.words) {
+            // Second pass from spot 0 also covers what lay before `from`
+            if (wrapped || from == 0) return -1;
+            wrapped = true;
+            w = 0;
+            mask = FULL;
+            continue;
+        }
+        int bit = claim_in_word(m, w, mask);
+        if (bit >= 0) return w * 64 + bit;
+        w++;
+        mask = FULL;
+    }
+}
+
+void spot_map_release(SpotMap &m, int spot) {
+    int w = spot / 64;
+    m.used[w].fetch_and(~((uint64_t)1 << (spot % 64)));
+    uint64_t bit = (uint64_t)1 << (w % 64);
+    if (!(m.has_free[w / 64].load() & bit)) m.has_free[w / 64].fetch_or(bit);
+}
+
+int spot_map_used(const SpotMap &m) {
+    int used = 0;
+    for (int w = 0; w < m.words; ++w) used += __builtin_popcountll(m.used[w].load(memory_order_relaxed));
+    return used - (m.words * 64 - m.spots);   // less the padding bits, always set
+}
@@ -0,0 +1,294 @@
+#include "task_pool.h"
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <chrono>
+#include <cstdlib>
+#include <unistd.h>
+using namespace std;
+
+#include "intersection.h"
+#include "parking.h"
+#include "network.h"
+#include "log.h"
+
+// ------------- WORK-STEALING DEQUE -----------------
+// Chase-Lev deque (Le, Pop, Cohen, Zappa Nardelli, PPoPP'13 memory orders).
+// The owner pushes/pops at the bottom, thieves steal from the top.
+struct WsBuffer {
+    long capacity;            // power of two
+    atomic<PoolTask*> *slots;
+
+    explicit WsBuffer(long cap) : capacity(cap), slots(new atomic<PoolTask*>[cap]) {}
+    ~WsBuffer() { delete[] slots; }
+
+    PoolTask* get(long i) const { return slots[i & (capacity - 1)].load(memory_order_relaxed); }
+    void put(long i, PoolTask *t) { slots[i & (capacity - 1)].store(t, memory_order_relaxed); }
+};
+
+struct WsDeque {
+    atomic<long> top{0};
+    atomic<long> bottom{0};
+    atomic<WsBuffer*> buffer{new WsBuffer(1024)};
+    vector<WsBuffer*> retired;   // old buffers a thief may still read; freed on stop
+
+    ~WsDeque() {
+        delete buffer.load();
+        for (WsBuffer *b : retired) delete b;
+    }
+
+    // Owner only
+    void push(PoolTask *t) {
+        long b = bottom.load(memory_order_relaxed);
+        long tp = top.load(memory_order_acquire);
+        WsBuffer *a = buffer.load(memory_order_relaxed);
+        if (b - tp > a->capacity - 1) {
+            WsBuffer *bigger = new WsBuffer(a->capacity * 2);
+            for (long i = tp; i < b; ++i) bigger->put(i, a->get(i));
+            retired.push_back(a);
+            buffer.store(bigger, memory_order_release);
+            a = bigger;
+        }
+        a->put(b, t);
+        atomic_thread_fence(memory_order_release);
+        bottom.store(b + 1, memory_order_relaxed);
+    }
+
+    // Owner only
+    PoolTask* pop() {
+        long b = bottom.load(memory_order_relaxed) - 1;
+        WsBuffer *a = buffer.load(memory_order_relaxed);
+        bottom.store(b, memory_order_relaxed);
+        atomic_thread_fence(memory_order_seq_cst);
+        long t = top.load(memory_order_relaxed);
+        PoolTask *x = nullptr;
+        if (t <= b) {
+            x = a->get(b);
+            if (t == b) {
+                // Last element: race against thieves
+                if (!top.compare_exchange_strong(t, t + 1, memory_order_seq_cst, memory_order_relaxed))
+                    x = nullptr;
+                bottom.store(b + 1, memory_order_relaxed);
+            }
+        } else {
+            bottom.store(b + 1, memory_order_relaxed);
+        }
+        return x;
+    }
+
+    // Any thread
+    PoolTask* steal() {
+        long t = top.load(memory_order_acquire);
+        atomic_thread_fence(memory_order_seq_cst);
+        long b = bottom.load(memory_order_acquire);
+        if (t >= b) return nullptr;
+        WsBuffer *a = buffer.load(memory_order_acquire);
+        PoolTask *x = a->get(t);
+        if (!top.compare_exchange_strong(t, t + 1, memory_order_seq_cst, memory_order_relaxed))
+            return nullptr;   // lost the race; caller moves on to another victim
+        return x;
+    }
+};
+
+// ------------- POOL STATE -----------------
+static vector<thread> workers;
+static WsDeque *deques = nullptr;
+static int worker_count = 0;
+static atomic<bool> pool_running(false);
+static thread_local int tl_worker = -1;   // index of the current worker, -1 elsewhere
+
+// Tasks submitted from outside the pool (spawner, timer, light thread)
+static mutex inject_mutex;
+static deque<PoolTask*> inject_queue;
+
+// Idle workers sleep here. `queued` counts submitted-but-not-taken tasks; a
+// worker announces itself in `sleepers` before re-checking it, and submitters
+// bump `queued` before reading `sleepers`, so a wakeup is never lost.
+static mutex idle_mutex;
+static condition_variable idle_cv;
+static atomic<long> queued(0);
+static atomic<int> sleepers(0);
+
+static void notify_idle_worker() {
+    if (sleepers.load() > 0) {
+        lock_guard<mutex> lk(idle_mutex);
+        idle_cv.notify_one();
+    }
+}
+
+void task_pool_submit(PoolTask *t) {
+    if (tl_worker >= 0) {
+        deques[tl_worker].push(t);
+    } else {
+        lock_guard<mutex> lk(inject_mutex);
+        if (!pool_running.load()) return;   // a timer firing as the pool stops
+        inject_queue.push_back(t);
+    }
+    queued.fetch_add(1);
+    notify_idle_worker();
+}
+
+// Due tasks are handed back to the workers through the injection queue
+static void submit_due(void *arg) {
+    task_pool_submit((PoolTask*)arg);
+}
+
+void task_pool_submit_after(PoolTask *t, double seconds) {
+    timer_node_init(t->timer, submit_due, t);
+    timer_service_add_after(&t->timer, seconds);
+}
+
+static PoolTask* take_task(int self, unsigned &seed) {
+    PoolTask *t = deques[self].pop();
+    if (!t) {
+        lock_guard<mutex> lk(inject_mutex);
+        if (!inject_queue.empty()) {
+            t = inject_queue.front();
+            inject_queue.pop_front();
+        }
+    }
+    if (!t && worker_count > 1) {
+        // Steal from the other workers, starting at a random victim
+        int start = rand_r(&seed) % worker_count;
+        for (int k = 0; k < worker_count && !t; ++k) {
+            int victim = (start + k) % worker_count;
+            if (victim != self) t = deques[victim].steal();
+        }
+    }
+    if (t) queued.fetch_sub(1);
+    return t;
+}
+
+static void worker_loop(int self) {
+    tl_worker = self;
+    unsigned seed = (unsigned)self * 2654435761u + 1;
+
+    while (pool_running.load()) {
+        PoolTask *t = take_task(self, seed);
+        if (t) {
+            t->fn(t->arg);
+            continue;
+        }
+
+        sleepers.fetch_add(1);
+        {
+            unique_lock<mutex> lk(idle_mutex);
+            idle_cv.wait(lk, [] { return queued.load() > 0 || !pool_running.load(); });
+        }
+        sleepers.fetch_sub(1);
+    }
+}
+
+void task_pool_start(int count) {
+    if (pool_running.exchange(true)) return;
+    if (count <= 0) count = (int)thread::hardware_concurrency();
+    if (count <= 0) count = 1;
+
+    worker_count = count;
+    deques = new WsDeque[count];
+    for (int i = 0; i < count; ++i) workers.emplace_back(worker_loop, i);
+    timer_service_start();
+}
+
+void task_pool_stop() {
+    if (!pool_running.exchange(false)) return;
+    {
+        lock_guard<mutex> lk(idle_mutex);
+        idle_cv.notify_all();
+    }
+    for (auto &w : workers) w.join();
+    workers.clear();
+    timer_service_stop();
+
+    delete[] deques;
+    deques = nullptr;
+    worker_count = 0;
+    queued.store(0);
+    lock_guard<mutex> lk(inject_mutex);
+    inject_queue.clear();
+}
+
+int task_pool_worker_count() {
+    return worker_count;
+}
+
+// ------------- VEHICLE JOURNEYS ON THE POOL -----------------
+static atomic<long> journeys_remaining(0);
+static mutex done_mutex;
+static condition_variable done_cv;
+
+static void pool_run_journey(void *arg) {
+    journey_resume((VehicleJourney*)arg);
+}
+
+static void pool_resume(VehicleJourney *j) {
+    task_pool_submit((PoolTask*)j->host_data);
+}
+
+static void pool_resume_after(VehicleJourney *j, double seconds) {
+    task_pool_submit_after((PoolTask*)j->host_data, seconds);
+}
+
+static void pool_finished(VehicleJourney *) {
+    if (journeys_remaining.fetch_sub(1) == 1) {
+        lock_guard<mutex> lk(done_mutex);
+        done_cv.notify_all();
+    }
+}
+
+static const JourneyHost pool_host = { pool_resume, pool_resume_after, pool_finished, nullptr };
+
+void run_task_pool_simulation(VehicleStore &vehicles, int count,
+                              volatile sig_atomic_t *shutdown) {
+    // Grown as vehicles arrive (a deque keeps the running ones in place).
+    // The spawner holds one count until it has no more arrivals.
+    deque<VehicleJourney> journeys;
+    deque<PoolTask> tasks;
+    journeys_remaining.store(1);
+
+    task_pool_start(count);
+    log_event<LogLevel::Info>(LogEvent::PoolStarted, {task_pool_worker_count()});
+
+    // Same arrival process and pacing as the thread spawner
+    arrival_pacer_start();
+    double arrival;
+    while (Vehicle *v = vehicle_store_next(arrival)) {
+        if (!arrival_pacer_wait(arrival, shutdown)) break;
+        VehicleJourney *j = &journeys.emplace_back();
+        PoolTask *t = &tasks.emplace_back();
+        journey_init(*j, v, &pool_host, t);
+        t->fn = pool_run_journey;
+        t->arg = j;
+        journeys_remaining.fetch_add(1);
+        task_pool_submit(t);
+    }
+    pool_finished(nullptr);
+
+    {
+        unique_lock<mutex> lk(done_mutex);
+        while (journeys_remaining.load() > 0 && !*shutdown) {
+            done_cv.wait_for(lk, chrono::milliseconds(200));
+        }
+    }
+    task_pool_stop();
+    // Journeys still waiting out a crossing or a parking stay: their timers
+    // must not outlive the tasks
+    for (PoolTask &t : tasks) timer_service_cancel(&t.timer);
+
+    // On early shutdown, unfinished journeys may still be parked; drop them
+    // before their storage goes away
+    for (Intersection &I : g_network.intersections) {
+        drop_suspended_journeys(I);
+    }
+    for (ParkingLot &lot : g_network.parking) {
+        pthread_mutex_lock(&lot.state_lock);
+        wait_list_init(lot.parked);
+        lot.queued = 0;
+        pthread_mutex_unlock(&lot.state_lock);
+    }
+    for (VehicleJourney &j : journeys) journey_destroy(j);
+
+    log_event<LogLevel::Info>(LogEvent::PoolStopped, {(int)journeys_remaining.load()});
+}
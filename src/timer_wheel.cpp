@@ -0,0 +1,356 @@
+#include "timer_wheel.h"
+#include <pthread.h>
+#include <unistd.h>
+#include <cerrno>
+#include <ctime>
+#include <sys/timerfd.h>
+using namespace std;
+
+static const uint64_t SLOT_MASK = TIMER_WHEEL_SLOTS - 1;
+static const uint64_t WHEEL_SPAN = (uint64_t)1 << (TIMER_WHEEL_BITS * TIMER_WHEEL_LEVELS);
+
+static inline int slot_of(uint64_t tick, int level) {
+    return (int)((tick >> (TIMER_WHEEL_BITS * level)) & SLOT_MASK);
+}
+
+static void link_into(TimerWheel &w, TimerNode **head, TimerNode *n) {
+    n->next = *head;
+    if (n->next) n->next->pprev = &n->next;
+    n->pprev = head;
+    *head = n;
+    w.pending++;
+}
+
+// Place a node relative to w.now
+static void place(TimerWheel &w, TimerNode *n) {
+    uint64_t expires = n->expires;
+    if (expires < w.now) expires = w.now;   // overdue: expires at the current slot's next visit
+    uint64_t delta = expires - w.now;
+    if (delta >= WHEEL_SPAN) {
+        link_into(w, &w.overflow, n);
+        return;
+    }
+    int level = 0;
+    while (delta >= ((uint64_t)1 << (TIMER_WHEEL_BITS * (level + 1)))) level++;
+    int s = slot_of(expires, level);
+    w.occupied[level][s / 64] |= (uint64_t)1 << (s % 64);
+    link_into(w, &w.slots[level][s], n);
+}
+
+// Unlink, keeping the slot bitmap exact
+static void unlink_node(TimerWheel &w, TimerNode *n) {
+    TimerNode **pprev = n->pprev;
+    *pprev = n->next;
+    if (n->next) n->next->pprev = pprev;
+    n->next = nullptr;
+    n->pprev = nullptr;
+    w.pending--;
+    if (*pprev != nullptr || pprev == &w.overflow) return;
+    // pprev may be a slot head that just became empty
+    for (int level = 0; level < TIMER_WHEEL_LEVELS; ++level) {
+        TimerNode **first = &w.slots[level][0];
+        if (pprev >= first && pprev < first + TIMER_WHEEL_SLOTS) {
+            int s = (int)(pprev - first);
+            w.occupied[level][s / 64] &= ~((uint64_t)1 << (s % 64));
+            return;
+        }
+    }
+}
+
+// Take a whole slot list
+static TimerNode* take_slot(TimerWheel &w, int level, int s) {
+    TimerNode *list = w.slots[level][s];
+    w.slots[level][s] = nullptr;
+    w.occupied[level][s / 64] &= ~((uint64_t)1 << (s % 64));
+    for (TimerNode *n = list; n; n = n->next) w.pending--;
+    if (list) list->pprev = nullptr;
+    return list;
+}
+
+static void replace_list(TimerWheel &w, TimerNode *list) {
+    while (list) {
+        TimerNode *n = list;
+        list = list->next;
+        n->next = nullptr;
+        n->pprev = nullptr;
+        place(w, n);
+    }
+}
+
+void timer_wheel_init(TimerWheel &w, uint64_t now) {
+    w.now = now;
+    for (auto &level : w.slots) {
+        for (TimerNode *&s : level) s = nullptr;
+    }
+    for (auto &level : w.occupied) {
+        for (uint64_t &bits : level) bits = 0;
+    }
+    w.overflow = nullptr;
+    w.pending = 0;
+}
+
+void timer_wheel_add(TimerWheel &w, TimerNode *n, uint64_t expires) {
+    if (timer_pending(*n)) unlink_node(w, n);
+    // Never into the slot being expired right now: that one has been visited
+    n->expires = expires > w.now ? expires : w.now + 1;
+    place(w, n);
+}
+
+bool timer_wheel_cancel(TimerWheel &w, TimerNode *n) {
+    if (!timer_pending(*n)) return false;
+    unlink_node(w, n);
+    return true;
+}
+
+// First occupied level-0 slot strictly after `from` within the same rotation, or -1
+static int next_level0_slot(const TimerWheel &w, int from) {
+    for (int s = from + 1; s < TIMER_WHEEL_SLOTS; ) {
+        uint64_t bits = w.occupied[0][s / 64] >> (s % 64);
+        if (bits) return s + __builtin_ctzll(bits);
+        s = (s / 64 + 1) * 64;
+    }
+    return -1;
+}
+
+uint64_t timer_wheel_next_tick(const TimerWheel &w) {
+    if (w.pending == 0) return UINT64_MAX;
+    int s = next_level0_slot(w, (int)(w.now & SLOT_MASK));
+    if (s >= 0) return (w.now & ~SLOT_MASK) + (uint64_t)s;
+    // Nothing left in this rotation: the wrap cascades the next block down
+    return (w.now | SLOT_MASK) + 1;
+}
+
+TimerNode* timer_wheel_advance(TimerWheel &w, uint64_t now) {
+    TimerNode *head = nullptr, **tail = &head;
+    while (w.now < now) {
+        // Skip empty level-0 slots up to the next occupied one or the wrap,
+        // whichever comes first, so every cascade still happens in order
+        uint64_t next = timer_wheel_next_tick(w);
+        if (next > now) {
+            w.now = now;
+            break;
+        }
+        w.now = next;
+
+        if ((w.now & SLOT_MASK) == 0) {
+            // Cascade: the block that starts now moves one level down,
+            // coarser levels first whenever their own block starts too
+            int top = 1;
+            while (top < TIMER_WHEEL_LEVELS - 1 && slot_of(w.now, top) == 0) top++;
+            if (top == TIMER_WHEEL_LEVELS - 1 && slot_of(w.now, top) == 0) {
+                TimerNode *far = w.overflow;
+                w.overflow = nullptr;
+                for (TimerNode *n = far; n; n = n->next) w.pending--;
+                replace_list(w, far);
+            }
+            for (int level = top; level >= 1; --level) {
+                replace_list(w, take_slot(w, level, slot_of(w.now, level)));
+            }
+        }
+
+        TimerNode *due = take_slot(w, 0, (int)(w.now & SLOT_MASK));
+        while (due) {
+            TimerNode *n = due;
+            due = due->next;
+            n->next = nullptr;
+            n->pprev = nullptr;
+            *tail = n;
+            tail = &n->next;
+        }
+    }
+    return head;
+}
+
+// ---------------- Timer service ----------------
+static pthread_mutex_t service_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t service_idle = PTHREAD_COND_INITIALIZER;   // a callback returned
+static int service_users = 0;
+static bool service_running = false;
+static pthread_t service_thread;
+static int service_timer_fd = -1;
+static int64_t service_epoch_ns = 0;
+static uint64_t service_armed = UINT64_MAX;   // tick the timerfd is set for
+static TimerNode *service_firing = nullptr;   // expired, callbacks not run yet
+static TimerNode *service_current = nullptr;  // callback running now
+static TimerWheel service_wheel;
+
+int64_t timer_service_clock_ns() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static uint64_t current_tick() {
+    return (uint64_t)((timer_service_clock_ns() - service_epoch_ns) / TIMER_TICK_NS);
+}
+
+// Point the timerfd at the wheel's next tick. Caller holds service_lock.
+static void rearm_locked() {
+    uint64_t next = timer_wheel_next_tick(service_wheel);
+    if (next == service_armed) return;
+    service_armed = next;
+    itimerspec when = {};
+    if (next != UINT64_MAX) {
+        int64_t at = service_epoch_ns + (int64_t)next * TIMER_TICK_NS;
+        when.it_value.tv_sec = at / 1000000000;
+        when.it_value.tv_nsec = at % 1000000000;
+    }
+    timerfd_settime(service_timer_fd, TFD_TIMER_ABSTIME, &when, NULL);
+}
+
+static void* service_loop(void*) {
+    pthread_mutex_lock(&service_lock);
+    while (service_running) {
+        service_armed = UINT64_MAX;   // the expiry consumed the arming
+        service_firing = timer_wheel_advance(service_wheel, current_tick());
+        while (service_firing) {
+            TimerNode *n = service_firing;
+            service_firing = n->next;
+            n->next = nullptr;
+            service_current = n;
+            pthread_mutex_unlock(&service_lock);
+            n->fn(n->arg);
+            pthread_mutex_lock(&service_lock);
+            service_current = nullptr;
+            pthread_cond_broadcast(&service_idle);
+        }
+        rearm_locked();
+        pthread_mutex_unlock(&service_lock);
+
+        uint64_t expirations;
+        while (read(service_timer_fd, &expirations, sizeof(expirations)) == -1 && errno == EINTR) {}
+        pthread_mutex_lock(&service_lock);
+    }
+    pthread_mutex_unlock(&service_lock);
+    return NULL;
+}
+
+static void detach_list(TimerNode *list) {
+    while (list) {
+        TimerNode *n = list;
+        list = n->next;
+        n->next = nullptr;
+        n->pprev = nullptr;
+    }
+}
+
+void timer_service_start() {
+    pthread_mutex_lock(&service_lock);
+    if (service_users++ == 0) {
+        service_epoch_ns = timer_service_clock_ns();
+        timer_wheel_init(service_wheel, 0);
+        service_timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC);
+        service_armed = UINT64_MAX;
+        service_running = true;
+        pthread_create(&service_thread, NULL, service_loop, NULL);
+    }
+    pthread_mutex_unlock(&service_lock);
+}
+
+void timer_service_stop() {
+    pthread_mutex_lock(&service_lock);
+    if (service_users == 0 || --service_users > 0) {
+        pthread_mutex_unlock(&service_lock);
+        return;
+    }
+    service_running = false;
+    // Fire the timerfd now so the thread leaves read()
+    itimerspec soon = {};
+    soon.it_value.tv_nsec = 1;
+    timerfd_settime(service_timer_fd, 0, &soon, NULL);
+    pthread_mutex_unlock(&service_lock);
+
+    pthread_join(service_thread, NULL);
+    close(service_timer_fd);
+    service_timer_fd = -1;
+
+    // Forget what is still pending, so a later cancel finds it idle
+    pthread_mutex_lock(&service_lock);
+    for (auto &level : service_wheel.slots) {
+        for (TimerNode *s : level) detach_list(s);
+    }
+    detach_list(service_wheel.overflow);
+    detach_list(service_firing);
+    service_firing = nullptr;
+    timer_wheel_init(service_wheel, 0);
+    pthread_mutex_unlock(&service_lock);
+}
+
+void timer_service_add_at(TimerNode *n, int64_t due_ns) {
+    pthread_mutex_lock(&service_lock);
+    int64_t since = due_ns - service_epoch_ns;
+    uint64_t tick = since <= 0 ? 0 : (uint64_t)((since + TIMER_TICK_NS - 1) / TIMER_TICK_NS);
+    timer_wheel_add(service_wheel, n, tick);
+    if (service_running && tick < service_armed) rearm_locked();
+    pthread_mutex_unlock(&service_lock);
+}
+
+void timer_service_add_after(TimerNode *n, double seconds) {
+    timer_service_add_at(n, timer_service_clock_ns() + (int64_t)(seconds * 1e9));
+}
+
+bool timer_service_cancel(TimerNode *n) {
+    pthread_mutex_lock(&service_lock);
+    bool pending = timer_wheel_cancel(service_wheel, n);
+    if (!pending) {
+        // Expired but maybe not run yet (only ever one burst long)
+        for (TimerNode **link = &service_firing; *link; link = &(*link)->next) {
+            if (*link == n) {
+                *link = n->next;
+                n->next = nullptr;
+                pending = true;
+                break;
+            }
+        }
+    }
+    if (service_current == n) {
+        while (service_current == n) pthread_cond_wait(&service_idle, &service_lock);
+        // A periodic callback may have re-armed itself
+        if (timer_wheel_cancel(service_wheel, n)) pending = true;
+    }
+    pthread_mutex_unlock(&service_lock);
+    return pending;
+}
+
+// A sleeping thread waits on its own stack; it cancels its node before
+// returning, which waits out a callback still touching it.
+struct Sleeper {
+    pthread_mutex_t lock;
+    pthread_cond_t cv;
+    bool done;
+};
+
+static void wake_sleeper(void *arg) {
+    Sleeper *s = (Sleeper*)arg;
+    pthread_mutex_lock(&s->lock);
+    s->done = true;
+    pthread_cond_signal(&s->cv);
+    pthread_mutex_unlock(&s->lock);
+}
+
+void timer_service_sleep(double seconds) {
+    pthread_mutex_lock(&service_lock);
+    bool running = service_running;
+    pthread_mutex_unlock(&service_lock);
+    if (!running) {
+        timespec ts = {(time_t)seconds, (long)((seconds - (time_t)seconds) * 1e9)};
+        while (nanosleep(&ts, &ts) == -1 && errno == EINTR) {}
+        return;
+    }
+
+    Sleeper s;
+    pthread_mutex_init(&s.lock, NULL);
+    pthread_cond_init(&s.cv, NULL);
+    s.done = false;
+    TimerNode node;
+    timer_node_init(node, wake_sleeper, &s);
+    timer_service_add_after(&node, seconds);
+
+    pthread_mutex_lock(&s.lock);
+    while (!s.done) pthread_cond_wait(&s.cv, &s.lock);
+    pthread_mutex_unlock(&s.lock);
+    // The callback may still be unlocking s.lock
+    timer_service_cancel(&node);
+    pthread_mutex_destroy(&s.lock);
+    pthread_cond_destroy(&s.cv);
+}
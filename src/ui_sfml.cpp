@@ -1,10 +1,11 @@
 #include <SFML/Graphics.hpp>
-#include <map>
+#include <unordered_map>
 #include <vector>
 #include <deque>
 #include <mutex>
 #include <thread>
 #include <atomic>
+#include <chrono>
 #include <cmath>
 #include <algorithm>
 #include <sstream>
@@ -12,9 +13,9 @@
 
 #include "ui_shared.h"
 #include "parking.h"
+#include "network.h"
 
 using std::deque;
-using std::map;
 using std::string;
 using std::vector;
 
@@ -35,20 +36,19 @@ struct VisualVehicle
     VehicleType type;
     IntersectionId from, to;
     Direction dir;
-    sf::Vector2f startPos, stopLinePos, crossEndPos;
-    bool useBezier;
-    sf::Vector2f p0, p1, p2, p3;
-    float t;
+    sf::Vector2f startPos, stopLinePos, crossEndPos;   // a turn's curve is derived from these
     sf::Color color;
     VState state;
-    string stateName;
-    float pulseTime; // For emergency vehicle animation
+    unsigned seq;    // bumped on every change of state, restarting its animation
+    double leftAt;   // uiClock() when it started Leaving
+    int spot;        // parking spot id while Parked, -1 otherwise
+    int livePos;     // index in g_live
 };
 
 struct EventLog
 {
     string message;
-    float lifetime;
+    double postedAt; // uiClock()
 };
 
 struct Stats
@@ -59,24 +59,112 @@ struct Stats
     int parkedCount = 0;
 };
 
+// A parking card shows the first PARKING_SLOTS_SHOWN spots of a lot (the
+// ones nearest its entrance), two rows of five
+static const int PARKING_SLOTS_SHOWN = 10;
+
+// A lot as its card draws it
+struct ParkingView
+{
+    bool present = false;
+    int occupied = 0;
+    int maxSpots = 0;
+    bool spots[PARKING_SLOTS_SHOWN] = {};
+};
+
+// Everything a frame draws, as of one moment of the simulation
+struct UiSnapshot
+{
+    vector<VisualVehicle> cars;
+    LightColor lights[2] = {LightColor::RED, LightColor::RED};
+    bool preempts[2] = {false, false};
+    ParkingView parking[2];
+    vector<EventLog> events; // newest first
+    unsigned eventsVersion = 0;
+    Stats stats;
+};
+
+// How a car is being drawn: the state on screen (Approaching turns into
+// Waiting, Leaving into Inactive, as the animation ends) and how far along
+struct CarAnim
+{
+    unsigned seq;
+    VState state;
+    float t;
+    float pulseTime; // For emergency vehicle animation
+    unsigned frame;  // last frame whose snapshot had the car
+};
+
+// Set once at startup (--no-ui), read-only afterwards
+bool g_ui_enabled = true;
+
 static std::thread g_ui_thread;
+static std::thread g_publisher_thread;
 static std::mutex g_mutex;
 static std::atomic<bool> g_running(false);
+// Car model: g_cars is a pool of slots, recycled through g_free_slots once
+// a car has left the screen. g_live lists the occupied slots (in no
+// particular order) and g_slot_of finds a vehicle's slot, so every event is
+// O(1). The model belongs to the simulation threads, under g_mutex.
 static vector<VisualVehicle> g_cars;
-static map<IntersectionId, LightColor> g_lights;
-static map<IntersectionId, bool> g_preempts;
+static vector<int> g_free_slots;
+static vector<int> g_live;
+static std::unordered_map<int, int> g_slot_of;
+static LightColor g_lights[2];
+static bool g_preempts[2];
 static deque<EventLog> g_events;
+static unsigned g_eventsVersion = 0;
 static Stats g_stats;
+static bool g_dirty = false; // changed since the last snapshot
+
+// Handoff to the render thread, which never takes g_mutex: the hooks run
+// under Intersection::lock, so a frame holding the model while it draws
+// would hold up the signals. The hooks only update the model and mark it
+// dirty. A publisher thread, at frame rate, copies a dirty model into the
+// back snapshot and publishes it; each frame swaps in the latest published
+// one, if there is a newer one, and draws from it alone. With three
+// snapshots (one being written, one being drawn, the latest complete one
+// between them) publisher and renderer never wait for each other, and the
+// hooks wait at most for one copy per frame. The copy reuses the back
+// snapshot's vectors, so it does not allocate once they have grown.
+static const int SNAPSHOT_FRESH = 4; // g_ready holds a snapshot the render thread has not taken
+static const auto PUBLISH_PERIOD = std::chrono::milliseconds(16);
+static UiSnapshot g_snapshots[3];
+static int g_back = 0;              // being written, under g_mutex
+static std::atomic<int> g_ready(1); // latest complete, | SNAPSHOT_FRESH until taken
+static int g_front = 2;             // being drawn, render thread only
+
+// Render thread only
+static std::unordered_map<int, CarAnim> g_anims;
+static unsigned g_frame = 0;
 static float g_timeElapsed = 0.f;
 
+static const float EVENT_SECONDS = 10.f;  // an event fades out over this long
+static const size_t EVENTS_KEPT = 25;
+static const double LEAVE_SECONDS = 3.0;  // a Leaving car is off screen by then (2.5 s animation)
+
+static double uiClock()
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
 // Adjusted window dimensions
 static const unsigned WINDOW_W = 1220;
 static const unsigned WINDOW_H = 600;
+// The window shows the first two intersections of the network, the second
+// one east of the first
+static const IntersectionId WEST_ID = IntersectionId(0);
+static const IntersectionId EAST_ID = IntersectionId(1);
 static const sf::Vector2f F10_POS = {280.f, 300.f};
 static const sf::Vector2f F11_POS = {720.f, 300.f};
 static const float ROAD_WIDTH = 100.f;
 static const float INTERSIZE = 120.f;
 
+static bool onScreen(IntersectionId id)
+{
+    return (id == WEST_ID || id == EAST_ID) && (int)id < intersection_count();
+}
+
 static sf::Font *g_font = nullptr;
 static bool g_font_loaded = false;
 
@@ -141,7 +229,7 @@ static string typeToString(VehicleType t)
     return "Unknown";
 }
 
-static string stateToString(VState s)
+static const char *stateToString(VState s)
 {
     switch (s)
     {
@@ -160,6 +248,11 @@ static string stateToString(VState s)
     }
 }
 
+static bool isTurn(const VisualVehicle &c)
+{
+    return c.dir == Direction::Left || c.dir == Direction::Right;
+}
+
 static sf::Vector2f bezierPoint(const sf::Vector2f &p0, const sf::Vector2f &p1,
                                 const sf::Vector2f &p2, const sf::Vector2f &p3, float t)
 {
@@ -169,6 +262,16 @@ static sf::Vector2f bezierPoint(const sf::Vector2f &p0, const sf::Vector2f &p1,
     return uuu * p0 + 3.f * uu * t * p1 + 3.f * u * tt * p2 + ttt * p3;
 }
 
+// Point `t` along a turn: a curve from the stop line to crossEndPos whose
+// control points follow from the two (nothing per car beyond its endpoints)
+static sf::Vector2f turnPoint(const VisualVehicle &c, float t)
+{
+    sf::Vector2f mid = (c.from == WEST_ID) ? F10_POS : F11_POS;
+    sf::Vector2f p1 = c.stopLinePos + sf::Vector2f(30, 0);
+    sf::Vector2f p2 = mid + (c.crossEndPos - mid) * 0.5f;
+    return bezierPoint(c.stopLinePos, p1, p2, c.crossEndPos, t);
+}
+
 static void drawText(sf::RenderWindow &win, const string &txt, const sf::Vector2f &pos,
                      int size, const sf::Color &col, bool bold = false)
 {
@@ -199,7 +302,7 @@ static void drawGradientRect(sf::RenderWindow &win, const sf::Vector2f &pos, con
 }
 
 // Draw header bar
-static void drawHeader(sf::RenderWindow &win)
+static void drawHeader(sf::RenderWindow &win, const UiSnapshot &snap)
 {
     // Gradient background
     drawGradientRect(win, sf::Vector2f(0, 0), sf::Vector2f(WINDOW_W, 50),
@@ -213,7 +316,7 @@ static void drawHeader(sf::RenderWindow &win)
 
     // Title with glow effect
     drawText(win, "TRAFFIC SIMULATION SYSTEM", sf::Vector2f(20, 8), 22, sf::Color(100, 200, 255), true);
-    drawText(win, "F10 & F11 Intersections", sf::Vector2f(22, 32), 11, sf::Color(180, 180, 200));
+    drawText(win, network_summary() + " Intersections", sf::Vector2f(22, 32), 11, sf::Color(180, 180, 200));
 
     // Stats in header
     std::ostringstream oss;
@@ -221,7 +324,7 @@ static void drawHeader(sf::RenderWindow &win)
     drawText(win, oss.str(), sf::Vector2f(WINDOW_W - 250, 15), 12, sf::Color(200, 200, 200));
 
     oss.str("");
-    oss << "Vehicles: " << g_stats.completed << "/" << g_stats.totalVehicles;
+    oss << "Vehicles: " << snap.stats.completed << "/" << snap.stats.totalVehicles;
     drawText(win, oss.str(), sf::Vector2f(WINDOW_W - 250, 33), 12, sf::Color(200, 200, 200));
 }
 
@@ -275,10 +378,11 @@ static void drawRoads(sf::RenderWindow &win)
 }
 
 // Draw animated intersection
-static void drawIntersection(sf::RenderWindow &win, IntersectionId id, const sf::Vector2f &pos, float time)
+static void drawIntersection(sf::RenderWindow &win, const UiSnapshot &snap, IntersectionId id,
+                             const sf::Vector2f &pos, float time)
 {
-    LightColor light = g_lights[id];
-    bool preempt = g_preempts[id];
+    LightColor light = snap.lights[(int)id];
+    bool preempt = snap.preempts[(int)id];
 
     // Intersection platform with shadow
     sf::CircleShape shadow(INTERSIZE * 0.6f);
@@ -363,7 +467,7 @@ static void drawIntersection(sf::RenderWindow &win, IntersectionId id, const sf:
     labelBg.setOutlineColor(sf::Color(100, 150, 200));
     win.draw(labelBg);
 
-    string name = (id == IntersectionId::F10) ? "F10" : "F11";
+    string name = intersection_name(id);
     drawText(win, name, pos + sf::Vector2f(-20.f, -10.f), 22, sf::Color::White, true);
 
     // Emergency preempt indicator
@@ -378,10 +482,19 @@ static void drawIntersection(sf::RenderWindow &win, IntersectionId id, const sf:
     }
 }
 
+// Parking card layout
+static const float PARK_SLOT_W = 30.f, PARK_SLOT_H = 20.f, PARK_GAP = 5.f;
+
+static sf::Vector2f parkingSlotPos(const sf::Vector2f &base, int spot)
+{
+    int r = spot / 5, c = spot % 5;
+    return base + sf::Vector2f(PARK_GAP + c * (PARK_SLOT_W + PARK_GAP), 33.f + PARK_GAP + r * (PARK_SLOT_H + PARK_GAP));
+}
+
 // Draw parking lot with modern design - MORE COMPACT
-static void drawParking(sf::RenderWindow &win, const ParkingLot &lot, const sf::Vector2f &base)
+static void drawParking(sf::RenderWindow &win, const ParkingView &lot, IntersectionId id, const sf::Vector2f &base)
 {
-    const float slotW = 30.f, slotH = 20.f, gap = 5.f; // Reduced sizes
+    const float slotW = PARK_SLOT_W, slotH = PARK_SLOT_H, gap = PARK_GAP; // Reduced sizes
     const float totalW = 5 * slotW + 6 * gap;
     const float totalH = 2 * slotH + 3 * gap + 38.f; // Reduced header
 
@@ -409,87 +522,210 @@ static void drawParking(sf::RenderWindow &win, const ParkingLot &lot, const sf::
     drawText(win, "P", base + sf::Vector2f(6.f, 3.f), 18, sf::Color(100, 200, 255), true); // Reduced
 
     // Title - determine from name
-    string shortName = lot.name;
-    if (shortName.find("F10") != string::npos)
-        shortName = "F10 Parking";
-    else if (shortName.find("F11") != string::npos)
-        shortName = "F11 Parking";
+    string shortName = intersection_name(id) + " Parking";
     drawText(win, shortName, base + sf::Vector2f(28.f, 6.f), 12, sf::Color::White, true); // Reduced
 
-    int occupied = 0;
+    int occupied = lot.occupied;
+
+    // Parking spots, as the lot's spot map had them
+    for (int idx = 0; idx < PARKING_SLOTS_SHOWN; ++idx)
     {
-        auto *pl = const_cast<ParkingLot *>(&lot);
-        int lock_result = pthread_mutex_trylock(&pl->state_lock);
-        if (lock_result == 0)
+        sf::RectangleShape slot(sf::Vector2f(slotW, slotH));
+        slot.setPosition(parkingSlotPos(base, idx));
+
+        if (idx >= lot.maxSpots)
         {
-            occupied = pl->current_spots;
-            pthread_mutex_unlock(&pl->state_lock);
+            slot.setFillColor(sf::Color(50, 55, 65));
         }
-    }
-
-    // Parking spots
-    int idx = 0;
-    for (int r = 0; r < 2; ++r)
-    {
-        for (int c = 0; c < 5; ++c)
+        else if (lot.spots[idx])
         {
-            sf::RectangleShape slot(sf::Vector2f(slotW, slotH));
-            slot.setPosition(base + sf::Vector2f(gap + c * (slotW + gap), 33.f + gap + r * (slotH + gap))); // Adjusted
-
-            if (idx < occupied)
-            {
-                slot.setFillColor(sf::Color(220, 60, 60));
-                // Draw car icon
-                sf::RectangleShape car(sf::Vector2f(slotW * 0.7f, slotH * 0.6f));
-                car.setPosition(slot.getPosition() + sf::Vector2f(slotW * 0.15f, slotH * 0.2f));
-                car.setFillColor(sf::Color(180, 40, 40));
-                win.draw(car);
-            }
-            else
-            {
-                slot.setFillColor(sf::Color(60, 180, 60));
-            }
-
-            slot.setOutlineThickness(1.5f); // Reduced
-            slot.setOutlineColor(sf::Color(40, 40, 45));
-            win.draw(slot);
-            ++idx;
+            slot.setFillColor(sf::Color(220, 60, 60));
+            // Draw car icon
+            sf::RectangleShape car(sf::Vector2f(slotW * 0.7f, slotH * 0.6f));
+            car.setPosition(slot.getPosition() + sf::Vector2f(slotW * 0.15f, slotH * 0.2f));
+            car.setFillColor(sf::Color(180, 40, 40));
+            win.draw(car);
         }
+        else
+        {
+            slot.setFillColor(sf::Color(60, 180, 60));
+        }
+
+        slot.setOutlineThickness(1.5f); // Reduced
+        slot.setOutlineColor(sf::Color(40, 40, 45));
+        win.draw(slot);
     }
 
     // Status indicator
     std::ostringstream oss;
-    oss << occupied << "/" << lot.max_spots;
+    oss << occupied << "/" << lot.maxSpots;
     sf::Color statusColor = occupied >= 8 ? sf::Color(255, 100, 100) : occupied >= 5 ? sf::Color(255, 200, 100)
                                                                                      : sf::Color(100, 255, 100);
     drawText(win, oss.str(), base + sf::Vector2f(totalW - 45.f, 6.f), 12, statusColor, true); // Reduced
 }
 
-// Draw vehicle with enhanced graphics
-static void drawVehicles(sf::RenderWindow &win, float dt)
+// Car of vehicle `id`, or nullptr (caller holds g_mutex)
+static VisualVehicle *findCar(int id)
 {
-    std::lock_guard<std::mutex> lk(g_mutex);
+    auto it = g_slot_of.find(id);
+    return it == g_slot_of.end() ? nullptr : &g_cars[it->second];
+}
 
-    for (auto &c : g_cars)
+// The car of vehicle `id`, taking a free slot if it has none yet (caller holds g_mutex)
+static VisualVehicle &takeCar(int id)
+{
+    if (VisualVehicle *c = findCar(id))
+        return *c;
+    int slot;
+    if (!g_free_slots.empty())
     {
-        if (c.state == VState::Inactive)
-            continue;
+        slot = g_free_slots.back();
+        g_free_slots.pop_back();
+    }
+    else
+    {
+        slot = (int)g_cars.size();
+        g_cars.emplace_back();
+    }
+    g_slot_of[id] = slot;
+    VisualVehicle &c = g_cars[slot];
+    c.id = id;
+    c.livePos = (int)g_live.size();
+    g_live.push_back(slot);
+    return c;
+}
+
+// Give a car's slot back: the last live car takes its place in g_live (caller holds g_mutex)
+static void releaseCar(int slot)
+{
+    VisualVehicle &c = g_cars[slot];
+    int last = g_live.back();
+    g_live[c.livePos] = last;
+    g_cars[last].livePos = c.livePos;
+    g_live.pop_back();
+    g_slot_of.erase(c.id);
+    c.state = VState::Inactive;
+    g_free_slots.push_back(slot);
+}
+
+// Let go of cars that have driven off screen (caller holds g_mutex)
+static void releaseGoneCars()
+{
+    // Backwards, so a car released on the way is replaced by one already seen
+    double now = uiClock();
+    for (size_t k = g_live.size(); k-- > 0;)
+    {
+        int slot = g_live[k];
+        if (g_cars[slot].state == VState::Leaving && now - g_cars[slot].leftAt >= LEAVE_SECONDS)
+        {
+            releaseCar(slot);
+            g_dirty = true;
+        }
+    }
+}
+
+// A lot's occupancy, read from its spot map without the lot's lock: a
+// publisher holding g_mutex must not wait on parking
+static void copyParking(IntersectionId id, ParkingView &view)
+{
+    const ParkingLot *lot = onScreen(id) ? parking_at(id) : nullptr;
+    view.present = lot != nullptr;
+    if (!lot)
+        return;
+    view.occupied = spot_map_used(lot->spot_map);
+    view.maxSpots = lot->max_spots;
+    for (int idx = 0; idx < PARKING_SLOTS_SHOWN; ++idx)
+        view.spots[idx] = idx < lot->max_spots && spot_map_occupied(lot->spot_map, idx);
+}
+
+// Copy the model into the back snapshot and make it the latest (caller holds g_mutex)
+static void publishLocked()
+{
+    UiSnapshot &snap = g_snapshots[g_back];
+    snap.cars.clear();
+    for (int slot : g_live)
+        snap.cars.push_back(g_cars[slot]);
+    std::copy(g_lights, g_lights + 2, snap.lights);
+    std::copy(g_preempts, g_preempts + 2, snap.preempts);
+    copyParking(WEST_ID, snap.parking[(int)WEST_ID]);
+    copyParking(EAST_ID, snap.parking[(int)EAST_ID]);
+    if (snap.eventsVersion != g_eventsVersion)
+    {
+        snap.events.assign(g_events.begin(), g_events.end());
+        snap.eventsVersion = g_eventsVersion;
+    }
+    snap.stats = g_stats;
+    g_dirty = false;
+    g_back = g_ready.exchange(g_back | SNAPSHOT_FRESH, std::memory_order_acq_rel) & 3;
+}
+
+// Publish the model at frame rate while it changes
+static void publisher_loop()
+{
+    auto next = std::chrono::steady_clock::now();
+    while (g_running.load())
+    {
+        {
+            std::lock_guard<std::mutex> lk(g_mutex);
+            releaseGoneCars();
+            if (g_dirty)
+                publishLocked();
+        }
+        next += PUBLISH_PERIOD;
+        std::this_thread::sleep_until(next);
+    }
+}
 
-        c.pulseTime += dt * 4.f;
+// Latest snapshot the simulation has published (render thread)
+static const UiSnapshot &takeSnapshot()
+{
+    if (g_ready.load(std::memory_order_relaxed) & SNAPSHOT_FRESH)
+        g_front = g_ready.exchange(g_front, std::memory_order_acq_rel) & 3;
+    return g_snapshots[g_front];
+}
+
+// The animation of car `c`, restarted if its state changed since the last frame
+static CarAnim &carAnim(const VisualVehicle &c)
+{
+    CarAnim &a = g_anims[c.id];
+    if (a.seq != c.seq)
+    {
+        a.seq = c.seq;
+        a.state = c.state;
+        a.t = 0.f;
+    }
+    a.frame = g_frame;
+    return a;
+}
+
+// State of car `c` as drawn this frame
+static VState shownState(const VisualVehicle &c)
+{
+    auto it = g_anims.find(c.id);
+    return it == g_anims.end() ? c.state : it->second.state;
+}
+
+// Draw vehicle with enhanced graphics
+static void drawVehicles(sf::RenderWindow &win, const UiSnapshot &snap, float dt)
+{
+    g_frame++;
+    for (const VisualVehicle &c : snap.cars)
+    {
+        CarAnim &a = carAnim(c);
+        a.pulseTime += dt * 4.f;
 
         sf::Vector2f pos;
-        switch (c.state)
+        switch (a.state)
         {
         case VState::Approaching:
         {
-            c.t += dt * 0.25f; // Slower approach
-            if (c.t > 1.f)
+            a.t += dt * 0.25f; // Slower approach
+            if (a.t > 1.f)
             {
-                c.t = 1.f;
-                c.state = VState::Waiting;
-                c.stateName = stateToString(c.state);
+                a.t = 1.f;
+                a.state = VState::Waiting;
             }
-            pos = c.startPos + (c.stopLinePos - c.startPos) * c.t;
+            pos = c.startPos + (c.stopLinePos - c.startPos) * a.t;
             break;
         }
         case VState::Waiting:
@@ -499,38 +735,42 @@ static void drawVehicles(sf::RenderWindow &win, float dt)
         }
         case VState::Crossing:
         {
-            c.t += dt * 0.35f; // Slower crossing
-            if (c.t > 1.f)
+            a.t += dt * 0.35f; // Slower crossing
+            if (a.t > 1.f)
             {
-                c.t = 1.f;
+                a.t = 1.f;
             }
-            if (c.useBezier)
+            if (isTurn(c))
             {
-                pos = bezierPoint(c.p0, c.p1, c.p2, c.p3, c.t);
+                pos = turnPoint(c, a.t);
             }
             else
             {
-                pos = c.stopLinePos + (c.crossEndPos - c.stopLinePos) * c.t;
+                pos = c.stopLinePos + (c.crossEndPos - c.stopLinePos) * a.t;
             }
             break;
         }
         case VState::Parked:
         {
             // Position vehicle at the parking lot
-            sf::Vector2f parkBase = (c.from == IntersectionId::F10) ? (F10_POS + sf::Vector2f(-150.f, 150.f)) : (F11_POS + sf::Vector2f(15.f, 150.f));
-            // Center in parking area
-            pos = parkBase + sf::Vector2f(100.f, 45.f);
+            sf::Vector2f parkBase = (c.from == WEST_ID) ? (F10_POS + sf::Vector2f(-150.f, 150.f)) : (F11_POS + sf::Vector2f(15.f, 150.f));
+            // On its own spot if the card shows it, else centered in the parking area
+            if (c.spot >= 0 && c.spot < PARKING_SLOTS_SHOWN)
+                pos = parkingSlotPos(parkBase, c.spot) + sf::Vector2f(PARK_SLOT_W / 2.f, PARK_SLOT_H / 2.f);
+            else
+                pos = parkBase + sf::Vector2f(100.f, 45.f);
             break;
         }
         case VState::Leaving:
         {
-            c.t += dt * 0.4f; // Slower departure
-            if (c.t > 1.f)
+            a.t += dt * 0.4f; // Slower departure
+            if (a.t > 1.f)
             {
-                c.state = VState::Inactive;
+                a.state = VState::Inactive; // off screen until the model lets go of it
+                continue;
             }
-            float dir = (c.to == IntersectionId::F10) ? -1.f : 1.f;
-            pos = c.crossEndPos + sf::Vector2f(dir * c.t * 120.f, 0.f);
+            float dir = (c.to == WEST_ID) ? -1.f : 1.f;
+            pos = c.crossEndPos + sf::Vector2f(dir * a.t * 120.f, 0.f);
             break;
         }
         case VState::Inactive:
@@ -541,7 +781,7 @@ static void drawVehicles(sf::RenderWindow &win, float dt)
         // Emergency vehicle glow/pulse
         if (c.type == VehicleType::Ambulance || c.type == VehicleType::FireTruck)
         {
-            float pulse = 0.5f + 0.5f * std::sin(c.pulseTime);
+            float pulse = 0.5f + 0.5f * std::sin(a.pulseTime);
             sf::CircleShape glow(22.f);
             glow.setOrigin(22.f, 22.f);
             glow.setPosition(pos);
@@ -585,14 +825,18 @@ static void drawVehicles(sf::RenderWindow &win, float dt)
         drawText(win, oss.str(), pos + sf::Vector2f(-10.f, -34.f), 11, sf::Color::White, true);
     }
 
-    g_cars.erase(std::remove_if(g_cars.begin(), g_cars.end(),
-                                [](const VisualVehicle &v)
-                                { return v.state == VState::Inactive; }),
-                 g_cars.end());
+    // Cars gone from the model
+    for (auto it = g_anims.begin(); it != g_anims.end();)
+    {
+        if (it->second.frame != g_frame)
+            it = g_anims.erase(it);
+        else
+            ++it;
+    }
 }
 
 // Draw comprehensive info panel - MORE COMPACT
-static void drawInfoPanel(sf::RenderWindow &win)
+static void drawInfoPanel(sf::RenderWindow &win, const UiSnapshot &snap)
 {
     const float panelX = WINDOW_W - 220.f; // Slightly narrower
     const float panelY = 60.f;             // Reduced from 80
@@ -631,22 +875,22 @@ static void drawInfoPanel(sf::RenderWindow &win)
     yOffset += 18.f;                                                                                       // Reduced
 
     std::ostringstream oss;
-    oss << "Total Vehicles: " << g_stats.totalVehicles;
+    oss << "Total Vehicles: " << snap.stats.totalVehicles;
     drawText(win, oss.str(), sf::Vector2f(panelX + 15.f, yOffset), 10, sf::Color(200, 200, 200)); // Reduced
     yOffset += 14.f;                                                                              // Reduced
 
     oss.str("");
-    oss << "Completed: " << g_stats.completed;
+    oss << "Completed: " << snap.stats.completed;
     drawText(win, oss.str(), sf::Vector2f(panelX + 15.f, yOffset), 10, sf::Color(100, 255, 100));
     yOffset += 14.f;
 
     oss.str("");
-    oss << "Active: " << (g_stats.totalVehicles - g_stats.completed);
+    oss << "Active: " << (snap.stats.totalVehicles - snap.stats.completed);
     drawText(win, oss.str(), sf::Vector2f(panelX + 15.f, yOffset), 10, sf::Color(255, 200, 100));
     yOffset += 14.f;
 
     oss.str("");
-    oss << "Emergency Count: " << g_stats.emergencyCount;
+    oss << "Emergency Count: " << snap.stats.emergencyCount;
     drawText(win, oss.str(), sf::Vector2f(panelX + 15.f, yOffset), 10, sf::Color(255, 100, 100));
     yOffset += 18.f; // Reduced
 
@@ -658,12 +902,12 @@ static void drawInfoPanel(sf::RenderWindow &win)
     drawText(win, "Intersections", sf::Vector2f(panelX + 12.f, yOffset), 13, sf::Color(150, 200, 255), true);
     yOffset += 18.f;
 
-    // F10 status - COMPACT
-    drawText(win, "F10 Intersection", sf::Vector2f(panelX + 15.f, yOffset), 11, sf::Color::Cyan, true); // Reduced
+    // West intersection status - COMPACT
+    drawText(win, intersection_name(WEST_ID) + " Intersection", sf::Vector2f(panelX + 15.f, yOffset), 11, sf::Color::Cyan, true); // Reduced
     yOffset += 16.f;                                                                                    // Reduced
 
-    string f10Light = (g_lights[IntersectionId::F10] == LightColor::GREEN) ? "GREEN" : "RED";
-    sf::Color f10Col = (g_lights[IntersectionId::F10] == LightColor::GREEN) ? sf::Color(80, 255, 80) : sf::Color(255, 80, 80);
+    string f10Light = (snap.lights[(int)WEST_ID] == LightColor::GREEN) ? "GREEN" : "RED";
+    sf::Color f10Col = (snap.lights[(int)WEST_ID] == LightColor::GREEN) ? sf::Color(80, 255, 80) : sf::Color(255, 80, 80);
 
     sf::CircleShape statusDot(4); // Reduced size
     statusDot.setPosition(panelX + 20, yOffset + 2);
@@ -673,19 +917,19 @@ static void drawInfoPanel(sf::RenderWindow &win)
     drawText(win, "Signal: " + f10Light, sf::Vector2f(panelX + 30.f, yOffset), 9, f10Col); // Reduced
     yOffset += 14.f;                                                                       // Reduced
 
-    if (g_preempts[IntersectionId::F10])
+    if (snap.preempts[(int)WEST_ID])
     {
         drawText(win, "Status: PREEMPTED", sf::Vector2f(panelX + 30.f, yOffset), 9, sf::Color(255, 150, 0), true);
         yOffset += 14.f;
     }
     yOffset += 6.f;
 
-    // F11 status - COMPACT
-    drawText(win, "F11 Intersection", sf::Vector2f(panelX + 15.f, yOffset), 11, sf::Color::Cyan, true);
+    // East intersection status - COMPACT
+    drawText(win, intersection_name(EAST_ID) + " Intersection", sf::Vector2f(panelX + 15.f, yOffset), 11, sf::Color::Cyan, true);
     yOffset += 16.f;
 
-    string f11Light = (g_lights[IntersectionId::F11] == LightColor::GREEN) ? "GREEN" : "RED";
-    sf::Color f11Col = (g_lights[IntersectionId::F11] == LightColor::GREEN) ? sf::Color(80, 255, 80) : sf::Color(255, 80, 80);
+    string f11Light = (snap.lights[(int)EAST_ID] == LightColor::GREEN) ? "GREEN" : "RED";
+    sf::Color f11Col = (snap.lights[(int)EAST_ID] == LightColor::GREEN) ? sf::Color(80, 255, 80) : sf::Color(255, 80, 80);
 
     statusDot.setPosition(panelX + 20, yOffset + 2);
     statusDot.setFillColor(f11Col);
@@ -694,7 +938,7 @@ static void drawInfoPanel(sf::RenderWindow &win)
     drawText(win, "Signal: " + f11Light, sf::Vector2f(panelX + 30.f, yOffset), 9, f11Col);
     yOffset += 14.f;
 
-    if (g_preempts[IntersectionId::F11])
+    if (snap.preempts[(int)EAST_ID])
     {
         drawText(win, "Status: PREEMPTED", sf::Vector2f(panelX + 30.f, yOffset), 9, sf::Color(255, 150, 0), true);
         yOffset += 14.f;
@@ -709,11 +953,11 @@ static void drawInfoPanel(sf::RenderWindow &win)
     drawText(win, "Active Vehicles", sf::Vector2f(panelX + 12.f, yOffset), 13, sf::Color(150, 200, 255), true);
     yOffset += 18.f;
 
-    std::lock_guard<std::mutex> lk(g_mutex);
     int count = 0;
-    for (auto &c : g_cars)
+    for (const VisualVehicle &c : snap.cars)
     {
-        if (c.state == VState::Inactive)
+        VState state = shownState(c);
+        if (state == VState::Inactive)
             continue;
         if (count >= 6)
         { // Reduced from 8 to 6
@@ -733,7 +977,7 @@ static void drawInfoPanel(sf::RenderWindow &win)
         voss << "#" << c.id << " " << typeToString(c.type).substr(0, 6);                      // Shorter
         drawText(win, voss.str(), sf::Vector2f(panelX + 28.f, yOffset), 9, sf::Color::White); // Reduced
 
-        drawText(win, c.stateName, sf::Vector2f(panelX + 145.f, yOffset), 8, sf::Color(180, 180, 180)); // Reduced
+        drawText(win, stateToString(state), sf::Vector2f(panelX + 145.f, yOffset), 8, sf::Color(180, 180, 180)); // Reduced
         yOffset += 13.f;                                                                                // Reduced spacing
         count++;
     }
@@ -749,11 +993,15 @@ static void drawInfoPanel(sf::RenderWindow &win)
     yOffset += 18.f;
 
     int evCount = 0;
-    for (auto &ev : g_events)
+    double now = uiClock();
+    for (auto &ev : snap.events)
     {
         if (evCount >= 8 || yOffset > panelY + panelH - 15)
             break; // Reduced from 10 to 8
-        float alpha = std::min(255.f, ev.lifetime * 50.f);
+        float lifetime = EVENT_SECONDS - (float)(now - ev.postedAt);
+        if (lifetime <= 0.f)
+            break; // newest first, so the rest are older still
+        float alpha = std::min(255.f, lifetime * 50.f);
         drawText(win, ev.message, sf::Vector2f(panelX + 15.f, yOffset), 8, // Reduced font
                  sf::Color(200, 200, 200, static_cast<sf::Uint8>(alpha)));
         yOffset += 12.f; // Reduced spacing
@@ -800,67 +1048,38 @@ static void drawLegend(sf::RenderWindow &win)
     drawText(win, "Normal (Car/Bike/Tractor)", sf::Vector2f(legX + 22, y - 3), 8, sf::Color::White);
 }
 
-static void updateEvents(float dt)
-{
-    std::lock_guard<std::mutex> lk(g_mutex);
-    for (auto &ev : g_events)
-    {
-        ev.lifetime -= dt;
-    }
-    g_events.erase(std::remove_if(g_events.begin(), g_events.end(),
-                                  [](const EventLog &e)
-                                  { return e.lifetime <= 0.f; }),
-                   g_events.end());
-}
-
 static void computePath(VisualVehicle &c)
 {
-    // Same bezier path computation as before
-    c.useBezier = (c.dir == Direction::Left || c.dir == Direction::Right);
-    if (c.useBezier)
+    // Turns end above (left) or below (right) the intersection
+    if (isTurn(c))
     {
-        sf::Vector2f mid = (c.from == IntersectionId::F10) ? F10_POS : F11_POS;
-        c.p0 = c.stopLinePos;
-        if (c.dir == Direction::Left)
-        {
-            c.p1 = c.p0 + sf::Vector2f(30, 0);
-            c.p2 = mid + sf::Vector2f(0, -50);
-            c.p3 = mid + sf::Vector2f(0, -100);
-        }
-        else
-        {
-            c.p1 = c.p0 + sf::Vector2f(30, 0);
-            c.p2 = mid + sf::Vector2f(0, 50);
-            c.p3 = mid + sf::Vector2f(0, 100);
-        }
-        c.crossEndPos = c.p3;
+        sf::Vector2f mid = (c.from == WEST_ID) ? F10_POS : F11_POS;
+        c.crossEndPos = mid + sf::Vector2f(0, c.dir == Direction::Left ? -100.f : 100.f);
     }
 }
 
 static void addApproachVehicle(IntersectionId id, Vehicle *v)
 {
     std::lock_guard<std::mutex> lk(g_mutex);
-    VisualVehicle vc;
-    vc.id = v->id;
+    VisualVehicle &vc = takeCar(v->id);
     vc.type = v->type;
     vc.from = v->originIntersection;
     vc.to = v->destIntersection;
     vc.dir = v->direction;
     vc.color = vehicleColor(v->type);
     vc.state = VState::Approaching;
-    vc.stateName = stateToString(vc.state);
-    vc.t = 0.f;
-    vc.pulseTime = 0.f;
+    vc.seq++;
+    vc.spot = -1;
 
-    sf::Vector2f fromPos = (id == IntersectionId::F10) ? F10_POS : F11_POS;
-    sf::Vector2f toPos = (vc.to == IntersectionId::F10) ? F10_POS : F11_POS;
+    sf::Vector2f fromPos = (id == WEST_ID) ? F10_POS : F11_POS;
+    sf::Vector2f toPos = (vc.to == WEST_ID) ? F10_POS : F11_POS;
 
     // Determine approach direction based on which intersection vehicle is coming from
     // F10 is on the LEFT (x=280), F11 is on the RIGHT (x=720)
     // If approaching F10 from left: start further left
     // If approaching F11 from left (from F10): start from F10 side
     float approachDir;
-    if (id == IntersectionId::F10)
+    if (id == WEST_ID)
     {
         // Approaching F10: must come from the LEFT (west)
         approachDir = -1.f;
@@ -878,12 +1097,12 @@ static void addApproachVehicle(IntersectionId id, Vehicle *v)
     if (vc.dir == Direction::Straight)
     {
         // Going straight through means: F10->F11 or F11->F10
-        if (id == IntersectionId::F10 && vc.to == IntersectionId::F11)
+        if (id == WEST_ID && vc.to == EAST_ID)
         {
             // F10 to F11: exit on the RIGHT side of F11
             vc.crossEndPos = toPos + sf::Vector2f(100.f, 0.f);
         }
-        else if (id == IntersectionId::F11 && vc.to == IntersectionId::F10)
+        else if (id == EAST_ID && vc.to == WEST_ID)
         {
             // F11 to F10: exit on the LEFT side of F10
             vc.crossEndPos = toPos + sf::Vector2f(-100.f, 0.f);
@@ -899,27 +1118,20 @@ static void addApproachVehicle(IntersectionId id, Vehicle *v)
         // For turns, will be computed in computePath
         vc.crossEndPos = fromPos + sf::Vector2f(-approachDir * 100.f, 0.f);
     }
-    vc.useBezier = false;
 
-    g_cars.push_back(vc);
     g_stats.totalVehicles++;
     if (v->type == VehicleType::Ambulance || v->type == VehicleType::FireTruck)
     {
         g_stats.emergencyCount++;
     }
+    g_dirty = true;
 }
 
 static void ui_loop()
 {
     tryLoadFont();
 
-    g_lights[IntersectionId::F10] = LightColor::RED;
-    g_lights[IntersectionId::F11] = LightColor::RED;
-    g_preempts[IntersectionId::F10] = false;
-    g_preempts[IntersectionId::F11] = false;
-    g_stats = Stats();
-
-    sf::RenderWindow window(sf::VideoMode(WINDOW_W, WINDOW_H), "Traffic Simulation - F10 & F11 Intersections");
+    sf::RenderWindow window(sf::VideoMode(WINDOW_W, WINDOW_H), "Traffic Simulation - " + network_summary() + " Intersections");
     window.setFramerateLimit(60);
 
     sf::Clock clock;
@@ -947,49 +1159,49 @@ static void ui_loop()
         // Dark gradient background
         window.clear(sf::Color(15, 18, 25));
 
-        drawHeader(window);
+        const UiSnapshot &snap = takeSnapshot();
+        drawHeader(window, snap);
         drawRoads(window);
-        drawIntersection(window, IntersectionId::F10, F10_POS, time);
-        drawIntersection(window, IntersectionId::F11, F11_POS, time);
+        drawIntersection(window, snap, WEST_ID, F10_POS, time);
+        if (onScreen(EAST_ID))
+            drawIntersection(window, snap, EAST_ID, F11_POS, time);
 
         // Parking lots - adjusted positions
-        drawParking(window, F10_parking, F10_POS + sf::Vector2f(-150.f, 150.f));
-        drawParking(window, F11_parking, F11_POS + sf::Vector2f(15.f, 150.f));
+        if (snap.parking[(int)WEST_ID].present)
+            drawParking(window, snap.parking[(int)WEST_ID], WEST_ID, F10_POS + sf::Vector2f(-150.f, 150.f));
+        if (snap.parking[(int)EAST_ID].present)
+            drawParking(window, snap.parking[(int)EAST_ID], EAST_ID, F11_POS + sf::Vector2f(15.f, 150.f));
 
-        drawVehicles(window, dt);
-        drawInfoPanel(window);
+        drawVehicles(window, snap, dt);
+        drawInfoPanel(window, snap);
         drawLegend(window);
 
         // Emergency banner when preemption is active
+        bool westPreempt = snap.preempts[(int)WEST_ID], eastPreempt = snap.preempts[(int)EAST_ID];
+        if (westPreempt || eastPreempt)
         {
-            std::lock_guard<std::mutex> lk(g_mutex);
-            if (g_preempts[IntersectionId::F10] || g_preempts[IntersectionId::F11])
+            float flash = (std::sin(time * 8.f) > 0.f) ? 1.f : 0.6f;
+            sf::RectangleShape banner(sf::Vector2f(WINDOW_W, 40));
+            banner.setPosition(0, 65);
+            banner.setFillColor(sf::Color(180, 0, 0, 150 * flash));
+            window.draw(banner);
+
+            std::string msg = "⚠️ EMERGENCY VEHICLE - PRIORITY ACTIVE";
+            if (westPreempt && eastPreempt)
+            {
+                msg += " (" + intersection_name(WEST_ID) + " & " + intersection_name(EAST_ID) + ")";
+            }
+            else if (westPreempt)
             {
-                float flash = (std::sin(time * 8.f) > 0.f) ? 1.f : 0.6f;
-                sf::RectangleShape banner(sf::Vector2f(WINDOW_W, 40));
-                banner.setPosition(0, 65);
-                banner.setFillColor(sf::Color(180, 0, 0, 150 * flash));
-                window.draw(banner);
-
-                std::string msg = "⚠️ EMERGENCY VEHICLE - PRIORITY ACTIVE";
-                if (g_preempts[IntersectionId::F10] && g_preempts[IntersectionId::F11])
-                {
-                    msg += " (F10 & F11)";
-                }
-                else if (g_preempts[IntersectionId::F10])
-                {
-                    msg += " (F10)";
-                }
-                else
-                {
-                    msg += " (F11)";
-                }
-                drawText(window, msg, sf::Vector2f(WINDOW_W / 2 - 220, 72), 17, sf::Color::White, true);
+                msg += " (" + intersection_name(WEST_ID) + ")";
             }
+            else
+            {
+                msg += " (" + intersection_name(EAST_ID) + ")";
+            }
+            drawText(window, msg, sf::Vector2f(WINDOW_W / 2 - 220, 72), 17, sf::Color::White, true);
         }
 
-        updateEvents(dt);
-
         window.display();
     }
 
@@ -1000,10 +1212,25 @@ static void ui_loop()
 }
 
 // Public API (same interface)
+void ui_set_enabled(bool enabled)
+{
+    g_ui_enabled = enabled;
+}
+
 void ui_start()
 {
+    if (!g_ui_enabled)
+        return;
     if (g_running.exchange(true))
         return;
+    {
+        std::lock_guard<std::mutex> lk(g_mutex);
+        std::fill(g_lights, g_lights + 2, LightColor::RED);
+        std::fill(g_preempts, g_preempts + 2, false);
+        g_stats = Stats();
+        publishLocked();
+    }
+    g_publisher_thread = std::thread(publisher_loop);
     g_ui_thread = std::thread(ui_loop);
 }
 
@@ -1012,6 +1239,8 @@ void ui_stop()
     g_running.store(false);
     if (g_ui_thread.joinable())
         g_ui_thread.join();
+    if (g_publisher_thread.joinable())
+        g_publisher_thread.join();
     if (g_font)
     {
         delete g_font;
@@ -1022,86 +1251,95 @@ void ui_stop()
 
 void ui_notify_vehicle_approach(IntersectionId id, Vehicle *v)
 {
+    if (!g_ui_enabled || !onScreen(id))
+        return;
     addApproachVehicle(id, v);
 }
 
 void ui_notify_vehicle_enter(IntersectionId id, Vehicle *v)
 {
+    if (!g_ui_enabled)
+        return;
     (void)id;
     std::lock_guard<std::mutex> lk(g_mutex);
-    for (auto &c : g_cars)
+    if (VisualVehicle *c = findCar(v->id))
     {
-        if (c.id == v->id)
-        {
-            c.state = VState::Crossing;
-            c.stateName = stateToString(c.state);
-            c.t = 0.f;
-            computePath(c);
-            break;
-        }
+        c->state = VState::Crossing;
+        c->seq++;
+        computePath(*c);
+        g_dirty = true;
     }
 }
 
 void ui_notify_vehicle_exit(IntersectionId id, Vehicle *v)
 {
+    if (!g_ui_enabled)
+        return;
     (void)id;
     std::lock_guard<std::mutex> lk(g_mutex);
-    for (auto &c : g_cars)
+    if (VisualVehicle *c = findCar(v->id))
     {
-        if (c.id == v->id)
-        {
-            c.state = VState::Leaving;
-            c.stateName = stateToString(c.state);
-            c.t = 0.f;
-            g_stats.completed++;
-            break;
-        }
+        c->state = VState::Leaving;
+        c->seq++;
+        c->leftAt = uiClock();
+        g_stats.completed++;
+        g_dirty = true;
     }
 }
 
-void ui_notify_vehicle_parking(int vehicleId, bool entering)
+void ui_notify_vehicle_parking(int vehicleId, bool entering, int spot)
 {
+    if (!g_ui_enabled)
+        return;
     std::lock_guard<std::mutex> lk(g_mutex);
-    for (auto &c : g_cars)
+    if (VisualVehicle *c = findCar(vehicleId))
     {
-        if (c.id == vehicleId)
+        if (entering)
         {
-            if (entering)
-            {
-                c.state = VState::Parked;
-                c.stateName = stateToString(c.state);
-                g_stats.parkedCount++;
-            }
-            else
-            {
-                c.state = VState::Leaving;
-                c.stateName = stateToString(c.state);
-                c.t = 0.f;
-            }
-            break;
+            c->spot = spot;
+            c->state = VState::Parked;
+            g_stats.parkedCount++;
         }
+        else
+        {
+            c->state = VState::Leaving;
+            c->spot = -1;
+            c->leftAt = uiClock();
+        }
+        c->seq++;
+        g_dirty = true;
     }
 }
 
 void ui_update_signal(IntersectionId id, LightColor color)
 {
+    if (!g_ui_enabled || !onScreen(id))
+        return;
     std::lock_guard<std::mutex> lk(g_mutex);
-    g_lights[id] = color;
+    g_lights[(int)id] = color;
+    g_dirty = true;
 }
 
 void ui_notify_emergency_preempt(IntersectionId id, bool active)
 {
+    if (!g_ui_enabled || !onScreen(id))
+        return;
     std::lock_guard<std::mutex> lk(g_mutex);
-    g_preempts[id] = active;
+    g_preempts[(int)id] = active;
+    g_dirty = true;
 }
 
 void ui_log_event(const std::string &message)
 {
+    if (!g_ui_enabled)
+        return;
     std::lock_guard<std::mutex> lk(g_mutex);
     EventLog ev;
     ev.message = message.substr(0, 45);
-    ev.lifetime = 10.f;
+    ev.postedAt = uiClock();
     g_events.push_front(ev);
-    if (g_events.size() > 25)
+    if (g_events.size() > EVENTS_KEPT)
         g_events.pop_back();
+    g_eventsVersion++;
+    g_dirty = true;
 }
\ No newline at end of file
@@ -1,53 +1,18 @@
-#include <iostream>
 #include <pthread.h>
-#include <unistd.h>   // sleep
-#include <cstdlib>    // rand
 #include <sstream>
-#include <iomanip>
-#include <mutex>
 using namespace std;
 
-// External log mutex
-extern mutex g_log_mutex;
-
-// ANSI Color Codes
-#define ANSI_RESET   "\033[0m"
-#define ANSI_BOLD    "\033[1m"
-#define ANSI_RED     "\033[31m"
-#define ANSI_GREEN   "\033[32m"
-#define ANSI_YELLOW  "\033[33m"
-#define ANSI_BLUE    "\033[34m"
-#define ANSI_MAGENTA "\033[35m"
-#define ANSI_CYAN    "\033[36m"
-
 #include "vehicle.h"
 #include "intersection.h"
 #include "parking.h"
+#include "network.h"
 #include "controller.h"   // for notify_emergency_from_to
 #include "ui_shared.h"     // for UI approach hooks
-
-// ------------- RANDOM HELPERS -----------------
-static int rand_int(int min, int max) {
-    return min + rand() % (max - min + 1);
-}
-
-static bool rand_bool(float probability = 0.5) {
-    return ((float)rand() / RAND_MAX) < probability;
-}
+#include "log.h"
+#include "timer_wheel.h"
+#include "vehicle_store.h"
 
 // ------------- STRING FUNCTIONS ----------------
-static string vehicleEmoji(VehicleType type) {
-    switch (type) {
-        case VehicleType::Ambulance: return "🚑";
-        case VehicleType::FireTruck: return "🚒";
-        case VehicleType::Bus:       return "🚌";
-        case VehicleType::Car:       return "🚗";
-        case VehicleType::Bike:      return "🚲";
-        case VehicleType::Tractor:   return "🚜";
-    }
-    return "🚙";
-}
-
 string to_string(VehicleType type) {
     switch (type) {
         case VehicleType::Ambulance: return "Ambulance";
@@ -60,6 +25,16 @@ string to_string(VehicleType type) {
     return "Unknown";
 }
 
+string to_string(Approach approach) {
+    switch (approach) {
+        case Approach::North: return "North";
+        case Approach::East:  return "East";
+        case Approach::South: return "South";
+        case Approach::West:  return "West";
+    }
+    return "Unknown";
+}
+
 string to_string(Direction dir) {
     switch (dir) {
         case Direction::Straight: return "Straight";
@@ -70,11 +45,7 @@ string to_string(Direction dir) {
 }
 
 string to_string(IntersectionId id) {
-    switch (id) {
-        case IntersectionId::F10: return "F10";
-        case IntersectionId::F11: return "F11";
-    }
-    return "Unknown";
+    return intersection_name(id);
 }
 
 // ------------- PRIORITY RULES ------------------
@@ -87,10 +58,27 @@ int compute_priority(VehicleType type) {
 
 // ------------- RANDOM VEHICLE GENERATION --------
 Vehicle make_random_vehicle(int id) {
-    VehicleType type = static_cast<VehicleType>(rand_int(0, 5));
-    IntersectionId origin = rand_bool() ? IntersectionId::F10 : IntersectionId::F11;
-    IntersectionId dest   = rand_bool() ? IntersectionId::F10 : IntersectionId::F11;
-    Direction dir = static_cast<Direction>(rand_int(0, 2));
+    // Everything about the vehicle comes from its own stream: same seed, same vehicle
+    SimRng rng = sim_rng_stream(SIM_STREAM_VEHICLE + (uint64_t)id);
+    const TrafficProfile &traffic = g_network.traffic;
+    VehicleType type = static_cast<VehicleType>(sim_rng_pick(rng, traffic.type_weight, 6));
+    int from = sim_rng_int(rng, 0, intersection_count() - 1);
+    IntersectionId origin = (IntersectionId)from;
+    IntersectionId dest = origin;
+    Approach approach = static_cast<Approach>(sim_rng_int(rng, 0, 3));
+    Direction dir = static_cast<Direction>(sim_rng_pick(rng, traffic.turn_weight, 3));
+
+    // Some vehicles head for a neighbour: arrive on the side that makes their
+    // turn leave on the side its road starts on
+    int outgoing = g_network.out_begin[from + 1] - g_network.out_begin[from];
+    if (outgoing > 0 && sim_rng_bool(rng, traffic.through_probability)) {
+        const RoadLink &road = g_network.links[g_network.out_begin[from] + sim_rng_int(rng, 0, outgoing - 1)];
+        int exit = ((int)road.approach + 2) % 4;
+        dest = road.to;
+        // Undo the turn of exit_side(): Straight +2, Left +1, Right +3
+        int back = (dir == Direction::Straight) ? 2 : (dir == Direction::Left) ? 3 : 1;
+        approach = (Approach)((exit + back) % 4);
+    }
 
     bool parkingAllowed =
         (type == VehicleType::Car ||
@@ -98,122 +86,179 @@ Vehicle make_random_vehicle(int id) {
          type == VehicleType::Bus ||
          type == VehicleType::Tractor);
 
-    bool wantsParking = parkingAllowed && rand_bool(0.5);
+    bool wantsParking = parkingAllowed && sim_rng_bool(rng, traffic.parking_probability);
 
     Vehicle v;
     v.id = id;
     v.type = type;
     v.priority = compute_priority(type);
-    v.arrival_time = time(NULL);
     v.originIntersection = origin;
     v.destIntersection = dest;
+    v.approach = approach;
     v.direction = dir;
     v.wantsParking = wantsParking;
+    v.parking_spot = -1;
+    v.draws = 0;
 
     return v;
 }
 
-// ---------------- VEHICLE THREAD ----------------
-void* vehicle_thread_func(void* arg) {
-    Vehicle* v = (Vehicle*)arg;
-
-    // Color based on type
-    const char* vColor = ANSI_BLUE;
-    if (v->type == VehicleType::Ambulance) vColor = ANSI_RED;
-    else if (v->type == VehicleType::FireTruck) vColor = ANSI_RED;
-    else if (v->type == VehicleType::Bus) vColor = ANSI_YELLOW;
-    else if (v->type == VehicleType::Bike || v->type == VehicleType::Tractor) vColor = ANSI_GREEN;
-
-    {
-        std::lock_guard<std::mutex> lk(g_log_mutex);
-        cout << ANSI_BOLD << vColor << "\n" << vehicleEmoji(v->type) << " [Vehicle #" << setw(2) << v->id << "] "
-             << to_string(v->type) << ANSI_RESET << endl;
-        cout << "  ├─ Origin: " << ANSI_CYAN << to_string(v->originIntersection) << ANSI_RESET
-             << " → Destination: " << ANSI_CYAN << to_string(v->destIntersection) << ANSI_RESET << endl;
-        cout << "  ├─ Direction: " << to_string(v->direction)
-             << " | Priority: " << ANSI_MAGENTA << v->priority << ANSI_RESET << endl;
-        cout << "  └─ Parking: " << (v->wantsParking ? ANSI_GREEN "YES" : "NO") << ANSI_RESET << endl;
+void vehicle_place(Vehicle &v, IntersectionId at, Approach from) {
+    bool through = v.destIntersection != v.originIntersection;
+    v.originIntersection = at;
+    v.destIntersection = at;
+    v.approach = from;
+    if (!through) return;
+    int exit = (int)exit_side(from, v.direction);
+    for (int k = g_network.out_begin[(int)at]; k < g_network.out_begin[(int)at + 1]; ++k) {
+        const RoadLink &road = g_network.links[k];
+        if (((int)road.approach + 2) % 4 == exit) {
+            v.destIntersection = road.to;
+            return;
+        }
     }
+}
 
-    // Determine intersection + parking lot
-    Intersection *I = NULL;
-    ParkingLot *lot = NULL;
-
-    if (v->originIntersection == IntersectionId::F10) {
-        I = &F10_intersection;
-        lot = &F10_parking;
-    } else {
-        I = &F11_intersection;
-        lot = &F11_parking;
-    }
+// ---------------- LIFECYCLE STEPS ----------------
+// Shared by the real-time vehicle thread and the discrete-event engine.
 
-    bool hasReservedParking = false;
+static bool is_emergency(const Vehicle *v) {
+    return v->type == VehicleType::Ambulance || v->type == VehicleType::FireTruck;
+}
 
-    // Emergency vehicles NEVER interact with parking
-    if (v->wantsParking &&
-        v->type != VehicleType::Ambulance &&
-        v->type != VehicleType::FireTruck) {
+Intersection* origin_intersection(const Vehicle *v) {
+    return &intersection_at(v->originIntersection);
+}
 
-        hasReservedParking = reserve_parking_spot(*lot, v);
+ParkingLot* origin_parking(const Vehicle *v) {
+    return parking_at(v->originIntersection);
+}
 
-        if (!hasReservedParking) {
-            std::lock_guard<std::mutex> lk(g_log_mutex);
-            cout << ANSI_YELLOW << "  ⚠️  [Vehicle #" << v->id
-                 << "] Could not reserve parking - will pass through" << ANSI_RESET << endl;
-        }
-    }
+bool vehicle_may_park(const Vehicle *v) {
+    // Emergency vehicles NEVER interact with parking, nobody parks where there is no lot
+    return v->wantsParking && !is_emergency(v) && origin_parking(v) != nullptr;
+}
 
-    {
-        std::lock_guard<std::mutex> lk(g_log_mutex);
-        cout << ANSI_CYAN << "  ➤ [Vehicle #" << v->id << "] Approaching 🚦 "
-             << intersection_name(v->originIntersection) << ANSI_RESET << endl;
-    }
+int vehicle_random_int(Vehicle *v, int min, int max) {
+    return sim_random_range(sim_random_at(SIM_STREAM_VEHICLE + (uint64_t)v->id, v->draws++), min, max);
+}
+
+int crossing_seconds(Vehicle *v) {
+    return vehicle_random_int(v, g_network.traffic.crossing_min_s, g_network.traffic.crossing_max_s);
+}
+
+double arrival_gap_seconds(SimRng &arrivals) {
+    return sim_rng_int(arrivals, 100, 500) / 1000.0;
+}
+
+void vehicle_announce(Vehicle *v) {
+    vehicle_set_state(v, VehicleState::Waiting, v->originIntersection);
+    log_event<LogLevel::Info>(LogEvent::VehicleSpawned,
+                              {v->id, (int)v->type, (int)v->originIntersection,
+                               (int)v->destIntersection, (int)v->direction, v->wantsParking});
+}
+
+void vehicle_parking_skipped(Vehicle *v) {
+    log_event<LogLevel::Warn>(LogEvent::VehicleParkingPassThrough, {v->id});
+}
+
+void vehicle_approach(Vehicle *v) {
+    log_event<LogLevel::Info>(LogEvent::VehicleApproaching,
+                              {v->id, (int)v->originIntersection, (int)v->approach, (int)v->direction});
 
     // Notify UI that the vehicle is approaching (to animate stopping at stop line)
-    ui_notify_vehicle_approach(v->originIntersection, v);
-    std::ostringstream oss;
-    oss << "V" << v->id << " " << to_string(v->type) << " approaching";
-    ui_log_event(oss.str());
+    if (ui_active()) {
+        ui_notify_vehicle_approach(v->originIntersection, v);
+        std::ostringstream oss;
+        oss << "V" << v->id << " " << to_string(v->type) << " approaching";
+        ui_log_event(oss.str());
+    }
 
     // If emergency and moving cross-intersection, preempt destination early to clear path
-    if ((v->type == VehicleType::Ambulance || v->type == VehicleType::FireTruck)
-        && v->originIntersection != v->destIntersection) {
-        notify_emergency_from_to(v->originIntersection, v->destIntersection);
+    if (is_emergency(v) && v->originIntersection != v->destIntersection) {
+        notify_emergency_from_to(v->originIntersection, v->destIntersection, v->id);
     }
 
     // Medium priority for bus: allow entering on ANSI_RED when intersection is free (without preemption)
-    // This operationalizes bus priority without full scheduler
-    if (v->type == VehicleType::Bus) {
-        // Temporarily set light to ANSI_GREEN-like behavior for bus when intersection free and no emergency preempt
-        // This is handled inside enter_intersection by checking emergency_preempt and busy
+    // This is handled inside enter_intersection by checking emergency_preempt and busy
+}
+
+void vehicle_cleared_intersection(Vehicle *v) {
+    // After crossing, if emergency preemption was set on destination, clear it to resume normal traffic
+    if (is_emergency(v) && v->originIntersection != v->destIntersection) {
+        set_emergency_preempt(v->destIntersection, false);
+    }
+}
+
+const RoadLink* vehicle_road(const Vehicle *v) {
+    if (v->originIntersection == v->destIntersection) return nullptr;
+    return find_road(v->originIntersection, v->destIntersection);
+}
+
+void vehicle_arrive(Vehicle *v, const RoadLink *road) {
+    log_event<LogLevel::Info>(LogEvent::VehicleArrived, {v->id, (int)road->from, (int)road->to});
+    // From here on the destination is where the vehicle is
+    v->originIntersection = road->to;
+    v->approach = road->approach;
+    v->direction = Direction::Straight;
+    vehicle_set_state(v, VehicleState::Waiting, road->to);
+}
+
+void vehicle_cleared_destination(Vehicle *v) {
+    if (is_emergency(v)) set_emergency_preempt(v->destIntersection, false);
+}
+
+void vehicle_complete(Vehicle *v) {
+    vehicle_set_state(v, VehicleState::Done, v->originIntersection);
+    log_event<LogLevel::Info>(LogEvent::VehicleCompleted, {v->id});
+}
+
+// ---------------- VEHICLE THREAD ----------------
+// Parking manager callback: the parking stay is over and the spot released
+static void vehicle_left_parking(Vehicle *v) {
+    if (ui_active()) ui_notify_vehicle_parking(v->id, false, -1);
+    vehicle_complete(v);
+}
+
+void* vehicle_thread_func(void* arg) {
+    Vehicle* v = (Vehicle*)arg;
+
+    vehicle_announce(v);
+
+    // Determine intersection + parking lot
+    Intersection *I = origin_intersection(v);
+    ParkingLot *lot = origin_parking(v);
+
+    bool hasReservedParking = false;
+
+    if (vehicle_may_park(v)) {
+        hasReservedParking = reserve_parking_spot(*lot, v);
+        if (!hasReservedParking) vehicle_parking_skipped(v);
     }
 
+    vehicle_approach(v);
+
     // Request to enter intersection (blocks if busy)
     enter_intersection(*I, v);
 
     // Simulate time taken to cross intersection
-    sleep(rand_int(1, 2));
+    timer_service_sleep(crossing_seconds(v));
 
     // Leave intersection
     leave_intersection(*I, v);
 
-    // After crossing, if emergency preemption was set on destination, clear it to resume normal traffic
-    if ((v->type == VehicleType::Ambulance || v->type == VehicleType::FireTruck)
-        && v->originIntersection != v->destIntersection) {
-        set_emergency_preempt(v->destIntersection, false);
-    }
+    vehicle_cleared_intersection(v);
 
-    // If parking was reserved, now simulate actual parking usage
+    // If parking was reserved, park: the parking manager ends the stay and
+    // the journey, so the thread is done here
     if (hasReservedParking) {
-        ui_notify_vehicle_parking(v->id, true);
-        use_and_release_parking(*lot, v);
-        ui_notify_vehicle_parking(v->id, false);
+        if (ui_active()) ui_notify_vehicle_parking(v->id, true, v->parking_spot);
+        park_vehicle(*lot, v);
+        park_until_departure(*lot, v, parking_seconds(v), vehicle_left_parking);
+        return NULL;
     }
 
-    {
-        std::lock_guard<std::mutex> lk(g_log_mutex);
-        cout << ANSI_BOLD << ANSI_GREEN << "  ✓ [Vehicle #" << v->id << "] Journey completed successfully" << ANSI_RESET << endl;
-    }
+    vehicle_complete(v);
 
     return NULL;
 }
@@ -0,0 +1,115 @@
+#include "vehicle_store.h"
+#include <sys/mman.h>
+using namespace std;
+
+#include "log.h"
+#include "network.h"
+
+VehicleStore g_vehicles;
+
+static const size_t HUGE_PAGE = 2 << 20;
+static const size_t COLUMN_ALIGN = 64;
+
+static size_t round_up(size_t n, size_t to) {
+    return (n + to - 1) / to * to;
+}
+
+// One anonymous mapping: explicit huge pages if the system has some reserved,
+// else ordinary pages with a request for transparent huge pages. Zero-filled,
+// which is also every column's initial value (VehicleState::Pending).
+static void* map_arena(size_t bytes, bool &huge) {
+    void *p = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    if (p != MAP_FAILED) {
+        huge = true;
+        return p;
+    }
+    huge = false;
+    p = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (p == MAP_FAILED) return nullptr;
+    madvise(p, bytes, MADV_HUGEPAGE);
+    return p;
+}
+
+bool vehicle_store_create(size_t count, const Workload *workload, ArrivalTrace *trace) {
+    size_t infoBytes = round_up(count * sizeof(Vehicle), COLUMN_ALIGN);
+    size_t stateBytes = round_up(count * sizeof(uint8_t), COLUMN_ALIGN);
+    size_t atBytes = round_up(count * sizeof(IntersectionId), COLUMN_ALIGN);
+    size_t bytes = round_up(infoBytes + stateBytes + atBytes, HUGE_PAGE);
+
+    VehicleStore &s = g_vehicles;
+    s.arena = map_arena(bytes, s.huge_pages);
+    if (!s.arena) return false;
+    s.arena_bytes = bytes;
+    char *base = (char*)s.arena;
+    s.info = (Vehicle*)base;
+    s.state = (atomic<uint8_t>*)(base + infoBytes);
+    s.at = (atomic<IntersectionId>*)(base + infoBytes + stateBytes);
+    s.count = count;
+
+    s.spawned = 0;
+    s.exhausted = false;
+    s.workload = workload;
+    s.trace = trace;
+    arrival_process_init(s.arrivals, g_network.traffic);
+    log_event<LogLevel::Info>(LogEvent::VehicleStoreReady,
+                              {(int)count, VEHICLE_BYTES, (int)(bytes >> 20), s.huge_pages});
+    return true;
+}
+
+Vehicle* vehicle_store_next(double &arrival_s) {
+    VehicleStore &s = g_vehicles;
+    if (s.spawned == s.count || s.exhausted) return nullptr;
+    size_t i = s.spawned++;
+    Vehicle &v = s.info[i];
+    bool read = false;
+    if (s.workload) {
+        v = workload_vehicle(*s.workload, i, arrival_s);
+        read = true;
+    } else if (s.trace) {
+        string error;
+        if (!arrival_trace_next(*s.trace, (int)i + 1, v, arrival_s, error)) {
+            // The end of the file, or a line the run cannot use: no more arrivals
+            if (!error.empty()) {
+                log_event<LogLevel::Error>(LogEvent::TraceReadFailed, {(int)i + 1, (int)s.trace->line},
+                                           s.trace->path.c_str());
+            }
+            s.spawned--;
+            s.exhausted = true;
+            return nullptr;
+        }
+        s.arrivals.next = arrival_s;
+        read = true;
+    }
+    if (!read) {
+        int from;
+        arrival_s = arrival_process_next(s.arrivals, from);
+        v = make_random_vehicle((int)i + 1);
+        if (from >= 0) vehicle_place(v, v.originIntersection, (Approach)from);
+    }
+    s.at[i].store(v.originIntersection, memory_order_relaxed);
+    return &v;
+}
+
+void vehicle_store_destroy() {
+    VehicleStore &s = g_vehicles;
+    if (s.arena) munmap(s.arena, s.arena_bytes);
+    s = VehicleStore{};
+}
+
+void vehicle_store_census(uint64_t counts[VEHICLE_STATE_COUNT]) {
+    for (int k = 0; k < VEHICLE_STATE_COUNT; ++k) counts[k] = 0;
+    const atomic<uint8_t> *state = g_vehicles.state;
+    size_t n = g_vehicles.exhausted ? g_vehicles.spawned : g_vehicles.count;
+    for (size_t i = 0; i < n; ++i) {
+        uint8_t st = state[i].load(memory_order_relaxed);
+        if (st < VEHICLE_STATE_COUNT) counts[st]++;
+    }
+}
+
+void log_vehicle_census() {
+    uint64_t counts[VEHICLE_STATE_COUNT];
+    vehicle_store_census(counts);
+    log_event<LogLevel::Info>(LogEvent::VehicleCensus,
+                              {(int)counts[0], (int)counts[1], (int)counts[2],
+                               (int)counts[3], (int)counts[4], (int)counts[5]});
+}
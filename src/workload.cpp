@@ -0,0 +1,125 @@
+#include "workload.h"
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+using namespace std;
+
+#include "network.h"
+#include "arrival_process.h"
+
+bool workload_open(const string &path, Workload &w, string &error) {
+    w = Workload{};
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd == -1) {
+        error = path + ": cannot open workload";
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) == -1 || (size_t)st.st_size < sizeof(WorkloadHeader)) {
+        close(fd);
+        error = path + ": not a workload (too short)";
+        return false;
+    }
+    size_t bytes = (size_t)st.st_size;
+    void *map = mmap(NULL, bytes, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);   // the mapping keeps the file
+    if (map == MAP_FAILED) {
+        error = path + ": cannot map workload";
+        return false;
+    }
+
+    const WorkloadHeader *h = (const WorkloadHeader*)map;
+    auto fail = [&](const string &msg) {
+        munmap(map, bytes);
+        error = path + ": " + msg;
+        return false;
+    };
+    if (memcmp(h->magic, WORKLOAD_MAGIC, sizeof(WORKLOAD_MAGIC)) != 0) return fail("not a workload (bad magic)");
+    if (h->version != WORKLOAD_VERSION) return fail("workload version " + to_string(h->version) + " not supported");
+    if (h->record_bytes != sizeof(WorkloadRecord)) return fail("unexpected record size");
+    if (h->count > (bytes - sizeof(WorkloadHeader)) / sizeof(WorkloadRecord)) return fail("truncated");
+    if ((int)h->intersections != intersection_count()) {
+        return fail("generated for " + to_string(h->intersections) + " intersections, scenario has " +
+                    to_string(intersection_count()));
+    }
+
+    // Records are read once, front to back
+    madvise(map, bytes, MADV_SEQUENTIAL);
+    w.header = h;
+    w.records = (const WorkloadRecord*)(h + 1);
+    w.count = h->count;
+    w.map_bytes = bytes;
+    return true;
+}
+
+void workload_close(Workload &w) {
+    if (w.header) munmap((void*)w.header, w.map_bytes);
+    w = Workload{};
+}
+
+Vehicle workload_vehicle(const Workload &w, size_t i, double &arrival_s) {
+    const WorkloadRecord &r = w.records[i];
+    int n = intersection_count();
+    Vehicle v;
+    v.id = (int32_t)(i + 1);
+    v.originIntersection = (IntersectionId)(r.origin >= 0 && r.origin < n ? r.origin : 0);
+    v.destIntersection = (IntersectionId)(r.dest >= 0 && r.dest < n ? r.dest : 0);
+    v.parking_spot = -1;
+    v.draws = 0;
+    v.type = r.type <= (uint8_t)VehicleType::Tractor ? (VehicleType)r.type : VehicleType::Car;
+    v.priority = compute_priority(v.type);
+    v.approach = (Approach)(r.approach & 3);
+    v.direction = r.direction <= (uint8_t)Direction::Right ? (Direction)r.direction : Direction::Straight;
+    v.wantsParking = (r.flags & WORKLOAD_WANTS_PARKING) != 0;
+    arrival_s = r.arrival_s;
+    return v;
+}
+
+bool workload_write(const string &path, size_t count, string &error) {
+    FILE *f = fopen(path.c_str(), "wb");
+    if (!f) {
+        error = path + ": cannot create workload";
+        return false;
+    }
+    WorkloadHeader h = {};
+    memcpy(h.magic, WORKLOAD_MAGIC, sizeof(h.magic));
+    h.version = WORKLOAD_VERSION;
+    h.record_bytes = sizeof(WorkloadRecord);
+    h.count = count;
+    h.seed = sim_random_get_seed();
+    h.intersections = (uint32_t)intersection_count();
+    bool ok = fwrite(&h, sizeof(h), 1, f) == 1;
+
+    // Same draws as a generated run with this seed, written in blocks
+    const size_t BLOCK = 1 << 16;
+    vector<WorkloadRecord> block;
+    block.reserve(BLOCK);
+    ArrivalProcess arrivals;
+    arrival_process_init(arrivals, g_network.traffic);
+    for (size_t i = 0; i < count && ok; ++i) {
+        int from;
+        double arrival = arrival_process_next(arrivals, from);
+        Vehicle v = make_random_vehicle((int)(i + 1));
+        if (from >= 0) vehicle_place(v, v.originIntersection, (Approach)from);
+        WorkloadRecord r = {};
+        r.arrival_s = arrival;
+        r.origin = (int32_t)v.originIntersection;
+        r.dest = (int32_t)v.destIntersection;
+        r.type = (uint8_t)v.type;
+        r.approach = (uint8_t)v.approach;
+        r.direction = (uint8_t)v.direction;
+        r.flags = v.wantsParking ? WORKLOAD_WANTS_PARKING : 0;
+        block.push_back(r);
+        if (block.size() == BLOCK || i + 1 == count) {
+            ok = fwrite(block.data(), sizeof(WorkloadRecord), block.size(), f) == block.size();
+            block.clear();
+        }
+    }
+    if (fclose(f) != 0) ok = false;
+    if (!ok) error = path + ": write failed";
+    return ok;
+}
@@ -0,0 +1,21 @@
+#!/bin/sh
+# Regression: pool mode with the controllers driving the signal board.
+# The board changes outside Intersection::lock, so a vehicle joining the
+# queue can admit journeys queued before it; they must all be resumed.
+# Used to hang with journeys admitted but never woken (at this seed: waiting
+# 11 | crossing 10 | done 19979).
+#
+#   make check
+
+BIN=${1:-./traffic_sim_headless}
+OUT=$(mktemp)
+timeout 120 "$BIN" 20000 --mode=pool --scenario=scenarios/grid_100x100.scn --rate=2000 --seed=3 --no-ui >"$OUT" 2>&1
+rc=$?
+if [ $rc -ne 0 ] || ! grep -q "done 20000" "$OUT"; then
+    echo "pool_signal_board: FAILED (rc=$rc)"
+    grep -a "VEHICLES.*done" "$OUT" | tail -1
+    rm -f "$OUT"
+    exit 1
+fi
+rm -f "$OUT"
+echo "pool_signal_board: ok"
@@ -0,0 +1,90 @@
+// Workload generator: writes the vehicles of a run to a binary workload file
+// (see include/workload.h) that traffic_sim --workload=FILE replays.
+//
+// Vehicles are drawn exactly as a run with the same scenario and seed draws
+// them, so a workload generated with --seed=N replays that run. Then opens
+// the file again and maps a vehicle table for it, reporting how long a run
+// takes to get from the file to its first vehicle.
+//
+//   make tools
+//   ./tools/gen_workload <file> <vehicles> [--scenario=FILE] [--seed=N]
+
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <cstdlib>
+using namespace std;
+
+#include "workload.h"
+#include "vehicle_store.h"
+#include "network.h"
+
+static double seconds_since(chrono::steady_clock::time_point start) {
+    return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+static void print_usage(const char *prog) {
+    cerr << "Usage: " << prog << " <file> <vehicles> [--scenario=FILE] [--seed=N]\n";
+}
+
+int main(int argc, char **argv) {
+    string path;
+    long n = 0;
+    string scenario;
+    uint64_t seed = sim_random_seed_from_clock();
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        if (arg.rfind("--scenario=", 0) == 0) {
+            scenario = arg.substr(11);
+        } else if (arg.rfind("--seed=", 0) == 0) {
+            seed = strtoull(arg.c_str() + 7, NULL, 10);
+        } else if (arg.rfind("--", 0) == 0) {
+            print_usage(argv[0]);
+            return 1;
+        } else if (path.empty()) {
+            path = arg;
+        } else {
+            n = atol(argv[i]);
+        }
+    }
+    if (path.empty() || n <= 0) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    string error;
+    bool loaded = scenario.empty() ? network_load_default(error) : network_load_file(scenario, error);
+    if (!loaded) {
+        cerr << "Failed to load scenario: " << error << "\n";
+        return 1;
+    }
+    sim_random_seed(seed);
+
+    auto start = chrono::steady_clock::now();
+    if (!workload_write(path, (size_t)n, error)) {
+        cerr << error << "\n";
+        return 1;
+    }
+    double writeSecs = seconds_since(start);
+
+    Workload w;
+    start = chrono::steady_clock::now();
+    if (!workload_open(path, w, error) || !vehicle_store_create(w.count, &w)) {
+        cerr << (error.empty() ? "cannot map a vehicle table" : error) << "\n";
+        return 1;
+    }
+    double arrival;
+    vehicle_store_next(arrival);
+    double loadSecs = seconds_since(start);
+
+    cout << fixed << setprecision(2)
+         << path << ": " << n << " vehicles, seed " << seed << ", "
+         << (sizeof(WorkloadHeader) + n * sizeof(WorkloadRecord)) / double(1 << 20) << " MB\n"
+         << "write      " << writeSecs << " s (" << writeSecs * 1e9 / n << " ns/vehicle)\n"
+         << "load       " << loadSecs * 1e3 << " ms to the first vehicle\n";
+
+    vehicle_store_destroy();
+    workload_close(w);
+    network_destroy();
+    return 0;
+}